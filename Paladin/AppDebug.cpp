@@ -1,9 +1,13 @@
 #include "AppDebug.h"
 
+#include "IncludeAnalyzer.h"
 #include "Project.h"
 #include "SourceFile.h"
 #include <stdio.h>
 
+#include <algorithm>
+#include <vector>
+
 void
 DumpDependencies(Project *proj)
 {
@@ -34,3 +38,157 @@ DumpIncludes(Project *proj)
 	for (int32 i = 0; i < proj->CountSystemIncludes(); i++)
 		printf("\t%s\n",proj->SystemIncludeAt(i));
 }
+
+
+struct header_impact
+{
+	BString		path;
+	int32		dependents;
+	bigtime_t	cost;
+	
+	bool operator<(const header_impact &other) const
+	{
+		if (cost != other.cost)
+			return cost > other.cost;
+		return dependents > other.dependents;
+	}
+};
+
+
+// Ranks headers by how much compiling touching each one causes. The
+// dependency lists gcc gives us already hold every header a source includes,
+// directly or not, so a header's dependents are its transitive fan-in. Each
+// dependent counts for its last compile time. Sources which haven't been
+// timed yet count for the average of those which have.
+void
+DumpRebuildImpact(Project *proj)
+{
+	int32 sourceCount = 0;
+	int32 timedCount = 0;
+	bigtime_t totalTime = 0;
+	for (int32 i = 0; i < proj->CountGroups(); i++)
+	{
+		SourceGroup *group = proj->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			if (!file->UsesBuild())
+				continue;
+			
+			sourceCount++;
+			if (file->CompileTime() > 0)
+			{
+				timedCount++;
+				totalTime += file->CompileTime();
+			}
+		}
+	}
+	
+	// Without any times, every source counts the same
+	bigtime_t averageTime = timedCount > 0 ? totalTime / timedCount : 1000000;
+	
+	BStringList headers;
+	proj->GetHeaders(headers);
+	
+	std::vector<header_impact> impacts;
+	for (int32 i = 0; i < headers.CountStrings(); i++)
+	{
+		header_impact impact;
+		impact.path = headers.StringAt(i);
+		impact.cost = 0;
+		
+		BObjectList<SourceFile> dependents(20, false);
+		proj->GetDependents(impact.path.String(), dependents);
+		impact.dependents = dependents.CountItems();
+		for (int32 j = 0; j < dependents.CountItems(); j++)
+		{
+			bigtime_t time = dependents.ItemAt(j)->CompileTime();
+			impact.cost += time > 0 ? time : averageTime;
+		}
+		
+		impacts.push_back(impact);
+	}
+	
+	std::sort(impacts.begin(), impacts.end());
+	
+	printf("Rebuild impact for project %s: %ld headers, %ld sources, "
+			"%ld with recorded compile times\n", proj->GetName(),
+			(long)impacts.size(), (long)sourceCount, (long)timedCount);
+	if (impacts.empty())
+	{
+		printf("No dependencies are known yet. Build the project or update "
+				"its dependencies first.\n");
+		return;
+	}
+	
+	BString projectFolder(proj->GetPath().GetFolder());
+	projectFolder << "/";
+	
+	printf("%5s %10s %8s %7s  %s\n", "Rank", "Cost (s)", "Sources", "Share",
+			"Header");
+	for (size_t i = 0; i < impacts.size(); i++)
+	{
+		BString path(impacts[i].path);
+		if (path.FindFirst(projectFolder) == 0)
+			path.Remove(0, projectFolder.Length());
+		
+		printf("%5ld %10.2f %8ld %6.1f%%  %s\n", (long)i + 1,
+				impacts[i].cost / 1000000.0, (long)impacts[i].dependents,
+				sourceCount > 0 ? impacts[i].dependents * 100.0 / sourceCount : 0.0,
+				path.String());
+	}
+}
+
+
+void
+DumpUnusedIncludes(Project *proj)
+{
+	printf("Unused includes for project %s:\n", proj->GetName());
+	
+	BString projectFolder(proj->GetPath().GetFolder());
+	projectFolder << "/";
+	
+	IncludeAnalyzer analyzer(proj);
+	int32 fileCount = 0;
+	int32 includeCount = 0;
+	bigtime_t totalSavings = 0;
+	for (int32 i = 0; i < proj->CountGroups(); i++)
+	{
+		SourceGroup *group = proj->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			if (!file->UsesBuild() || file->GetType() != TYPE_C)
+				continue;
+			
+			std::vector<unused_include> unused;
+			if (analyzer.FindUnused(file, unused) == 0)
+				continue;
+			
+			BString path(file->GetPath().GetFullPath());
+			if (path.FindFirst(projectFolder) == 0)
+				path.Remove(0, projectFolder.Length());
+			
+			bigtime_t fileSavings = 0;
+			for (size_t k = 0; k < unused.size(); k++)
+				fileSavings += unused[k].savings;
+			
+			printf("%s: %ld unused, about %.2f s\n", path.String(),
+					(long)unused.size(), fileSavings / 1000000.0);
+			for (size_t k = 0; k < unused.size(); k++)
+			{
+				printf("\tline %ld: \"%s\", about %.2f s\n", (long)unused[k].line,
+						unused[k].name.String(), unused[k].savings / 1000000.0);
+			}
+			
+			fileCount++;
+			includeCount += unused.size();
+			totalSavings += fileSavings;
+		}
+	}
+	
+	printf("%ld unused includes in %ld files, about %.2f s of compile time. "
+			"Savings are estimated from the size of the headers only each "
+			"include brings in.\n", (long)includeCount, (long)fileCount,
+			totalSavings / 1000000.0);
+}
@@ -5,5 +5,7 @@ class Project;
 
 void DumpDependencies(Project *proj);
 void DumpIncludes(Project *proj);
+void DumpRebuildImpact(Project *proj);
+void DumpUnusedIncludes(Project *proj);
 
 #endif
@@ -0,0 +1,1188 @@
+#include "Benchmark.h"
+
+#include <Catalog.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <Locale.h>
+#include <Looper.h>
+#include <Messenger.h>
+#include <Node.h>
+#include <OS.h>
+#include <TLS.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "DebugTools.h"
+#include "DPath.h"
+#include "ErrorParser.h"
+#include "Globals.h"
+#include "ObjectList.h"
+#include "Project.h"
+#include "ProjectBuilder.h"
+#include "SourceFile.h"
+#include "StatCache.h"
+#include "TextFile.h"
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Benchmark"
+
+// The stand-in toolchain. It creates whatever output file it was asked for
+// and answers g++ -MM with the quoted includes of the source, one per line
+// the way gcc does with absolute paths, so that only Paladin's own overhead
+// ends up in the numbers.
+static const char *sStubCompiler[] = {
+	"#!/bin/sh",
+	"out=",
+	"src=",
+	"deps=0",
+	"while [ $# -gt 0 ]; do",
+	"	case \"$1\" in",
+	"		-MM) deps=1 ;;",
+	"		-o) shift; out=\"$1\" ;;",
+	"		-o*) out=\"${1#-o}\" ;;",
+	"		-*) ;;",
+	"		*) src=\"$1\" ;;",
+	"	esac",
+	"	shift",
+	"done",
+	"if [ $deps -eq 1 ]; then",
+	"	dir=`dirname \"$src\"`",
+	"	base=`basename \"$src\"`",
+	"	printf '%s.o: %s' \"${base%.*}\" \"$src\"",
+	"	for inc in `sed -n 's/^#include \"\\(.*\\)\"$/\\1/p' \"$src\"`; do",
+	"		printf ' \\\\\\n %s/%s' \"$dir\" \"$inc\"",
+	"	done",
+	"	printf '\\n'",
+	"	exit 0",
+	"fi",
+	"if [ -n \"$out\" ]; then",
+	"	: > \"$out\"",
+	"fi",
+	"exit 0",
+	NULL
+};
+
+static const char *sStubArchiver[] = {
+	"#!/bin/sh",
+	": > \"$2\"",
+	"exit 0",
+	NULL
+};
+
+static const char *sStubNoop[] = {
+	"#!/bin/sh",
+	"exit 0",
+	NULL
+};
+
+static const char *sStubTools[] = {
+	"g++", "gcc", "flex", "bison", "rc", "ar", "xres", NULL
+};
+
+// Sources in the spelling folder which include header_0.h through other
+// spellings of its path, and how they spell the way up to it
+static const char *sSpellingSources[][2] = {
+	{ "parent.cpp", "../" },
+	{ "current.cpp", "./../" },
+	{ NULL, NULL }
+};
+
+
+class BuildWatcher : public BLooper
+{
+public:
+						BuildWatcher(void);
+						~BuildWatcher(void);
+			void		MessageReceived(BMessage *msg);
+
+			status_t	Wait(void);
+			int32		FilesBuilt(void) const { return fFilesBuilt; }
+
+private:
+	sem_id				fDoneSem;
+	status_t			fResult;
+	int32				fFilesBuilt;
+};
+
+
+class BenchmarkResult
+{
+public:
+						BenchmarkResult(const char *name);
+			void		AddRun(bigtime_t elapsed);
+
+			BString		name;
+			int32		runs;
+			bigtime_t	total,
+						min,
+						max;
+			int32		filesBuilt;
+
+			// Only set by the micro-benchmarks, which report per operation
+			int64		ops;
+			int64		allocations;
+};
+
+
+// Keeps the compiler from throwing away the work being measured
+static volatile int32 sSink = 0;
+
+
+// Allocation counting for the micro-benchmarks. malloc() and realloc() are
+// replaced for the whole program and pass the calls on to libroot's, so the
+// buffers BString and DPath get from them are counted along with everything
+// operator new hands out. Until counting is asked for, nothing but the call
+// is added. The count is found through a thread local slot which only the
+// thread taking a measurement sets, so the other threads' allocations don't
+// end up in it.
+static bool sCountAllocations = false;
+static int32 sAllocationSlot = -1;
+static int64 sAllocations = 0;
+
+static void *(*sMalloc)(size_t) = NULL;
+static void *(*sRealloc)(void *, size_t) = NULL;
+
+
+static inline void
+CountAllocation(void)
+{
+	if (sAllocationSlot >= 0)
+	{
+		int64 *counter = (int64*)tls_get(sAllocationSlot);
+		if (counter)
+			(*counter)++;
+	}
+}
+
+
+extern "C" void *
+malloc(size_t size)
+{
+	if (!sMalloc)
+		sMalloc = (void *(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+
+	CountAllocation();
+	return sMalloc(size);
+}
+
+
+extern "C" void *
+realloc(void *block, size_t size)
+{
+	if (!sRealloc)
+		sRealloc = (void *(*)(void *, size_t))dlsym(RTLD_NEXT, "realloc");
+
+	CountAllocation();
+	return sRealloc(block, size);
+}
+
+
+BenchmarkSettings::BenchmarkSettings(void)
+	:	sourceCount(200),
+		headerCount(50),
+		includeFanout(5),
+		groupCount(4),
+		lexCount(1),
+		yaccCount(1),
+		rdefCount(1),
+		runs(3),
+		pathCount(100000),
+		logMegabytes(50),
+		pldLines(20000),
+		statLookups(10000),
+		countAllocations(false),
+		suite("build"),
+		folder("/tmp/PaladinBenchmark"),
+		output("")
+{
+}
+
+
+status_t
+BenchmarkSettings::ParseArgument(const char *arg)
+{
+	BString key(arg);
+	int32 pos = key.FindFirst("=");
+	if (pos < 1)
+		return B_BAD_VALUE;
+
+	BString value(key.String() + pos + 1);
+	key.Truncate(pos);
+	int32 number = atol(value.String());
+
+	if (key == "sources")
+		sourceCount = MAX(number, 1);
+	else if (key == "headers")
+		headerCount = MAX(number, 1);
+	else if (key == "fanout")
+		includeFanout = MAX(number, 1);
+	else if (key == "groups")
+		groupCount = MAX(number, 1);
+	else if (key == "lex")
+		lexCount = MAX(number, 0);
+	else if (key == "yacc")
+		yaccCount = MAX(number, 0);
+	else if (key == "rdef")
+		rdefCount = MAX(number, 0);
+	else if (key == "runs")
+		runs = MAX(number, 1);
+	else if (key == "paths")
+		pathCount = MAX(number, 1);
+	else if (key == "logmb")
+		logMegabytes = MAX(number, 1);
+	else if (key == "pldlines")
+		pldLines = MAX(number, 1);
+	else if (key == "stats")
+		statLookups = MAX(number, 1);
+	else if (key == "allocs" && (value == "yes" || value == "no"))
+		countAllocations = value == "yes";
+	else if (key == "suite" && (value == "build" || value == "micro" || value == "all"))
+		suite = value;
+	else if (key == "folder" && value.CountChars() > 0)
+		folder = value;
+	else if (key == "output")
+		output = value;
+	else
+		return B_BAD_VALUE;
+
+	return B_OK;
+}
+
+
+void
+PrintBenchmarkUsage(void)
+{
+	printf(B_TRANSLATE("Benchmark options for -p, given as key=value:\n"
+			"sources=N, Number of C++ sources to generate (200).\n"
+			"headers=N, Number of headers to generate (50).\n"
+			"fanout=N, Headers included by each source (5).\n"
+			"groups=N, Number of project groups (4).\n"
+			"lex=N, yacc=N, rdef=N, Number of Lex, Yacc and resource files (1).\n"
+			"runs=N, Times each measurement is repeated (3).\n"
+			"suite=build|micro|all, Which benchmarks to run (build).\n"
+			"paths=N, Paths used by the DPath micro-benchmarks (100000).\n"
+			"logmb=N, Size in MB of the generated gcc log (50).\n"
+			"pldlines=N, Lines in the generated project file (20000).\n"
+			"stats=N, Lookups made by the StatCache micro-benchmark (10000).\n"
+			"allocs=yes|no, Count the allocations of the micro-benchmarks (no).\n"
+			"folder=PATH, Where the project is generated (/tmp/PaladinBenchmark).\n"
+			"output=PATH, Write the JSON results to a file instead of stdout.\n"));
+}
+
+
+BuildWatcher::BuildWatcher(void)
+	:	BLooper("benchmark_watcher"),
+		fResult(B_OK),
+		fFilesBuilt(0)
+{
+	fDoneSem = create_sem(0, "benchmark_done");
+}
+
+
+BuildWatcher::~BuildWatcher(void)
+{
+	delete_sem(fDoneSem);
+}
+
+
+void
+BuildWatcher::MessageReceived(BMessage *msg)
+{
+	switch (msg->what)
+	{
+		case M_BUILDING_FILE:
+		{
+			fFilesBuilt++;
+			break;
+		}
+		case M_BUILD_FAILURE:
+		{
+			ErrorList errors;
+			errors.Unflatten(*msg);
+			fprintf(stderr, "%s", errors.AsString().String());
+			fResult = B_ERROR;
+			release_sem(fDoneSem);
+			break;
+		}
+		case M_BUILD_SUCCESS:
+		{
+			release_sem(fDoneSem);
+			break;
+		}
+		default:
+			BLooper::MessageReceived(msg);
+	}
+}
+
+
+status_t
+BuildWatcher::Wait(void)
+{
+	status_t status = acquire_sem(fDoneSem);
+	if (status != B_OK)
+		return status;
+	return fResult;
+}
+
+
+BenchmarkResult::BenchmarkResult(const char *name_)
+	:	name(name_),
+		runs(0),
+		total(0),
+		min(0),
+		max(0),
+		filesBuilt(-1),
+		ops(0),
+		allocations(0)
+{
+}
+
+
+void
+BenchmarkResult::AddRun(bigtime_t elapsed)
+{
+	if (runs == 0 || elapsed < min)
+		min = elapsed;
+	if (elapsed > max)
+		max = elapsed;
+	total += elapsed;
+	runs++;
+}
+
+
+static status_t
+WriteTextFile(DPath path, const BString &data, bool executable = false)
+{
+	BFile file(path.GetFullPath(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	if (file.Write(data.String(), data.Length()) != data.Length())
+		return B_IO_ERROR;
+
+	if (executable)
+		file.SetPermissions(S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
+
+	return B_OK;
+}
+
+
+static BString
+JoinLines(const char **lines)
+{
+	BString out;
+	for (int32 i = 0; lines[i]; i++)
+		out << lines[i] << "\n";
+	return out;
+}
+
+
+static status_t
+InstallStubToolchain(DPath folder)
+{
+	create_directory(folder.GetFullPath(), 0777);
+
+	for (int32 i = 0; sStubTools[i]; i++)
+	{
+		BString tool(sStubTools[i]);
+		BString script;
+		if (tool == "ar")
+			script = JoinLines(sStubArchiver);
+		else if (tool == "xres")
+			script = JoinLines(sStubNoop);
+		else
+			script = JoinLines(sStubCompiler);
+
+		DPath toolPath(folder);
+		toolPath << tool;
+		status_t status = WriteTextFile(toolPath, script, true);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+static void
+BackdateFolder(const char *path, time_t when)
+{
+	BDirectory dir(path);
+	entry_ref ref;
+	while (dir.GetNextRef(&ref) == B_OK)
+	{
+		BNode node(&ref);
+		if (node.InitCheck() == B_OK && !node.IsDirectory())
+			node.SetModificationTime(when);
+	}
+}
+
+
+static BString
+HeaderName(int32 index)
+{
+	BString name("header_");
+	name << index << ".h";
+	return name;
+}
+
+
+static status_t
+GenerateProject(const BenchmarkSettings &settings, DPath &outProject)
+{
+	DPath folder(settings.folder.String());
+	create_directory(folder.GetFullPath(), 0777);
+
+	BString projData;
+	projData << "NAME=Benchmark\nTARGETNAME=Benchmark\n";
+	projData << "PLATFORM="
+			<< (gPlatform == PLATFORM_HAIKU_GCC4 ? "HaikuGCC4" : "Haiku") << "\n";
+	projData << "SCM=none\n";
+
+	status_t status;
+	for (int32 i = 0; i < settings.headerCount; i++)
+	{
+		BString guard(MakeHeaderGuard(HeaderName(i).String()));
+		BString data;
+		data << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+			<< "int header_" << i << "_value(void);\n\n#endif\n";
+
+		DPath path(folder);
+		path << HeaderName(i);
+		status = WriteTextFile(path, data);
+		if (status != B_OK)
+			return status;
+	}
+
+	// Sources are dealt round-robin into groups. Each one includes a fixed,
+	// repeatable set of headers so that touching header_0.h always dirties
+	// the same subset of the project.
+	for (int32 group = 0; group < settings.groupCount; group++)
+	{
+		projData << "GROUP=Group " << group << "\nEXPANDGROUP=yes\n";
+
+		for (int32 i = group; i < settings.sourceCount; i += settings.groupCount)
+		{
+			BString name("source_");
+			name << i << ".cpp";
+
+			BString data;
+			int32 fanout = MIN(settings.includeFanout, settings.headerCount);
+			for (int32 j = 0; j < fanout; j++)
+				data << "#include \"" << HeaderName((i + j * 7) % settings.headerCount)
+					<< "\"\n";
+			data << "\nint\nsource_" << i << "_value(void)\n{\n\treturn " << i
+				<< ";\n}\n";
+
+			DPath path(folder);
+			path << name;
+			status = WriteTextFile(path, data);
+			if (status != B_OK)
+				return status;
+			projData << "SOURCEFILE=" << name << "\n";
+		}
+	}
+
+	DPath spellingFolder(folder);
+	spellingFolder << "spelling";
+	create_directory(spellingFolder.GetFullPath(), 0777);
+	projData << "GROUP=Spellings\nEXPANDGROUP=yes\n";
+	for (int32 i = 0; sSpellingSources[i][0] != NULL; i++)
+	{
+		BString data;
+		data << "#include \"" << sSpellingSources[i][1] << HeaderName(0) << "\"\n";
+
+		DPath path(spellingFolder);
+		path << sSpellingSources[i][0];
+		status = WriteTextFile(path, data);
+		if (status != B_OK)
+			return status;
+		projData << "SOURCEFILE=spelling/" << sSpellingSources[i][0] << "\n";
+	}
+
+	projData << "GROUP=Generated\nEXPANDGROUP=yes\n";
+	for (int32 i = 0; i < settings.lexCount; i++)
+	{
+		BString name("scanner_");
+		name << i << ".l";
+		DPath path(folder);
+		path << name;
+		status = WriteTextFile(path, BString("%%\n.|\\n\t;\n%%\n"));
+		if (status != B_OK)
+			return status;
+		projData << "SOURCEFILE=" << name << "\n";
+	}
+
+	for (int32 i = 0; i < settings.yaccCount; i++)
+	{
+		BString name("grammar_");
+		name << i << ".y";
+		DPath path(folder);
+		path << name;
+		status = WriteTextFile(path, BString("%%\nstart:\t;\n%%\n"));
+		if (status != B_OK)
+			return status;
+		projData << "SOURCEFILE=" << name << "\n";
+	}
+
+	for (int32 i = 0; i < settings.rdefCount; i++)
+	{
+		BString name("resources_");
+		name << i << ".rdef";
+		DPath path(folder);
+		path << name;
+		BString data;
+		data << "resource(" << i + 1 << ", \"benchmark\") \"" << name << "\";\n";
+		status = WriteTextFile(path, data);
+		if (status != B_OK)
+			return status;
+		projData << "SOURCEFILE=" << name << "\n";
+	}
+
+	projData << "LOCALINCLUDE=.\nCCDEBUG=no\nCCPROFILE=no\nCCOPSIZE=no\n"
+			<< "CCOPLEVEL=0\nCCTARGETTYPE=" << TARGET_APP << "\n";
+
+	outProject = folder;
+	outProject << "Benchmark.pld";
+	status = WriteTextFile(outProject, projData);
+	if (status != B_OK)
+		return status;
+
+	// Push everything an hour into the past so that freshly built objects
+	// are always newer than their sources
+	BackdateFolder(folder.GetFullPath(), real_time_clock() - 3600);
+	return B_OK;
+}
+
+
+// Makes sure that header_0.h is one header in the dependency graph no
+// matter which spelling of its path the sources that include it used
+static status_t
+CheckDependentSpellings(Project *proj, const DPath &folder)
+{
+	proj->UpdateDependencyGraph();
+
+	DPath header(folder);
+	header << HeaderName(0);
+	BObjectList<SourceFile> dependents(20, false);
+	proj->GetDependents(header.GetFullPath(), dependents);
+
+	for (int32 i = 0; sSpellingSources[i][0] != NULL; i++)
+	{
+		DPath source(folder);
+		source << "spelling" << sSpellingSources[i][0];
+		SourceFile *file = proj->FindFile(source.GetFullPath());
+		if (file == NULL || !dependents.HasItem(file))
+		{
+			fprintf(stderr, B_TRANSLATE("%s isn't listed as including %s\n"),
+					source.GetFullPath(), header.GetFullPath());
+			return B_ERROR;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+TimedBuild(Project *proj, BenchmarkResult &result)
+{
+	BuildWatcher *watcher = new BuildWatcher();
+	watcher->Run();
+
+	ProjectBuilder *builder = new ProjectBuilder(BMessenger(watcher));
+
+	bigtime_t start = system_time();
+	builder->BuildProject(proj, POSTBUILD_NOTHING);
+	status_t status = watcher->Wait();
+	result.AddRun(system_time() - start);
+
+	// Deleting the builder waits for any straggling build threads
+	delete builder;
+
+	result.filesBuilt = watcher->FilesBuilt();
+	watcher->Lock();
+	watcher->Quit();
+
+	return status;
+}
+
+
+static void
+AppendResult(BString &json, const BenchmarkResult &result, bool last)
+{
+	json << "\t\t{ \"name\": \"" << result.name << "\", \"runs\": " << result.runs
+		<< ", \"min_us\": " << result.min
+		<< ", \"mean_us\": " << (result.runs > 0 ? result.total / result.runs : 0)
+		<< ", \"max_us\": " << result.max;
+	if (result.filesBuilt >= 0)
+		json << ", \"files_built\": " << result.filesBuilt;
+	if (result.ops > 0)
+	{
+		json << ", \"ops\": " << result.ops
+			<< ", \"ns_per_op\": " << (float)result.total * 1000.0f / result.ops
+			<< ", \"allocs_per_op\": ";
+		if (sCountAllocations)
+			json << (float)result.allocations / result.ops;
+		else
+			json << "null";
+	}
+	json << " }" << (last ? "\n" : ",\n");
+}
+
+
+static status_t
+RunBuildBenchmarks(const BenchmarkSettings &settings,
+					BObjectList<BenchmarkResult> &results)
+{
+	DPath folder(settings.folder.String());
+	DPath stubFolder(folder);
+	stubFolder << "stubbin";
+
+	DPath projPath;
+	BenchmarkResult *result = new BenchmarkResult("generate");
+	results.AddItem(result);
+	bigtime_t start = system_time();
+	status_t status = GenerateProject(settings, projPath);
+	result->AddRun(system_time() - start);
+	if (status == B_OK)
+		status = InstallStubToolchain(stubFolder);
+	if (status != B_OK)
+	{
+		fprintf(stderr, B_TRANSLATE("Couldn't generate the benchmark project in %s\n"),
+				folder.GetFullPath());
+		return status;
+	}
+
+	BString oldPath(getenv("PATH"));
+	BString newPath(stubFolder.GetFullPath());
+	newPath << ":" << oldPath;
+	setenv("PATH", newPath.String(), 1);
+
+	result = new BenchmarkResult("load");
+	results.AddItem(result);
+	for (int32 i = 0; i < settings.runs; i++)
+	{
+		Project loaded;
+		start = system_time();
+		status = loaded.Load(projPath.GetFullPath());
+		result->AddRun(system_time() - start);
+		if (status != B_OK)
+			break;
+	}
+
+	Project *proj = new Project;
+	if (status == B_OK)
+		status = proj->Load(projPath.GetFullPath());
+
+	if (status == B_OK)
+	{
+		result = new BenchmarkResult("update_dependencies");
+		results.AddItem(result);
+		for (int32 run = 0; run < settings.runs; run++)
+		{
+			start = system_time();
+			for (int32 i = 0; i < proj->CountGroups(); i++)
+			{
+				SourceGroup *group = proj->GroupAt(i);
+				for (int32 j = 0; j < group->filelist.CountItems(); j++)
+					group->filelist.ItemAt(j)->UpdateDependencies(*proj->GetBuildInfo());
+			}
+			result->AddRun(system_time() - start);
+		}
+
+		status = CheckDependentSpellings(proj, folder);
+	}
+
+	if (status == B_OK)
+	{
+		result = new BenchmarkResult("save");
+		results.AddItem(result);
+		for (int32 i = 0; i < settings.runs; i++)
+		{
+			start = system_time();
+			proj->Save();
+			result->AddRun(system_time() - start);
+		}
+
+		result = new BenchmarkResult("clean_build");
+		results.AddItem(result);
+		for (int32 i = 0; i < settings.runs && status == B_OK; i++)
+		{
+			proj->ForceRebuild();
+			status = TimedBuild(proj, *result);
+		}
+	}
+
+	if (status == B_OK)
+	{
+		result = new BenchmarkResult("noop_build");
+		results.AddItem(result);
+		for (int32 i = 0; i < settings.runs && status == B_OK; i++)
+			status = TimedBuild(proj, *result);
+	}
+
+	if (status == B_OK)
+	{
+		// Age the objects instead of pushing the header into the future --
+		// the build system resets future modification times on sources.
+		DPath header(folder);
+		header << HeaderName(0);
+
+		result = new BenchmarkResult("header_touch_build");
+		results.AddItem(result);
+		for (int32 i = 0; i < settings.runs && status == B_OK; i++)
+		{
+			time_t now = real_time_clock();
+			BackdateFolder(proj->GetObjectPath().GetFullPath(), now - 60);
+			BNode(header.GetFullPath()).SetModificationTime(now - 30);
+			status = TimedBuild(proj, *result);
+		}
+	}
+
+	delete proj;
+	setenv("PATH", oldPath.String(), 1);
+	return status;
+}
+
+
+static void
+BeginMeasure(bigtime_t &start)
+{
+	if (sCountAllocations)
+	{
+		if (sAllocationSlot < 0)
+			sAllocationSlot = tls_allocate();
+		sAllocations = 0;
+		tls_set(sAllocationSlot, &sAllocations);
+	}
+	start = system_time();
+}
+
+
+static void
+EndMeasure(BenchmarkResult &result, bigtime_t start, int64 ops)
+{
+	bigtime_t elapsed = system_time() - start;
+	if (sCountAllocations)
+	{
+		tls_set(sAllocationSlot, NULL);
+		result.allocations += sAllocations;
+	}
+
+	result.AddRun(elapsed);
+	result.ops += ops;
+}
+
+
+static int32
+SafeLength(const char *string)
+{
+	return string ? strlen(string) : 0;
+}
+
+
+static BString
+MakeBenchmarkPath(int32 index)
+{
+	// A spread of the shapes DPath has to take apart: deep and shallow,
+	// with and without an extension
+	BString path;
+	switch (index % 4)
+	{
+		case 0:
+			path << "/boot/home/projects/module_" << index / 64 << "/src/source_"
+				<< index << ".cpp";
+			break;
+		case 1:
+			path << "/boot/system/develop/headers/os/interface/View_" << index << ".h";
+			break;
+		case 2:
+			path << "/boot/home/Desktop/Makefile_" << index;
+			break;
+		default:
+			path << "/boot/home/projects/module_" << index / 64
+				<< "/objects.x86_64-cc13-release/source_" << index << ".o";
+			break;
+	}
+	return path;
+}
+
+
+static void
+BenchmarkDPath(const BenchmarkSettings &settings, BObjectList<BenchmarkResult> &results)
+{
+	int32 count = settings.pathCount;
+	BString *strings = new BString[count];
+	DPath *paths = new DPath[count];
+	for (int32 i = 0; i < count; i++)
+	{
+		strings[i] = MakeBenchmarkPath(i);
+		paths[i] = strings[i];
+	}
+
+	BenchmarkResult *construct = new BenchmarkResult("dpath_construct");
+	BenchmarkResult *copy = new BenchmarkResult("dpath_copy");
+	BenchmarkResult *append = new BenchmarkResult("dpath_append");
+	BenchmarkResult *getters = new BenchmarkResult("dpath_getters");
+	results.AddItem(construct);
+	results.AddItem(copy);
+	results.AddItem(append);
+	results.AddItem(getters);
+
+	for (int32 run = 0; run < settings.runs; run++)
+	{
+		bigtime_t start;
+
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+		{
+			DPath path(strings[i]);
+			sSink += SafeLength(path.GetFullPath());
+		}
+		EndMeasure(*construct, start, count);
+
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+		{
+			DPath path(paths[i]);
+			sSink += SafeLength(path.GetFileName());
+		}
+		EndMeasure(*copy, start, count);
+
+		// The pattern used all over the build system: take a folder and
+		// hang a file name off it
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+		{
+			DPath path(paths[i].GetFolder());
+			path << "include.h";
+			sSink += SafeLength(path.GetFullPath());
+		}
+		EndMeasure(*append, start, count);
+
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+		{
+			sSink += SafeLength(paths[i].GetFolder())
+				+ SafeLength(paths[i].GetBaseName())
+				+ SafeLength(paths[i].GetExtension());
+		}
+		EndMeasure(*getters, start, count);
+	}
+
+	delete [] paths;
+	delete [] strings;
+}
+
+
+static status_t
+BenchmarkStatCache(const BenchmarkSettings &settings,
+					BObjectList<BenchmarkResult> &results)
+{
+	// 64 files fit comfortably in the default cache size, 256 do not
+	const int32 kHotFiles = 64;
+	const int32 kFileCount = 256;
+
+	DPath folder(settings.folder.String());
+	create_directory(folder.GetFullPath(), 0777);
+	folder << "statcache";
+	create_directory(folder.GetFullPath(), 0777);
+
+	BString *paths = new BString[kFileCount];
+	for (int32 i = 0; i < kFileCount; i++)
+	{
+		BString name("file_");
+		name << i;
+		DPath path(folder);
+		path << name;
+		paths[i] = path.GetFullPath();
+
+		status_t status = WriteTextFile(path, name);
+		if (status != B_OK)
+		{
+			delete [] paths;
+			return status;
+		}
+	}
+
+	BenchmarkResult *hit = new BenchmarkResult("statcache_hot");
+	BenchmarkResult *miss = new BenchmarkResult("statcache_cold");
+	BenchmarkResult *baseline = new BenchmarkResult("stat_syscall");
+	results.AddItem(hit);
+	results.AddItem(miss);
+	results.AddItem(baseline);
+
+	int32 count = settings.statLookups;
+	for (int32 run = 0; run < settings.runs; run++)
+	{
+		bigtime_t start;
+
+		StatCache hotCache;
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+			sSink += hotCache.StatFor(paths[(i * 7) % kHotFiles].String()) ? 1 : 0;
+		EndMeasure(*hit, start, count);
+
+		StatCache coldCache;
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+			sSink += coldCache.StatFor(paths[i % kFileCount].String()) ? 1 : 0;
+		EndMeasure(*miss, start, count);
+
+		BeginMeasure(start);
+		for (int32 i = 0; i < count; i++)
+		{
+			struct stat info;
+			sSink += stat(paths[i % kFileCount].String(), &info);
+		}
+		EndMeasure(*baseline, start, count);
+	}
+
+	delete [] paths;
+	return B_OK;
+}
+
+
+static char *
+GenerateGCCLog(int32 megabytes, int64 &lineCount)
+{
+	// One translation unit's worth of the usual suspects, repeated until the
+	// log reaches the requested size
+	static const char *sLogLines[] = {
+		"In file included from /boot/home/projects/bench/src/source_%d.cpp:12:\n",
+		"/boot/home/projects/bench/src/header_%d.h: In member function 'void Widget::Draw()':\n",
+		"/boot/home/projects/bench/src/header_%d.h:42: warning: unused variable 'count'\n",
+		"/boot/home/projects/bench/src/source_%d.cpp:57:12: error: 'frame' was not declared in this scope\n",
+		"/boot/home/projects/bench/src/source_%d.cpp:57:12: note: suggested alternative: 'Frame'\n",
+		"objects/source_%d.o: In function `Widget::Draw()':\n",
+		"source_%d.cpp:(.text+0x1c): undefined reference to `missing_symbol'\n",
+		NULL
+	};
+
+	size_t size = (size_t)megabytes * 1024 * 1024;
+	char *log = new char[size + 1];
+	size_t used = 0;
+	lineCount = 0;
+
+	bool full = false;
+	for (int block = 0; !full; block++)
+	{
+		for (int32 i = 0; sLogLines[i]; i++)
+		{
+			char line[256];
+			size_t length = snprintf(line, sizeof(line), sLogLines[i], block);
+			if (used + length > size)
+			{
+				full = true;
+				break;
+			}
+			memcpy(log + used, line, length);
+			used += length;
+			lineCount++;
+		}
+	}
+	log[used] = '\0';
+
+	return log;
+}
+
+
+static void
+BenchmarkErrorParser(const BenchmarkSettings &settings,
+					BObjectList<BenchmarkResult> &results)
+{
+	int64 lineCount;
+	char *log = GenerateGCCLog(settings.logMegabytes, lineCount);
+
+	BenchmarkResult *result = new BenchmarkResult("gcc_log_parse");
+	results.AddItem(result);
+	for (int32 run = 0; run < settings.runs; run++)
+	{
+		ErrorList errors;
+		bigtime_t start;
+		BeginMeasure(start);
+		ParseGCCErrors(log, errors);
+		EndMeasure(*result, start, lineCount);
+		sSink += errors.msglist.CountItems();
+	}
+
+	delete [] log;
+}
+
+
+static status_t
+GeneratePldFile(const BenchmarkSettings &settings, DPath &outPath, int32 &lineCount)
+{
+	DPath folder(settings.folder.String());
+	create_directory(folder.GetFullPath(), 0777);
+
+	// Project::Load takes an empty line for the end of the file, so there
+	// are none in it
+	BString data;
+	data << "NAME=Micro\nTARGETNAME=Micro\nSCM=none\nLOCALINCLUDE=.\n";
+	lineCount = 4;
+	for (int32 i = 0; lineCount < settings.pldLines; i++)
+	{
+		if (i % 100 == 0)
+		{
+			data << "GROUP=Group " << i / 100 << "\nEXPANDGROUP=yes\n";
+			lineCount += 2;
+		}
+
+		data << "SOURCEFILE=src/module_" << i / 100 << "/source_" << i << ".cpp\n"
+			<< "DEPENDENCY=/src/module_" << i / 100 << "/source_" << i
+			<< ".h|/src/common/defs.h|/src/common/debug.h\n";
+		lineCount += 2;
+	}
+
+	outPath = folder;
+	outPath << "Micro.pld";
+	return WriteTextFile(outPath, data);
+}
+
+
+static status_t
+BenchmarkTextFile(const BenchmarkSettings &settings,
+					BObjectList<BenchmarkResult> &results)
+{
+	DPath pldPath;
+	int32 lineCount;
+	status_t status = GeneratePldFile(settings, pldPath, lineCount);
+	if (status != B_OK)
+		return status;
+
+	BenchmarkResult *readLine = new BenchmarkResult("textfile_readline");
+	BenchmarkResult *load = new BenchmarkResult("project_load");
+	results.AddItem(readLine);
+	results.AddItem(load);
+
+	for (int32 run = 0; run < settings.runs && status == B_OK; run++)
+	{
+		bigtime_t start;
+
+		// Opening the file is part of the cost, since TextFile reads the
+		// whole thing up front
+		BeginMeasure(start);
+		TextFile *file = new TextFile(pldPath.GetFullPath(), B_READ_ONLY);
+		int64 lines = 0;
+		const char *line = file->ReadLine();
+		while (line && *line)
+		{
+			lines++;
+			line = file->ReadLine();
+		}
+		delete file;
+		EndMeasure(*readLine, start, lines);
+
+		Project *proj = new Project;
+		BeginMeasure(start);
+		status = proj->Load(pldPath.GetFullPath());
+		EndMeasure(*load, start, lineCount);
+		delete proj;
+	}
+
+	return status;
+}
+
+
+static status_t
+RunMicroBenchmarks(const BenchmarkSettings &settings,
+					BObjectList<BenchmarkResult> &results)
+{
+	BenchmarkDPath(settings, results);
+
+	status_t status = BenchmarkStatCache(settings, results);
+	if (status != B_OK)
+	{
+		fprintf(stderr, B_TRANSLATE("Couldn't create the StatCache test files in %s\n"),
+				settings.folder.String());
+		return status;
+	}
+
+	BenchmarkErrorParser(settings, results);
+
+	status = BenchmarkTextFile(settings, results);
+	if (status != B_OK)
+	{
+		fprintf(stderr, B_TRANSLATE("Couldn't load the generated project file in %s\n"),
+				settings.folder.String());
+	}
+
+	return status;
+}
+
+
+int
+RunBenchmarks(const BenchmarkSettings &settings)
+{
+	BObjectList<BenchmarkResult> results(20, true);
+
+	// Keep the environment deterministic: no ccache, no fastdep and no
+	// project saves from inside the builder
+	gUseCCache = false;
+	gUseFastDep = false;
+	gUseJSONDiagnostics = false;
+	gBuildMode = true;
+	sCountAllocations = settings.countAllocations;
+
+	bool runBuild = settings.suite != "micro";
+	bool runMicro = settings.suite != "build";
+
+	status_t status = B_OK;
+	if (runBuild)
+		status = RunBuildBenchmarks(settings, results);
+	if (runMicro && status == B_OK)
+		status = RunMicroBenchmarks(settings, results);
+
+	BString json;
+	json << "{\n\t\"benchmark\": \"" << settings.suite << "\",\n"
+		<< "\t\"status\": \"" << (status == B_OK ? "ok" : "failed") << "\",\n"
+		<< "\t\"threads\": " << (gSingleThreadedBuild ? 1 : (int32)gCPUCount) << ",\n";
+	if (runBuild)
+	{
+		int32 fileCount = settings.sourceCount + settings.lexCount + settings.yaccCount
+						+ settings.rdefCount;
+		for (int32 i = 0; sSpellingSources[i][0] != NULL; i++)
+			fileCount++;
+		json << "\t\"project\": { \"files\": " << fileCount
+			<< ", \"sources\": " << settings.sourceCount
+			<< ", \"headers\": " << settings.headerCount
+			<< ", \"fanout\": " << settings.includeFanout
+			<< ", \"groups\": " << settings.groupCount
+			<< ", \"lex\": " << settings.lexCount
+			<< ", \"yacc\": " << settings.yaccCount
+			<< ", \"rdef\": " << settings.rdefCount << " },\n";
+	}
+	if (runMicro)
+	{
+		json << "\t\"micro\": { \"paths\": " << settings.pathCount
+			<< ", \"log_mb\": " << settings.logMegabytes
+			<< ", \"pld_lines\": " << settings.pldLines
+			<< ", \"stat_lookups\": " << settings.statLookups << " },\n";
+	}
+	json << "\t\"results\": [\n";
+	for (int32 i = 0; i < results.CountItems(); i++)
+		AppendResult(json, *results.ItemAt(i), i == results.CountItems() - 1);
+	json << "\t]\n}\n";
+
+	if (settings.output.CountChars() > 0)
+	{
+		if (WriteTextFile(DPath(settings.output.String()), json) != B_OK)
+		{
+			fprintf(stderr, B_TRANSLATE("Couldn't write benchmark results to %s\n"),
+					settings.output.String());
+			return -1;
+		}
+	}
+	else
+		printf("%s", json.String());
+
+	return status == B_OK ? 0 : -1;
+}
@@ -0,0 +1,39 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <String.h>
+#include <SupportDefs.h>
+
+// Settings for the command-line benchmark mode (Paladin -p key=value ...)
+class BenchmarkSettings
+{
+public:
+						BenchmarkSettings(void);
+
+			status_t	ParseArgument(const char *arg);
+
+			int32		sourceCount;
+			int32		headerCount;
+			int32		includeFanout;
+			int32		groupCount;
+			int32		lexCount;
+			int32		yaccCount;
+			int32		rdefCount;
+			int32		runs;
+
+			// Inputs for the micro-benchmarks of the utility classes
+			int32		pathCount;
+			int32		logMegabytes;
+			int32		pldLines;
+			int32		statLookups;
+			bool		countAllocations;
+
+			BString		suite;
+			BString		folder;
+			BString		output;
+};
+
+int			RunBenchmarks(const BenchmarkSettings &settings);
+void		PrintBenchmarkUsage(void);
+
+#endif
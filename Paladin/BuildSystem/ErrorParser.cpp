@@ -2,13 +2,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <ctype.h>
+#include <algorithm>
 #include <OS.h>
 
 error_msg::error_msg(void)
 	:	line(-1),
 		column(-1),
-		type(-1)
+		type(-1),
+		parent(0),
+		count(1)
 {
 }
 
@@ -42,6 +47,7 @@ ErrorList::ErrorList(const char *string)
 	:	msglist(20,true),
 		fIndex(0)
 {
+	ResetIndex();
 }
 
 
@@ -49,6 +55,7 @@ ErrorList::ErrorList(const ErrorList &from)
 	:	msglist(20,true),
 		fIndex(0)
 {
+	ResetIndex();
 	*this = from;
 }
 
@@ -61,7 +68,7 @@ ErrorList::~ErrorList(void)
 ErrorList &
 ErrorList::operator=(const ErrorList &from)
 {
-	msglist.MakeEmpty();
+	MakeEmpty();
 	Append(from);
 	return *this;
 }
@@ -80,125 +87,297 @@ ErrorList::Append(const ErrorList &from)
 }
 
 
-int32
-ErrorList::CountWarnings(void)
+static bool
+MakeKey(const error_msg &msg, BString &key)
 {
-	int32 count = 0;
-	for (int32 i = 0; i < msglist.CountItems(); i++)
+	// Only warnings and errors which point at a spot in a file are folded.
+	// Notes and context lines mean something only next to what they explain.
+	if (msg.parent != 0 || msg.line < 0 || msg.path.Length() == 0)
+		return false;
+	if (msg.type != ERROR_WARNING && msg.type != ERROR_ERROR)
+		return false;
+	
+	key.SetTo(msg.path);
+	key << "\n" << msg.line << "\n" << msg.column << "\n" << (int32)msg.type
+		<< "\n" << msg.error;
+	return true;
+}
+
+
+static void
+FoldInto(error_msg &into, const error_msg &from)
+{
+	if (from.origins.Length() == 0)
 	{
-		error_msg *msg = (error_msg*)msglist.ItemAt(i);
-		if (msg->type == ERROR_ERROR)
-			continue;
-		if (msg->type == ERROR_NOTE)
-			continue;
-		if (msg->type == ERROR_UNKNOWN)
-			continue;
+		into.count += from.count;
+		return;
+	}
+	
+	BString known("|");
+	known << into.origins << "|";
+	
+	const char *origin = from.origins.String();
+	while (*origin)
+	{
+		const char *end = strchr(origin, '|');
+		int32 length = end ? end - origin : strlen(origin);
 		
-		if (msg->type == ERROR_MSG)
+		BString name;
+		name.SetTo(origin, length);
+		BString needle("|");
+		needle << name << "|";
+		if (length > 0 && known.FindFirst(needle) < 0)
 		{
-			int32 index = i + 1;
-			
-			error_msg *next = (error_msg*)msglist.ItemAt(index);
-			while (next && next->type == ERROR_MSG)
-			{
-				index++;
-				next = (error_msg*)msglist.ItemAt(index);
-			}
-			
-			if (next && next->type == ERROR_ERROR)
-				continue;
+			if (into.origins.Length() > 0)
+				into.origins << "|";
+			into.origins << name;
+			known << name << "|";
+			into.count++;
 		}
-		count++;
+		
+		origin += length;
+		if (*origin == '|')
+			origin++;
 	}
-	return count;
 }
 
 
-error_msg *
-ErrorList::GetNextWarning(void)
+void
+ErrorList::Merge(const ErrorList &from)
 {
-	error_msg *msg = NULL;
-	for (int32 i = fIndex; i < msglist.CountItems(); i++)
+	// Like Append, but a diagnostic already in the list is counted instead of
+	// added again. The context lines leading up to it, which are either
+	// linked to it or messages, and the notes which belong to it are dropped
+	// along with it.
+	UpdateIndex();
+	
+	int32 fromCount = from.msglist.CountItems();
+	std::vector<int32> placed(fromCount, -1);
+	int32 runStart = -1;
+	
+	for (int32 i = 0; i <= fromCount; i++)
 	{
-		error_msg *item = (error_msg*)msglist.ItemAt(i);
-		
-		if (item->type == ERROR_ERROR)
-			continue;
-		if (item->type == ERROR_NOTE)
+		error_msg *msg = (i < fromCount) ? from.msglist.ItemAt(i) : NULL;
+		if (msg && (msg->parent < 0
+				|| (msg->type == ERROR_MSG && msg->parent == 0)))
+		{
+			if (runStart < 0)
+				runStart = i;
 			continue;
-		if (item->type == ERROR_UNKNOWN)
+		}
+		
+		bool folded = false;
+		if (msg && msg->parent > 0)
+		{
+			int32 owner = i - msg->parent;
+			folded = owner >= 0 && placed[owner] < 0;
+		}
+		else if (msg)
+		{
+			BString key;
+			std::map<BString, int32>::iterator existing = fKeys.end();
+			if (MakeKey(*msg, key))
+				existing = fKeys.find(key);
+			if (existing != fKeys.end())
+			{
+				FoldInto(*msglist.ItemAt(existing->second), *msg);
+				folded = true;
+			}
+		}
+		
+		int32 contextStart = runStart;
+		if (runStart >= 0)
+		{
+			for (int32 j = runStart; j < i && !folded; j++)
+			{
+				error_msg *newmsg = new error_msg(*from.msglist.ItemAt(j));
+				placed[j] = msglist.CountItems();
+				msglist.AddItem(newmsg);
+			}
+			runStart = -1;
+		}
+		
+		if (!msg || folded)
 			continue;
 		
-		if (item->type == ERROR_MSG)
+		error_msg *newmsg = new error_msg(*msg);
+		placed[i] = msglist.CountItems();
+		if (msg->parent > 0)
 		{
-			int32 index = i + 1;
-			
-			error_msg *next = (error_msg*)msglist.ItemAt(index);
-			while (next && next->type == ERROR_MSG)
+			int32 owner = i - msg->parent;
+			newmsg->parent = (owner >= 0) ? placed[i] - placed[owner] : 0;
+		}
+		msglist.AddItem(newmsg);
+		
+		// Point the context lines at where their diagnostic ended up
+		for (int32 j = contextStart; contextStart >= 0 && j < i; j++)
+		{
+			int32 parent = from.msglist.ItemAt(j)->parent;
+			if (parent < 0)
 			{
-				index++;
-				next = (error_msg*)msglist.ItemAt(index);
+				msglist.ItemAt(placed[j])->parent = (j - parent == i)
+					? placed[j] - placed[i] : 0;
 			}
-			
-			if (next && next->type == ERROR_ERROR)
-				continue;
 		}
-		msg = item;
-		fIndex = i + 1;
-		break;
+		
+		// Index as we go so that duplicates within from are folded, too
+		UpdateIndex();
 	}
-	return msg;
+	UpdateIndex();
 }
 
 
-int32
-ErrorList::CountErrors(void)
+void
+ErrorList::MakeEmpty(void)
+{
+	msglist.MakeEmpty();
+	Rewind();
+	ResetIndex();
+}
+
+
+void
+ErrorList::SetOrigin(const char *origin)
 {
-	int32 count = 0;
+	if (!origin || !*origin)
+		return;
+	
 	for (int32 i = 0; i < msglist.CountItems(); i++)
 	{
-		error_msg *msg = (error_msg*)msglist.ItemAt(i);
-		if (msg->type == ERROR_ERROR)
-			count++;
+		error_msg *msg = msglist.ItemAt(i);
+		if (msg->origins.Length() == 0)
+			msg->origins = origin;
 	}
-	return count;
 }
 
 
-error_msg *
-ErrorList::GetNextError(void)
+void
+ErrorList::ResetIndex(void)
+{
+	fKeys.clear();
+	fWarningItems.clear();
+	fErrorItems.clear();
+	fErrorCount = 0;
+	fIndexedCount = 0;
+	fLastIndexed = NULL;
+	fMessageRun = -1;
+}
+
+
+void
+ErrorList::UpdateIndex(void)
 {
-	error_msg *msg = NULL;
-	for (int32 i = fIndex; i < msglist.CountItems(); i++)
+	int32 count = msglist.CountItems();
+	if (count < fIndexedCount
+		|| (fIndexedCount > 0 && msglist.ItemAt(fIndexedCount - 1) != fLastIndexed))
+		ResetIndex();
+	
+	for (int32 i = fIndexedCount; i < count; i++)
 	{
-		error_msg *item = (error_msg*)msglist.ItemAt(i);
+		error_msg *msg = msglist.ItemAt(i);
 		
-		if (item->type == ERROR_WARNING)
-			continue;
-		if (item->type == ERROR_NOTE)
-			continue;
-		if (item->type == ERROR_UNKNOWN)
+		if (msg->type == ERROR_MSG)
+		{
+			if (fMessageRun < 0)
+				fMessageRun = i;
 			continue;
+		}
 		
-		if (item->type == ERROR_MSG)
+		// A run of messages belongs to the warning or error which follows
+		// it. When anything else follows, it shows up as both.
+		if (fMessageRun >= 0)
 		{
-			int32 index = i + 1;
-			
-			error_msg *next = (error_msg*)msglist.ItemAt(index);
-			while (next && next->type == ERROR_MSG)
+			for (int32 j = fMessageRun; j < i; j++)
 			{
-				index++;
-				next = (error_msg*)msglist.ItemAt(index);
+				if (msg->type != ERROR_ERROR)
+					fWarningItems.push_back(j);
+				if (msg->type != ERROR_WARNING)
+					fErrorItems.push_back(j);
 			}
-			
-			if (next && next->type == ERROR_WARNING)
-				continue;
+			fMessageRun = -1;
+		}
+		
+		switch (msg->type)
+		{
+			case ERROR_WARNING:
+				fWarningItems.push_back(i);
+				break;
+			case ERROR_ERROR:
+				fErrorItems.push_back(i);
+				fErrorCount++;
+				break;
+			case ERROR_NOTE:
+			case ERROR_UNKNOWN:
+				break;
+			default:
+				fWarningItems.push_back(i);
+				fErrorItems.push_back(i);
+				break;
 		}
-		msg = item;
-		fIndex = i + 1;
-		break;
+		
+		BString key;
+		if (MakeKey(*msg, key))
+			fKeys.insert(std::make_pair(key, i));
 	}
-	return msg;
+	
+	fIndexedCount = count;
+	fLastIndexed = count > 0 ? msglist.ItemAt(count - 1) : NULL;
+}
+
+
+error_msg *
+ErrorList::NextIndexed(const std::vector<int32> &items)
+{
+	std::vector<int32>::const_iterator next = std::lower_bound(items.begin(),
+		items.end(), fIndex);
+	
+	int32 index = -1;
+	if (next != items.end())
+		index = *next;
+	else if (fMessageRun >= 0)
+		index = fIndex > fMessageRun ? fIndex : fMessageRun;
+	
+	if (index < 0 || index >= msglist.CountItems())
+		return NULL;
+	
+	fIndex = index + 1;
+	return msglist.ItemAt(index);
+}
+
+
+int32
+ErrorList::CountWarnings(void)
+{
+	UpdateIndex();
+	
+	int32 count = fWarningItems.size();
+	if (fMessageRun >= 0)
+		count += msglist.CountItems() - fMessageRun;
+	return count;
+}
+
+
+error_msg *
+ErrorList::GetNextWarning(void)
+{
+	UpdateIndex();
+	return NextIndexed(fWarningItems);
+}
+
+
+int32
+ErrorList::CountErrors(void)
+{
+	UpdateIndex();
+	return fErrorCount;
+}
+
+
+error_msg *
+ErrorList::GetNextError(void)
+{
+	UpdateIndex();
+	return NextIndexed(fErrorItems);
 }
 
 
@@ -229,6 +408,10 @@ ErrorList::Flatten(BMessage &msg)
 		msg.AddString("error",error->error);
 		msg.AddInt8("type",error->type);
 		msg.AddString("rawdata",error->rawdata);
+		msg.AddInt32("parent",error->parent);
+		msg.AddInt32("count",error->count);
+		msg.AddString("origins",error->origins);
+		msg.AddString("library",error->library);
 	}
 }
 
@@ -236,8 +419,7 @@ ErrorList::Flatten(BMessage &msg)
 void
 ErrorList::Unflatten(BMessage &msg)
 {
-	msglist.MakeEmpty();
-	Rewind();
+	MakeEmpty();
 	
 	type_code code;
 	int32 count;
@@ -269,6 +451,18 @@ ErrorList::Unflatten(BMessage &msg)
 		if (msg.FindString("error",i,&error->error) != B_OK)
 			error->error = "";
 		
+		if (msg.FindInt32("parent",i,&error->parent) != B_OK)
+			error->parent = 0;
+		
+		if (msg.FindInt32("count",i,&error->count) != B_OK)
+			error->count = 1;
+		
+		if (msg.FindString("origins",i,&error->origins) != B_OK)
+			error->origins = "";
+		
+		if (msg.FindString("library",i,&error->library) != B_OK)
+			error->library = "";
+		
 		// every error_msg item MUST have a type
 		if (msg.FindInt8("type",i,&error->type) != B_OK)
 		{
@@ -294,178 +488,387 @@ ErrorList::AsString(void)
 }
 
 
-void
-ParseGCCErrors(const char *string, ErrorList &list)
+// Returns the next non-empty line of a tool's output and moves the cursor
+// past it. The line is not terminated -- it is a view into the original
+// buffer, so nothing is copied until a parser decides to keep it.
+static const char *
+NextLine(const char *&cursor, int32 &length)
 {
-	list.msglist.MakeEmpty();
-	if (!string)
-		return;
+	while (*cursor == '\n')
+		cursor++;
 	
-	int32 length = strlen(string);
-	if (length < 1)
-		return;
+	if (*cursor == '\0')
+		return NULL;
 	
-	char *data = new char[length + 1];
-	sprintf(data,"%s",string);
+	const char *start = cursor;
+	const char *eol = strchr(start, '\n');
+	if (!eol)
+		eol = start + strlen(start);
 	
-	char *item = strtok(data,"\n");
-	while (item)
+	length = eol - start;
+	cursor = eol;
+	return start;
+}
+
+
+// Reads the decimal number at start and returns how many digits it had
+static int32
+ScanNumber(const char *start, const char *end, int32 &value)
+{
+	const char *c = start;
+	value = 0;
+	while (c < end && isdigit((unsigned char)*c))
 	{
-		error_msg *msg = new error_msg;
-		msg->rawdata = item;
-		list.msglist.AddItem(msg);
-		item = strtok(NULL,"\n");
+		value = value * 10 + (*c - '0');
+		c++;
 	}
+	return c - start;
+}
+
+
+static const char *
+FindNoCase(const char *start, const char *end, const char *pattern)
+{
+	int32 patternLength = strlen(pattern);
+	char first = tolower((unsigned char)pattern[0]);
+	for (const char *c = start; end - c >= patternLength; c++)
+	{
+		if (tolower((unsigned char)*c) == first
+			&& strncasecmp(c, pattern, patternLength) == 0)
+			return c;
+	}
+	return NULL;
+}
+
+
+static bool
+SpanContainsNoCase(const char *start, const char *end, const char *pattern)
+{
+	return FindNoCase(start, end, pattern) != NULL;
+}
+
+
+// Whether a line of gcc's output tells where the diagnostic after it comes
+// from rather than being one itself
+static bool
+IsContextLine(const char *line, const char *lineEnd)
+{
+	const char *start = line;
+	while (start < lineEnd && isspace((unsigned char)*start))
+		start++;
+	
+	if (SpanContainsNoCase(line, lineEnd, "note:"))
+		return false;
+	
+	int32 length = lineEnd - start;
+	if ((length > 22 && strncmp(start, "In file included from ", 22) == 0)
+		|| (start > line && length > 5 && strncmp(start, "from ", 5) == 0))
+		return true;
+	
+	static const char *sMarkers[] = {
+		": In ",
+		": At global scope:",
+		": At top level:",
+		": required from ",
+		":   required from ",
+		":   required by ",
+		":   recursively required ",
+		NULL
+	};
+	for (int32 i = 0; sMarkers[i]; i++)
+	{
+		int32 markerLength = strlen(sMarkers[i]);
+		for (const char *c = line; lineEnd - c >= markerLength; c++)
+		{
+			if (*c == ':' && strncmp(c, sMarkers[i], markerLength) == 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+
+// A line of gcc's output as it is scanned: views into the output and what
+// was read from them, without anything copied yet
+struct gcc_line
+{
+	const char	*start;
+	int32		length;
 	
+	// Offsets into the line, -1 when there is no path or no message
+	int32		pathLength;
+	int32		errorOffset;
+	
+	int32		line;
+	int32		column;
+	int8		type;
+	int32		parent;
+};
+
+
+// Whether an item like line can be folded with an identical one, the way
+// ErrorList::Merge does it
+static bool
+IsFoldable(const gcc_line &line)
+{
+	return line.parent == 0 && line.line >= 0 && line.pathLength > 0
+		&& line.errorOffset >= 0
+		&& (line.type == ERROR_WARNING || line.type == ERROR_ERROR);
+}
+
+
+static int
+CompareSpans(const char *a, int32 aLength, const char *b, int32 bLength)
+{
+	int result = memcmp(a, b, MIN(aLength, bLength));
+	if (result != 0)
+		return result;
+	return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+}
+
+
+// Compares foldable lines by everything ErrorList::Merge folds them by
+static int
+CompareFoldKeys(const gcc_line &x, const gcc_line &y)
+{
+	int result = CompareSpans(x.start, x.pathLength, y.start, y.pathLength);
+	if (result == 0 && x.line != y.line)
+		result = x.line < y.line ? -1 : 1;
+	if (result == 0 && x.column != y.column)
+		result = x.column < y.column ? -1 : 1;
+	if (result == 0 && x.type != y.type)
+		result = x.type < y.type ? -1 : 1;
+	if (result == 0)
+	{
+		result = CompareSpans(x.start + x.errorOffset, x.length - x.errorOffset,
+			y.start + y.errorOffset, y.length - y.errorOffset);
+	}
+	return result;
+}
+
+
+// Sorts the indexes of foldable lines so that identical ones end up next to
+// each other, in the order they came in
+struct gcc_line_order
+{
+	const std::vector<gcc_line> &lines;
+	
+	gcc_line_order(const std::vector<gcc_line> &lines_)
+		:	lines(lines_)
+	{
+	}
+	
+	bool operator()(int32 a, int32 b) const
+	{
+		int result = CompareFoldKeys(lines[a], lines[b]);
+		return result != 0 ? result < 0 : a < b;
+	}
+};
+
+
+void
+ParseGCCErrors(const char *string, ErrorList &list)
+{
+	list.MakeEmpty();
+	if (!string)
+		return;
+	
+	// Lines are classified as they are scanned, so the whole output is walked
+	// exactly once. Nothing is copied until it is known which lines the error
+	// window will show.
+	std::vector<gcc_line> lines;
 	int8 errorPrev = ERROR_UNSET;
-	for (int32 i = 0; i < list.msglist.CountItems(); i++)
+	int32 contextStart = -1;
+	const char *cursor = string;
+	const char *start;
+	int32 length;
+	while ((start = NextLine(cursor, length)) != NULL)
 	{
-		error_msg *msg = (error_msg*)list.msglist.ItemAt(i);
-		
-		if (msg->rawdata.CountChars() < 1)
-			continue;
+		gcc_line current;
+		current.start = start;
+		current.length = length;
+		current.pathLength = -1;
+		current.errorOffset = -1;
+		current.line = -1;
+		current.column = -1;
+		current.type = ERROR_UNSET;
+		current.parent = 0;
+		int32 index = lines.size();
+		bool diagnostic = false;
 		
-		int32 startpos = 0;
-		int32 endpos = msg->rawdata.FindFirst(":");
-		if (B_ERROR != endpos) 
+		const char *lineEnd = start + length;
+		const char *colon = (const char*)memchr(start, ':', length);
+		if (colon)
 		{
-			msg->rawdata.CopyInto(msg->path, startpos, endpos);
-		
+			int32 endpos = colon - start;
+			current.pathLength = endpos;
+			
 			// Now we have to do a little fancy guesswork
-			if (isdigit(msg->rawdata[endpos + 1]))
+			if (endpos + 1 < length && isdigit((unsigned char)start[endpos + 1]))
 			{
-				startpos = endpos;
-				
-				BString temp;
-				int32 numberIndex = startpos + 1;
-				while (isdigit(msg->rawdata[numberIndex]))
-				{
-					temp += msg->rawdata[numberIndex];
-					numberIndex++;
-					if (numberIndex >= msg->rawdata.CountChars())
-						break;
-				}
-				msg->line = atol(temp.String());
-				endpos += temp.CountChars();
+				endpos += ScanNumber(start + endpos + 1, lineEnd, current.line);
 				
 				// now check for column number too
-				startpos = endpos;
-				endpos = msg->rawdata.FindFirst(":",startpos);
-				if (B_ERROR != endpos)
+				colon = (const char*)memchr(start + endpos, ':', length - endpos);
+				if (colon)
 				{
-					// Now we have to do a little fancy guesswork
-					if (isdigit(msg->rawdata[endpos + 1]))
-					{
-						int32 startposcol = endpos;
-				
-						temp = "";
-						numberIndex = startposcol + 1;
-						while (isdigit(msg->rawdata[numberIndex]))
-						{
-							temp += msg->rawdata[numberIndex];
-							numberIndex++;
-							if (numberIndex >= msg->rawdata.CountChars())
-								break;
-						}
-						msg->column = atol(temp.String());
-						endpos += temp.CountChars();
-					}
-					else
-						msg->column = -1;
+					endpos = colon - start;
+					if (endpos + 1 < length && isdigit((unsigned char)start[endpos + 1]))
+						endpos += ScanNumber(start + endpos + 1, lineEnd, current.column);
 				}
 			}
-			else
-				msg->line = -1;
 			
 			// adding 2 instead of one because there is always a space after the final 
 			// colon in the event there is an error message, which is usually
-			if (endpos + 2 < msg->rawdata.CountChars()) {
-				msg->error = msg->rawdata.String() + endpos + 2;
+			const char *errorStart = NULL;
+			if (endpos + 2 < length)
+			{
+				errorStart = start + endpos + 2;
+				current.errorOffset = endpos + 2;
 			}
-		
-			if ((msg->line < 0 && msg->error.IFindFirst("error") < 0) ||
-				(msg->error.CountChars() < 1)) {
+			
+			if (!errorStart || (current.line < 0
+					&& !SpanContainsNoCase(errorStart, lineEnd, "error"))) {
 				// first line
 				if (-1 != errorPrev) {
-					msg->type = errorPrev;
+					current.type = errorPrev;
 				} else {
-					msg->type = ERROR_NOTE;
+					current.type = ERROR_NOTE;
 				}
-			} else if (msg->rawdata.IFindFirst("warning:") >= 0) {
-				msg->type = ERROR_WARNING;
-			} else if (msg->rawdata.IFindFirst("error:") >= 0) {
-				msg->type = ERROR_ERROR;
-			} else if (msg->rawdata.IFindFirst("note:") >= 0 &&
-					   msg->rawdata.IFindFirst("In ") >= 0) {
+			} else if (SpanContainsNoCase(start, lineEnd, "warning:")) {
+				current.type = ERROR_WARNING;
+				diagnostic = true;
+			} else if (SpanContainsNoCase(start, lineEnd, "error:")) {
+				current.type = ERROR_ERROR;
+				diagnostic = true;
+			} else if (SpanContainsNoCase(start, lineEnd, "note:") &&
+					   SpanContainsNoCase(start, lineEnd, "In ")) {
 				if (-1 != errorPrev) {
-					msg->type = errorPrev;
+					current.type = errorPrev;
 				} else {
-					msg->type = ERROR_NOTE;
+					current.type = ERROR_NOTE;
 				}
 			} else {
 				// if not known, mark as previous or unknown
 				if (ERROR_UNSET != errorPrev) {
-					msg->type = errorPrev;
+					current.type = errorPrev;
 				} else {
-					msg->type = ERROR_UNKNOWN;
+					current.type = ERROR_UNKNOWN;
 				}
 			}
 		} // end null endpos if	
-		errorPrev = msg->type;
+		errorPrev = current.type;
+		
+		// The context lines leading up to a warning or error belong to it, so
+		// they go wherever it goes and are folded along with it
+		if (diagnostic)
+		{
+			for (int32 i = contextStart; contextStart >= 0 && i < index; i++)
+			{
+				lines[i].parent = i - index;
+				lines[i].type = ERROR_NOTE;
+			}
+			contextStart = -1;
+		}
+		else if (IsContextLine(start, lineEnd))
+		{
+			if (contextStart < 0)
+				contextStart = index;
+		}
+		else
+			contextStart = -1;
+		
+		lines.push_back(current);
+	}
+	
+	// gcc repeats a diagnostic in a header for every instantiation or
+	// inclusion which runs into it. The error window folds the repeats away
+	// together with the context lines leading up to them, so they aren't
+	// made into items in the first place.
+	std::vector<int32> foldable;
+	for (int32 i = 0; i < (int32)lines.size(); i++)
+	{
+		if (IsFoldable(lines[i]))
+			foldable.push_back(i);
+	}
+	
+	std::vector<bool> dropped(lines.size(), false);
+	std::sort(foldable.begin(), foldable.end(), gcc_line_order(lines));
+	for (size_t i = 1; i < foldable.size(); i++)
+	{
+		int32 repeat = foldable[i];
+		if (CompareFoldKeys(lines[foldable[i - 1]], lines[repeat]) != 0)
+			continue;
+		
+		dropped[repeat] = true;
+		for (int32 j = repeat - 1; j >= 0 && j - lines[j].parent == repeat; j--)
+			dropped[j] = true;
 	}
 	
-	delete [] data;
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		if (dropped[i])
+			continue;
+		
+		const gcc_line &line = lines[i];
+		error_msg *msg = new error_msg;
+		msg->rawdata.SetTo(line.start, line.length);
+		if (line.pathLength >= 0)
+			msg->path.SetTo(line.start, line.pathLength);
+		if (line.errorOffset >= 0)
+		{
+			msg->error.SetTo(line.start + line.errorOffset,
+				line.length - line.errorOffset);
+		}
+		msg->line = line.line;
+		msg->column = line.column;
+		msg->type = line.type;
+		msg->parent = line.parent;
+		list.msglist.AddItem(msg);
+	}
 }
 
 
 void
 ParseLDErrors(const char *string, ErrorList &list)
 {
-	list.msglist.MakeEmpty();
+	list.MakeEmpty();
 	if (!string)
 		return;
-
-	int32 length = strlen(string);
-	if (length < 1)
-		return;
 	
-	char *data = new char[length + 1];
-	sprintf(data,"%s",string);
-	
-	char *item = strtok(data,"\n");
-	while (item)
+	int8 errorPrev = ERROR_UNSET;
+	const char *cursor = string;
+	const char *line;
+	int32 length;
+	while ((line = NextLine(cursor, length)) != NULL)
 	{
 		error_msg *msg = new error_msg;
-		msg->rawdata = item;
+		msg->rawdata.SetTo(line, length);
 		list.msglist.AddItem(msg);
-		item = strtok(NULL,"\n");
-	}
-	
-	int8 errorPrev = ERROR_UNSET;
-	for (int32 i = 0; i < list.msglist.CountItems(); i++)
-	{
-		error_msg *msg = (error_msg*)list.msglist.ItemAt(i);
 		
-		if (msg->rawdata.CountChars() < 1)
-			continue;
-		
-		int32 startpos = 0;
-		int32 endpos = msg->rawdata.FindFirst(":");
-		if (endpos > startpos)
-			msg->rawdata.CopyInto(msg->path,startpos,endpos);
+		const char *lineEnd = line + length;
+		const char *errorStart = line;
+		const char *colon = (const char*)memchr(line, ':', length);
+		if (colon)
+		{
+			if (colon > line)
+				msg->path.SetTo(line, colon - line);
+			
+			// adding 2 instead of one because there is always a space after the
+			// final colon
+			errorStart = MIN(colon + 2, lineEnd);
+		}
+		msg->error.SetTo(errorStart, lineEnd - errorStart);
 		
 		// The linker doesn't use line numbers
 		msg->line = -1;
 		msg->column = -1;
 		
-		// adding 2 instead of one because there is always a space after the final colon
-		msg->error = msg->rawdata.String() + endpos + 2;
-		
-		if (msg->error.IFindFirst("warning:") >= 0) {
+		if (SpanContainsNoCase(errorStart, lineEnd, "warning:")) {
 			msg->type = ERROR_WARNING;
-		} else if (msg->error.IFindFirst("error:") >= 0) {
+		} else if (SpanContainsNoCase(errorStart, lineEnd, "error:")) {
 			msg->type = ERROR_ERROR;
-		} else if (msg->error.IFindFirst("undefined") >= 0) {
+		} else if (SpanContainsNoCase(errorStart, lineEnd, "undefined")) {
 			msg->type = ERROR_ERROR;
 		} else {
 			if (ERROR_UNSET != errorPrev) {
@@ -477,14 +880,37 @@ ParseLDErrors(const char *string, ErrorList &list)
 			
 		errorPrev = msg->type;
 	}
-	delete [] data;
+}
+
+
+bool
+ParseUndefinedReference(const char *error, BString &symbol)
+{
+	static const char kPrefix[] = "undefined reference to ";
+	
+	const char *start = strstr(error, kPrefix);
+	if (!start)
+		return false;
+	
+	// Older linkers quote with `', newer ones with ''
+	start += sizeof(kPrefix) - 1;
+	if (*start != '`' && *start != '\'')
+		return false;
+	start++;
+	
+	const char *end = strrchr(start, '\'');
+	if (!end || end == start)
+		return false;
+	
+	symbol.SetTo(start, end - start);
+	return true;
 }
 
 
 void
 ParseRCErrors(const char *string, ErrorList &list)
 {
-	list.msglist.MakeEmpty();
+	list.MakeEmpty();
 	if (!string)
 		return;
 
@@ -499,7 +925,7 @@ ParseRCErrors(const char *string, ErrorList &list)
 void
 ParseLexErrors(const char *string, ErrorList &list)
 {
-	list.msglist.MakeEmpty();
+	list.MakeEmpty();
 	if (!string)
 		return;
 
@@ -514,7 +940,7 @@ ParseLexErrors(const char *string, ErrorList &list)
 void
 ParseYaccErrors(const char *string, ErrorList &list)
 {
-	list.msglist.MakeEmpty();
+	list.MakeEmpty();
 	if (!string)
 		return;
 
@@ -529,102 +955,81 @@ ParseYaccErrors(const char *string, ErrorList &list)
 void
 ParseRezErrors(const char *string, ErrorList &list)
 {
-	list.msglist.MakeEmpty();
+	list.MakeEmpty();
 	if (!string)
 		return;
-
-	int32 length = strlen(string);
-	if (length < 1)
-		return;
 	
-	char *data = new char[length + 1];
-	sprintf(data,"%s",string);
-	
-	char *item = strtok(data,"\n");
-	error_msg *msg = NULL;
-	while (item)
+	// Rez gives where an error is on a line of its own, like
+	// File "foo.r"; Line 12, so each line is made into an item as it is
+	// scanned
+	const char *cursor = string;
+	const char *line;
+	int32 length;
+	while ((line = NextLine(cursor, length)) != NULL)
 	{
-		if (strstr(item,"### Rez") != item && strstr(item,"#----") != item)
-		{
-			msg = new error_msg;
-			msg->rawdata = item;
-			list.msglist.AddItem(msg);
-		}
-		item = strtok(NULL,"\n");
-	}
-	
-	for (int32 i = 0; i < list.msglist.CountItems(); i++)
-	{
-		msg = (error_msg*)list.msglist.ItemAt(i);
-		
-		if (msg->rawdata.CountChars() < 1)
+		if (strncmp(line, "### Rez", 7) == 0 || strncmp(line, "#----", 5) == 0)
 			continue;
 		
-		int32 startpos = 0;
-		int32 endpos = 0;
-		
-		msg->column = -1;
+		error_msg *msg = new error_msg;
+		msg->rawdata.SetTo(line, length);
+		list.msglist.AddItem(msg);
 		
-		if (msg->rawdata.FindFirst("File \"") == 0)
+		const char *lineEnd = line + length;
+		const char *errorStart = line;
+		if (length >= 6 && strncmp(line, "File \"", 6) == 0)
 		{
-			startpos = 6;
-			endpos = msg->rawdata.FindFirst("\"",startpos);
-			msg->rawdata.CopyInto(msg->path,startpos,endpos - startpos);
-			
-			startpos = msg->rawdata.FindFirst("\";");
-			if (startpos > 0)
+			const char *pathStart = line + 6;
+			const char *quote = (const char*)memchr(pathStart, '"',
+				lineEnd - pathStart);
+			if (quote)
 			{
-				startpos++;
-				startpos = msg->rawdata.IFindFirst("Line ");
-				if (startpos > 0)
-					msg->line = atol(msg->rawdata.String() + startpos + 5);
+				msg->path.SetTo(pathStart, quote - pathStart);
+				
+				const char *number = NULL;
+				if (quote + 1 < lineEnd && quote[1] == ';')
+					number = FindNoCase(quote, lineEnd, "Line ");
+				if (number)
+					ScanNumber(number + 5, lineEnd, msg->line);
 			}
+			
+			// The message is on the next line
+			errorStart = lineEnd;
 		}
 		else
 		{
-			msg->error = msg->rawdata;
+			msg->error.SetTo(line, length);
 			msg->line = 0;
 		}
 		
-		
-		if (msg->line < 0 && msg->error.IFindFirst("error") < 0)
+		if (msg->line < 0 && !SpanContainsNoCase(errorStart, lineEnd, "error"))
 			msg->type = ERROR_MSG;
-		else if (msg->error.IFindFirst("warning:") >= 0)
+		else if (SpanContainsNoCase(errorStart, lineEnd, "warning:"))
 			msg->type = ERROR_WARNING;
-		else if (msg->error.IFindFirst("note:") >= 0)
+		else if (SpanContainsNoCase(errorStart, lineEnd, "note:"))
 			msg->type = ERROR_NOTE;
-		else if (msg->error.IFindFirst("error:") >= 0)
+		else if (SpanContainsNoCase(errorStart, lineEnd, "error:"))
 			msg->type = ERROR_ERROR;
 		else
 			msg->type = ERROR_UNKNOWN;
 	}
-	delete [] data;
 }
 
 
 void
 ParseIntoLines(const char *string, ErrorList &list)
 {
-	list.msglist.MakeEmpty();
+	list.MakeEmpty();
 	if (!string)
 		return;
 
-	int32 length = strlen(string);
-	if (length < 1)
-		return;
-	
-	char *data = new char[length + 1];
-	sprintf(data,"%s",string);
-	
-	char *item = strtok(data,"\n");
-	while (item)
+	const char *cursor = string;
+	const char *item;
+	int32 length;
+	while ((item = NextLine(cursor, length)) != NULL)
 	{
 		error_msg *msg = new error_msg;
-		msg->rawdata = item;
+		msg->rawdata.SetTo(item, length);
 		msg->type = ERROR_MSG;
 		list.msglist.AddItem(msg);
-		item = strtok(NULL,"\n");
 	}
-	
-	delete [] data;
 }
@@ -8,6 +8,9 @@
 #include <Locker.h>
 #include <String.h>
 
+#include <map>
+#include <vector>
+
 enum ERRORS {
 	ERROR_UNSET = -1,
 	ERROR_MSG = 0,
@@ -29,6 +32,22 @@ public:
 	BString	error;
 	int8	type;
 	BString	rawdata;
+	
+	// How many items back in the list the diagnostic this one belongs to is,
+	// such as the error a note or fix-it explains. Negative for the context
+	// lines leading up to a diagnostic, like "In file included from", which
+	// point ahead at it. 0 for top-level items.
+	int32	parent;
+	
+	// Identical diagnostics from different files, like a warning in a
+	// widely-included header, are folded into one item by ErrorList::Merge.
+	// origins holds the '|'-separated names of the files that reported it.
+	int32	count;
+	BString	origins;
+	
+	// For a note on an undefined reference, a library which defines the
+	// missing symbol. The error window offers to add it to the project.
+	BString	library;
 };
 
 class ErrorList : public BLocker
@@ -40,6 +59,10 @@ public:
 			ErrorList &		operator=(const ErrorList &from);
 			
 			void			Append(const ErrorList &from);
+			void			Merge(const ErrorList &from);
+			void			MakeEmpty(void);
+			
+			void			SetOrigin(const char *origin);
 			
 			int32			CountWarnings(void);
 			error_msg *		GetNextWarning(void);
@@ -59,10 +82,27 @@ public:
 	BObjectList<error_msg>	msglist;
 
 private:
+			void			UpdateIndex(void);
+			void			ResetIndex(void);
+			error_msg *		NextIndexed(const std::vector<int32> &items);
+	
 			int32		fIndex;
+	
+	// Items in msglist are indexed lazily up to fIndexedCount, so code that
+	// adds to msglist directly still gets correct answers. A run of
+	// ERROR_MSG items counts as warnings or errors depending on what follows
+	// it, so the run at the end of the list stays pending in fMessageRun.
+	std::map<BString, int32>	fKeys;
+	std::vector<int32>			fWarningItems;
+	std::vector<int32>			fErrorItems;
+			int32		fErrorCount;
+			int32		fIndexedCount;
+			error_msg *	fLastIndexed;
+			int32		fMessageRun;
 };
 
 void	ParseGCCErrors(const char *string, ErrorList &list);
+void	ParseGCCJSONErrors(const char *string, ErrorList &list);
 void	ParseLDErrors(const char *string, ErrorList &list);
 void	ParseRCErrors(const char *string, ErrorList &list);
 void	ParseLexErrors(const char *string, ErrorList &list);
@@ -70,4 +110,7 @@ void	ParseYaccErrors(const char *string, ErrorList &list);
 void	ParseRezErrors(const char *string, ErrorList &list);
 void	ParseIntoLines(const char *string, ErrorList &list);
 
+// Gets the symbol out of a linker "undefined reference to `symbol'" error
+bool	ParseUndefinedReference(const char *error, BString &symbol);
+
 #endif
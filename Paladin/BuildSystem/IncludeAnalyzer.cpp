@@ -0,0 +1,640 @@
+#include "IncludeAnalyzer.h"
+
+#include <ctype.h>
+#include <Entry.h>
+#include <File.h>
+#include <Path.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "BuildInfo.h"
+#include "DebugTools.h"
+#include "Project.h"
+#include "SourceFile.h"
+
+enum
+{
+	BRACE_SCOPE = 0,
+	BRACE_ENUM,
+	BRACE_BODY
+};
+
+typedef struct
+{
+	BString	text;
+	bool	identifier;
+} token;
+
+
+static bool
+IsKeyword(const BString &word)
+{
+	static const char *sKeywords[] = {
+		"__attribute__", "alignas", "alignof", "asm", "auto", "bool", "break",
+		"case", "catch", "char", "class", "const", "const_cast", "constexpr",
+		"continue", "decltype", "default", "delete", "do", "double",
+		"dynamic_cast", "else", "enum", "explicit", "export", "extern", "false",
+		"final", "float", "for", "friend", "goto", "if", "inline", "int", "long",
+		"mutable", "namespace", "new", "noexcept", "nullptr", "operator",
+		"override", "private", "protected", "public", "register",
+		"reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+		"static_assert", "static_cast", "struct", "switch", "template", "this",
+		"throw", "true", "try", "typedef", "typeid", "typename", "union",
+		"unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while"
+	};
+	static std::set<BString> sKeywordSet(sKeywords,
+		sKeywords + sizeof(sKeywords) / sizeof(sKeywords[0]));
+
+	return sKeywordSet.find(word) != sKeywordSet.end();
+}
+
+
+static bool
+IsIdentifierStart(char c)
+{
+	return isalpha((unsigned char)c) || c == '_';
+}
+
+
+static bool
+IsIdentifierChar(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+
+static bool
+ReadFile(const char *path, BString &text)
+{
+	BFile file(path, B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK)
+		return false;
+
+	char *buffer = text.LockBuffer(size + 1);
+	ssize_t bytesRead = file.Read(buffer, size);
+	text.UnlockBuffer(bytesRead > 0 ? bytesRead : 0);
+	return bytesRead >= 0;
+}
+
+
+// Adds every identifier in a preprocessor line to the referenced names, so
+// that macros used in conditions or in other macros count as used
+static void
+ReferenceIdentifiers(const char *start, const char *end,
+					std::set<BString> &referenced)
+{
+	const char *c = start;
+	while (c < end)
+	{
+		if (IsIdentifierStart(*c))
+		{
+			const char *wordStart = c;
+			while (c < end && IsIdentifierChar(*c))
+				c++;
+			referenced.insert(BString(wordStart, c - wordStart));
+		}
+		else if (isdigit((unsigned char)*c))
+		{
+			while (c < end && IsIdentifierChar(*c))
+				c++;
+		}
+		else
+			c++;
+	}
+}
+
+
+static void
+ScanDirective(const char *start, const char *end, int32 line,
+			std::vector<BString> &includeNames, std::vector<int32> &includeLines,
+			std::set<BString> &declared, std::set<BString> &referenced)
+{
+	const char *c = start + 1;
+	while (c < end && isspace((unsigned char)*c))
+		c++;
+
+	const char *wordStart = c;
+	while (c < end && IsIdentifierChar(*c))
+		c++;
+	BString directive(wordStart, c - wordStart);
+
+	while (c < end && isspace((unsigned char)*c))
+		c++;
+
+	if (directive == "include")
+	{
+		// Only quoted includes are ours to judge
+		if (c < end && *c == '"')
+		{
+			const char *nameEnd = (const char *)memchr(c + 1, '"', end - c - 1);
+			if (nameEnd != NULL)
+			{
+				includeNames.push_back(BString(c + 1, nameEnd - c - 1));
+				includeLines.push_back(line);
+			}
+		}
+		return;
+	}
+
+	if (directive == "define" && c < end && IsIdentifierStart(*c))
+	{
+		wordStart = c;
+		while (c < end && IsIdentifierChar(*c))
+			c++;
+		declared.insert(BString(wordStart, c - wordStart));
+	}
+
+	ReferenceIdentifiers(c, end, referenced);
+}
+
+
+// Splits a file into tokens, leaving out comments, literals and preprocessor
+// lines, which are handled on the spot
+static void
+Tokenize(const BString &text, std::vector<token> &tokens,
+		std::vector<BString> &includeNames, std::vector<int32> &includeLines,
+		std::set<BString> &declared, std::set<BString> &referenced)
+{
+	const char *c = text.String();
+	const char *end = c + text.Length();
+	int32 line = 1;
+	bool lineStart = true;
+
+	while (c < end)
+	{
+		if (*c == '\n')
+		{
+			line++;
+			lineStart = true;
+			c++;
+			continue;
+		}
+
+		if (isspace((unsigned char)*c))
+		{
+			c++;
+			continue;
+		}
+
+		if (*c == '#' && lineStart)
+		{
+			// Take in continued lines, too
+			const char *directiveEnd = c;
+			int32 directiveLine = line;
+			while (directiveEnd < end)
+			{
+				if (*directiveEnd == '\n')
+				{
+					if (directiveEnd > c && directiveEnd[-1] == '\\')
+						line++;
+					else
+						break;
+				}
+				directiveEnd++;
+			}
+
+			ScanDirective(c, directiveEnd, directiveLine, includeNames,
+						includeLines, declared, referenced);
+			c = directiveEnd;
+			continue;
+		}
+
+		lineStart = false;
+
+		if (*c == '/' && c + 1 < end && c[1] == '/')
+		{
+			while (c < end && *c != '\n')
+				c++;
+			continue;
+		}
+
+		if (*c == '/' && c + 1 < end && c[1] == '*')
+		{
+			c += 2;
+			while (c < end && !(*c == '*' && c + 1 < end && c[1] == '/'))
+			{
+				if (*c == '\n')
+					line++;
+				c++;
+			}
+			c += 2;
+			continue;
+		}
+
+		if (*c == '"' || *c == '\'')
+		{
+			char quote = *c++;
+			while (c < end && *c != quote && *c != '\n')
+			{
+				if (*c == '\\' && c + 1 < end)
+					c++;
+				c++;
+			}
+			c++;
+
+			token literal = { BString("0"), false };
+			tokens.push_back(literal);
+			continue;
+		}
+
+		if (IsIdentifierStart(*c))
+		{
+			const char *wordStart = c;
+			while (c < end && IsIdentifierChar(*c))
+				c++;
+
+			token word = { BString(wordStart, c - wordStart), true };
+			referenced.insert(word.text);
+			tokens.push_back(word);
+			continue;
+		}
+
+		if (isdigit((unsigned char)*c))
+		{
+			while (c < end && (IsIdentifierChar(*c) || *c == '.'))
+				c++;
+
+			token number = { BString("0"), false };
+			tokens.push_back(number);
+			continue;
+		}
+
+		// Keep scope qualifiers apart from the colons of labels and bases
+		token punctuation = { BString(c, 1), false };
+		if (*c == ':' && c + 1 < end && c[1] == ':')
+			punctuation.text = "::";
+		c += punctuation.text.Length();
+		tokens.push_back(punctuation);
+	}
+}
+
+
+// Picks out the names declared at namespace and class scope. Function bodies
+// and initializers are skipped; what they refer to is already in the
+// referenced names.
+static void
+FindDeclarations(const std::vector<token> &tokens, std::set<BString> &declared)
+{
+	std::vector<int8> braces;
+	int32 parenDepth = 0;
+	int32 angleDepth = 0;
+	bool sawType = false;
+	bool sawEnum = false;
+	bool sawNamespace = false;
+	bool sawEquals = false;
+	bool sawTypedef = false;
+
+	int32 count = tokens.size();
+	for (int32 i = 0; i < count; i++)
+	{
+		const token &current = tokens[i];
+		const BString &text = current.text;
+		bool inScope = braces.empty() || braces.back() != BRACE_BODY;
+
+		if (!current.identifier)
+		{
+			bool endStatement = false;
+			if (text == "(")
+				parenDepth++;
+			else if (text == ")")
+				parenDepth = std::max((int32)0, parenDepth - 1);
+			else if (text == "<" && inScope && parenDepth == 0)
+				angleDepth++;
+			else if (text == ">" && inScope && parenDepth == 0)
+				angleDepth = std::max((int32)0, angleDepth - 1);
+			else if (text == "=")
+				sawEquals = true;
+			else if (text == "{")
+			{
+				int8 kind = BRACE_BODY;
+				if (inScope && sawEnum)
+					kind = BRACE_ENUM;
+				else if (inScope && (sawType || sawNamespace) && !sawEquals
+						&& parenDepth == 0)
+					kind = BRACE_SCOPE;
+				braces.push_back(kind);
+				endStatement = true;
+			}
+			else if (text == "}")
+			{
+				if (!braces.empty())
+					braces.pop_back();
+				endStatement = true;
+			}
+			else if (text == ";")
+				endStatement = true;
+
+			if (endStatement)
+			{
+				parenDepth = angleDepth = 0;
+				sawType = sawEnum = sawNamespace = sawEquals = sawTypedef = false;
+			}
+			continue;
+		}
+
+		if (!inScope)
+			continue;
+
+		const BString &next = i + 1 < count ? tokens[i + 1].text : BString();
+
+		if (text == "class" || text == "struct" || text == "union"
+			|| text == "enum")
+		{
+			sawType = true;
+			if (text == "enum")
+				sawEnum = true;
+
+			// Only definitions and forward declarations name a type here,
+			// not "struct stat st" or template parameters
+			if (i + 1 < count && tokens[i + 1].identifier && !IsKeyword(next))
+			{
+				int32 after = i + 2;
+				if (after < count && tokens[after].text == "final")
+					after++;
+				if (after < count && (tokens[after].text == "{"
+					|| tokens[after].text == ":" || tokens[after].text == ";"))
+					declared.insert(next);
+			}
+			continue;
+		}
+
+		if (text == "namespace" || text == "extern")
+		{
+			sawNamespace = true;
+			continue;
+		}
+
+		if (text == "typedef")
+		{
+			sawTypedef = true;
+			continue;
+		}
+
+		if (text == "using")
+		{
+			if (i + 2 < count && tokens[i + 1].identifier
+				&& tokens[i + 2].text == "=")
+				declared.insert(next);
+			continue;
+		}
+
+		if (IsKeyword(text))
+			continue;
+
+		if (braces.size() > 0 && braces.back() == BRACE_ENUM)
+		{
+			if (i > 0 && (tokens[i - 1].text == "{" || tokens[i - 1].text == ","))
+				declared.insert(text);
+			continue;
+		}
+
+		// Function pointer typedefs
+		if (sawTypedef && i > 0 && tokens[i - 1].text == "*" && next == ")")
+		{
+			declared.insert(text);
+			continue;
+		}
+
+		if (parenDepth > 0 || angleDepth > 0 || (sawType && !sawTypedef))
+			continue;
+
+		// Functions, members and globals
+		if (next == "(" || next == ";" || next == "=" || next == "["
+			|| next == "," || next == ":")
+			declared.insert(text);
+	}
+}
+
+
+IncludeAnalyzer::IncludeAnalyzer(Project *project)
+	:	fProject(project),
+		fFile(NULL),
+		fAverageTime(1000000)
+{
+	int32 timedCount = 0;
+	bigtime_t totalTime = 0;
+	for (int32 i = 0; i < fProject->CountGroups(); i++)
+	{
+		SourceGroup *group = fProject->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			if (file->UsesBuild() && file->CompileTime() > 0)
+			{
+				timedCount++;
+				totalTime += file->CompileTime();
+			}
+		}
+	}
+
+	if (timedCount > 0)
+		fAverageTime = totalTime / timedCount;
+}
+
+
+IncludeAnalyzer::~IncludeAnalyzer(void)
+{
+	for (std::map<BString, header_info *>::iterator i = fHeaders.begin();
+			i != fHeaders.end(); i++)
+		delete i->second;
+}
+
+
+int32
+IncludeAnalyzer::FindUnused(SourceFile *file, std::vector<unused_include> &list)
+{
+	fFile = file;
+	BString path(file->GetPath().GetFullPath());
+
+	BString text;
+	if (!ReadFile(path.String(), text))
+		return 0;
+
+	scan_info source;
+	std::vector<token> tokens;
+	std::vector<BString> includeNames;
+	std::vector<int32> includeLines;
+	Tokenize(text, tokens, includeNames, includeLines, source.declared,
+			source.referenced);
+	source.size = text.Length();
+
+	// Resolve the includes and gather what each one pulls in
+	int32 includeCount = includeNames.size();
+	std::vector<BString> includePaths(includeCount);
+	std::vector<std::set<BString> > closures(includeCount);
+	std::set<BString> allFiles;
+	for (int32 i = 0; i < includeCount; i++)
+	{
+		includePaths[i] = Resolve(file, file->GetPath().GetFolder(),
+								includeNames[i].String());
+		if (includePaths[i].Length() == 0)
+			continue;
+
+		GetClosure(includePaths[i], closures[i]);
+		allFiles.insert(closures[i].begin(), closures[i].end());
+	}
+
+	off_t totalSize = source.size;
+	for (std::set<BString>::iterator i = allFiles.begin(); i != allFiles.end(); i++)
+	{
+		header_info *header = Header(*i);
+		if (header != NULL)
+			totalSize += header->scan.size;
+	}
+
+	bigtime_t compileTime = file->CompileTime() > 0 ? file->CompileTime()
+													: fAverageTime;
+
+	int32 found = 0;
+	for (int32 i = 0; i < includeCount; i++)
+	{
+		if (includePaths[i].Length() == 0)
+			continue;
+
+		std::set<BString> declared;
+		for (std::set<BString>::iterator j = closures[i].begin();
+				j != closures[i].end(); j++)
+		{
+			header_info *header = Header(*j);
+			if (header != NULL)
+				declared.insert(header->scan.declared.begin(),
+								header->scan.declared.end());
+		}
+
+		bool used = false;
+		for (std::set<BString>::iterator j = declared.begin();
+				j != declared.end() && !used; j++)
+			used = source.referenced.find(*j) != source.referenced.end();
+
+		// Headers included next to this one may lean on it, too
+		for (int32 other = 0; other < includeCount && !used; other++)
+		{
+			if (other == i)
+				continue;
+
+			for (std::set<BString>::iterator j = closures[other].begin();
+					j != closures[other].end() && !used; j++)
+			{
+				header_info *header = Header(*j);
+				if (header == NULL || closures[i].find(*j) != closures[i].end())
+					continue;
+
+				for (std::set<BString>::iterator k = declared.begin();
+						k != declared.end() && !used; k++)
+					used = header->scan.referenced.find(*k)
+							!= header->scan.referenced.end();
+			}
+		}
+
+		if (used)
+			continue;
+
+		// Only the headers nothing else brings in would drop out of the build
+		off_t savedSize = 0;
+		for (std::set<BString>::iterator j = closures[i].begin();
+				j != closures[i].end(); j++)
+		{
+			bool shared = false;
+			for (int32 other = 0; other < includeCount && !shared; other++)
+				shared = other != i && closures[other].find(*j) != closures[other].end();
+
+			header_info *header = Header(*j);
+			if (!shared && header != NULL)
+				savedSize += header->scan.size;
+		}
+
+		unused_include unused;
+		unused.name = includeNames[i];
+		unused.path = includePaths[i];
+		unused.line = includeLines[i];
+		unused.savings = totalSize > 0
+			? (bigtime_t)((double)compileTime * savedSize / totalSize) : 0;
+		list.push_back(unused);
+		found++;
+	}
+
+	fFile = NULL;
+
+	STRACE(2,("Found %ld unused includes in %s\n", (long)found, path.String()));
+	return found;
+}
+
+
+IncludeAnalyzer::header_info *
+IncludeAnalyzer::Header(const BString &path)
+{
+	std::map<BString, header_info *>::iterator i = fHeaders.find(path);
+	if (i != fHeaders.end())
+		return i->second;
+
+	header_info *header = NULL;
+	BString text;
+	if (ReadFile(path.String(), text))
+	{
+		header = new header_info;
+		std::vector<token> tokens;
+		std::vector<BString> includeNames;
+		std::vector<int32> includeLines;
+		Tokenize(text, tokens, includeNames, includeLines,
+				header->scan.declared, header->scan.referenced);
+		FindDeclarations(tokens, header->scan.declared);
+		header->scan.size = text.Length();
+
+		DPath headerPath(path);
+		for (size_t j = 0; j < includeNames.size(); j++)
+		{
+			BString includePath = Resolve(fFile, headerPath.GetFolder(),
+										includeNames[j].String());
+			if (includePath.Length() > 0)
+				header->includePaths.push_back(includePath);
+		}
+	}
+
+	fHeaders[path] = header;
+	return header;
+}
+
+
+BString
+IncludeAnalyzer::Resolve(SourceFile *file, const BString &folder,
+						const char *name)
+{
+	BString path(name);
+	if (path.Length() == 0)
+		return path;
+
+	if (path[0] != '/')
+		path.Prepend("/").Prepend(folder);
+
+	// Normalize so that each header gets scanned only once
+	BPath normalized(path.String(), NULL, true);
+	if (normalized.InitCheck() == B_OK && BEntry(normalized.Path()).Exists())
+		return BString(normalized.Path());
+
+	DPath dependency = file->FindDependency(*fProject->GetBuildInfo(), name);
+	if (dependency.IsEmpty())
+		return BString();
+
+	normalized.SetTo(dependency.GetFullPath(), NULL, true);
+	if (normalized.InitCheck() == B_OK)
+		return BString(normalized.Path());
+
+	return BString(dependency.GetFullPath());
+}
+
+
+void
+IncludeAnalyzer::GetClosure(const BString &path, std::set<BString> &files)
+{
+	if (!files.insert(path).second)
+		return;
+
+	header_info *header = Header(path);
+	if (header == NULL)
+		return;
+
+	for (size_t i = 0; i < header->includePaths.size(); i++)
+		GetClosure(header->includePaths[i], files);
+}
@@ -0,0 +1,73 @@
+#ifndef INCLUDE_ANALYZER_H
+#define INCLUDE_ANALYZER_H
+
+#include <OS.h>
+#include <String.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+class Project;
+class SourceFile;
+
+typedef struct
+{
+	BString		name;
+	BString		path;
+	int32		line;
+
+	// Rough share of the file's compile time spent on the headers which
+	// only come in through this include
+	bigtime_t	savings;
+} unused_include;
+
+// Finds the quoted includes of a source file which it doesn't use anything
+// from. This is a lexical check rather than a compiler pass: each header is
+// scanned once for the names it declares at namespace and class scope --
+// macros, types, enumerators, functions, members and globals -- and for the
+// names it refers to. An include counts as used when the source refers to a
+// name declared by the header or by anything the header includes in turn,
+// or when one of the source's other includes does, since removing it would
+// then break a header which relies on being included after it. System
+// includes are left alone.
+class IncludeAnalyzer
+{
+public:
+							IncludeAnalyzer(Project *project);
+							~IncludeAnalyzer(void);
+
+			int32			FindUnused(SourceFile *file,
+										std::vector<unused_include> &list);
+
+private:
+	struct scan_info
+	{
+		std::set<BString>			declared;
+		std::set<BString>			referenced;
+		off_t						size;
+	};
+
+	struct header_info
+	{
+		scan_info				scan;
+		std::vector<BString>	includePaths;
+	};
+
+			// Headers are kept by their normalized path, which is what
+			// Resolve() returns, however they were included
+			header_info *	Header(const BString &path);
+			BString			Resolve(SourceFile *file, const BString &folder,
+									const char *name);
+			void			GetClosure(const BString &path,
+										std::set<BString> &files);
+
+	Project *							fProject;
+	SourceFile *						fFile;
+	std::map<BString, header_info *>	fHeaders;
+
+	// The compile time a file is estimated at when it hasn't been timed yet
+	bigtime_t							fAverageTime;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "InternedPath.h"
+
+#include <Autolock.h>
+#include <Locker.h>
+
+typedef std::map<BString, DPath> path_table;
+
+// Files are added from the window thread while the build threads read
+// paths, so lookups are serialized. Entries themselves never change once
+// they are in the table, so reading one needs no lock. Both are created on
+// first use so that static InternedPaths elsewhere don't depend on the order
+// of static initialization.
+static BLocker &
+TableLock(void)
+{
+	static BLocker sLock("interned_paths");
+	return sLock;
+}
+
+
+static path_table &
+Table(void)
+{
+	static path_table sTable;
+	return sTable;
+}
+
+
+InternedPath::InternedPath(void)
+	:	fEntry(Intern(NULL))
+{
+}
+
+
+InternedPath::InternedPath(const char *path)
+	:	fEntry(Intern(path))
+{
+}
+
+
+InternedPath::InternedPath(const BString &path)
+	:	fEntry(Intern(path.String()))
+{
+}
+
+
+InternedPath &
+InternedPath::operator=(const char *path)
+{
+	fEntry = Intern(path);
+	return *this;
+}
+
+
+InternedPath &
+InternedPath::operator=(const BString &path)
+{
+	fEntry = Intern(path.String());
+	return *this;
+}
+
+
+const InternedPath::entry *
+InternedPath::Intern(const char *path)
+{
+	BAutolock lock(TableLock());
+	
+	path_table &table = Table();
+	BString key(path);
+	path_table::iterator i = table.find(key);
+	if (i == table.end())
+		i = table.insert(std::make_pair(key, DPath(key))).first;
+	
+	return &(*i);
+}
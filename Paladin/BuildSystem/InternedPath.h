@@ -0,0 +1,45 @@
+#ifndef INTERNED_PATH_H
+#define INTERNED_PATH_H
+
+#include <String.h>
+
+#include <map>
+#include <utility>
+
+#include "DPath.h"
+
+// A handle to an immutable path kept in a process-wide table. Each distinct
+// path string is taken apart by DPath once, and every InternedPath for it
+// shares that copy, so handing out the string or the DPath is a reference
+// and copying a handle is a pointer copy. Entries are never freed, which is
+// fine for the bounded set of file and include paths of open projects, but
+// makes this the wrong choice for throwaway paths.
+class InternedPath
+{
+public:
+							InternedPath(void);
+							InternedPath(const char *path);
+							InternedPath(const BString &path);
+	
+			InternedPath &	operator=(const char *path);
+			InternedPath &	operator=(const BString &path);
+			
+			// Equal strings are interned to the same entry
+			bool			operator==(const InternedPath &other) const
+								{ return fEntry == other.fEntry; }
+			bool			operator!=(const InternedPath &other) const
+								{ return fEntry != other.fEntry; }
+			
+			const BString &	String(void) const { return fEntry->first; }
+			const DPath &	Path(void) const { return fEntry->second; }
+			bool			IsEmpty(void) const { return fEntry->first.Length() == 0; }
+	
+private:
+	typedef std::pair<const BString, DPath> entry;
+	
+	static	const entry *	Intern(const char *path);
+	
+			const entry *	fEntry;
+};
+
+#endif
@@ -0,0 +1,622 @@
+#include "ErrorParser.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Reads the output of gcc -fdiagnostics-format=json. The document is walked
+// once, front to back, and error_msg items are created as each diagnostic is
+// entered, so nothing resembling a DOM is ever built. Nested diagnostics and
+// fix-its become items of their own whose parent field points back at the
+// diagnostic they belong to.
+
+typedef struct
+{
+	BString	file;
+	int32	line;
+	int32	column;
+} json_location;
+
+
+typedef struct
+{
+	json_location	start;
+	json_location	next;
+	BString			text;
+} json_fixit;
+
+
+class JSONDiagnosticReader
+{
+public:
+						JSONDiagnosticReader(const char *start, ErrorList &list);
+
+			bool		Read(void);
+			const char *Position(void) const { return fPos; }
+
+private:
+			void		SkipSpace(void);
+			bool		Expect(char c);
+			bool		ReadString(BString *out);
+			bool		ReadNumber(int32 *out);
+			bool		SkipValue(void);
+
+			bool		ReadDiagnostic(int32 parent);
+			bool		ReadDiagnosticList(int32 parent);
+			bool		ReadLocations(json_location &caret);
+			bool		ReadLocation(json_location &location);
+			bool		ReadFixits(BObjectList<json_fixit> &fixits);
+
+			void		AddFixit(int32 parent, const json_fixit &fixit);
+
+	const char			*fPos;
+	ErrorList			&fList;
+	int32				fDepth;
+};
+
+
+static int8
+TypeForKind(const BString &kind)
+{
+	// Same words as in the text output, minus the colon: "fatal error",
+	// "sorry, unimplemented", "pedwarn" and so on
+	if (kind == "warning" || kind == "pedwarn" || kind == "anachronism")
+		return ERROR_WARNING;
+	if (kind == "note")
+		return ERROR_NOTE;
+	if (kind.FindFirst("error") >= 0 || kind.FindFirst("sorry") == 0)
+		return ERROR_ERROR;
+	return ERROR_UNKNOWN;
+}
+
+
+static void
+AppendLocation(BString &out, const json_location &location)
+{
+	if (location.file.Length() < 1)
+		return;
+
+	out << location.file << ":";
+	if (location.line >= 0)
+	{
+		out << location.line << ":";
+		if (location.column >= 0)
+			out << location.column << ":";
+	}
+	out << " ";
+}
+
+
+static void
+AppendUTF8(BString &out, uint32 code)
+{
+	char buffer[4];
+	int32 length;
+	if (code < 0x80)
+	{
+		buffer[0] = code;
+		length = 1;
+	}
+	else if (code < 0x800)
+	{
+		buffer[0] = 0xc0 | (code >> 6);
+		buffer[1] = 0x80 | (code & 0x3f);
+		length = 2;
+	}
+	else if (code < 0x10000)
+	{
+		buffer[0] = 0xe0 | (code >> 12);
+		buffer[1] = 0x80 | ((code >> 6) & 0x3f);
+		buffer[2] = 0x80 | (code & 0x3f);
+		length = 3;
+	}
+	else
+	{
+		buffer[0] = 0xf0 | (code >> 18);
+		buffer[1] = 0x80 | ((code >> 12) & 0x3f);
+		buffer[2] = 0x80 | ((code >> 6) & 0x3f);
+		buffer[3] = 0x80 | (code & 0x3f);
+		length = 4;
+	}
+	out.Append(buffer, length);
+}
+
+
+static bool
+ReadHex(const char *start, uint32 &code)
+{
+	code = 0;
+	for (int32 i = 0; i < 4; i++)
+	{
+		char c = start[i];
+		code <<= 4;
+		if (c >= '0' && c <= '9')
+			code |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			code |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			code |= c - 'A' + 10;
+		else
+			return false;
+	}
+	return true;
+}
+
+
+JSONDiagnosticReader::JSONDiagnosticReader(const char *start, ErrorList &list)
+	:	fPos(start),
+		fList(list),
+		fDepth(0)
+{
+}
+
+
+bool
+JSONDiagnosticReader::Read(void)
+{
+	return ReadDiagnosticList(-1);
+}
+
+
+void
+JSONDiagnosticReader::SkipSpace(void)
+{
+	while (*fPos == ' ' || *fPos == '\t' || *fPos == '\n' || *fPos == '\r')
+		fPos++;
+}
+
+
+bool
+JSONDiagnosticReader::Expect(char c)
+{
+	SkipSpace();
+	if (*fPos != c)
+		return false;
+	fPos++;
+	return true;
+}
+
+
+bool
+JSONDiagnosticReader::ReadString(BString *out)
+{
+	if (!Expect('"'))
+		return false;
+
+	while (true)
+	{
+		// Copy everything up to the next quote or escape in one go
+		const char *run = fPos;
+		while (*fPos && *fPos != '"' && *fPos != '\\')
+			fPos++;
+		if (out && fPos > run)
+			out->Append(run, fPos - run);
+
+		if (*fPos == '"')
+		{
+			fPos++;
+			return true;
+		}
+
+		if (*fPos != '\\')
+			return false;
+
+		fPos++;
+		char c = *fPos++;
+		switch (c)
+		{
+			case 'n':
+				c = '\n';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case '"':
+			case '\\':
+			case '/':
+				break;
+			case 'u':
+			{
+				uint32 code;
+				if (!ReadHex(fPos, code))
+					return false;
+				fPos += 4;
+
+				// Surrogate pairs come as two escapes in a row
+				if (code >= 0xd800 && code < 0xdc00 && fPos[0] == '\\'
+					&& fPos[1] == 'u')
+				{
+					uint32 low;
+					if (ReadHex(fPos + 2, low) && low >= 0xdc00 && low < 0xe000)
+					{
+						code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+						fPos += 6;
+					}
+				}
+				if (out)
+					AppendUTF8(*out, code);
+				continue;
+			}
+			default:
+				return false;
+		}
+		if (out)
+			out->Append(c, 1);
+	}
+}
+
+
+bool
+JSONDiagnosticReader::ReadNumber(int32 *out)
+{
+	SkipSpace();
+	const char *start = fPos;
+	if (*fPos == '-')
+		fPos++;
+	while (isdigit((unsigned char)*fPos))
+		fPos++;
+
+	if (fPos == start)
+		return false;
+
+	if (out)
+		*out = atol(start);
+
+	// Fractions and exponents aren't used for anything we read
+	while (*fPos == '.' || *fPos == 'e' || *fPos == 'E' || *fPos == '+'
+			|| *fPos == '-' || isdigit((unsigned char)*fPos))
+		fPos++;
+
+	return true;
+}
+
+
+bool
+JSONDiagnosticReader::SkipValue(void)
+{
+	SkipSpace();
+	switch (*fPos)
+	{
+		case '"':
+			return ReadString(NULL);
+		case '{':
+		{
+			fPos++;
+			if (Expect('}'))
+				return true;
+			do
+			{
+				if (!ReadString(NULL) || !Expect(':') || !SkipValue())
+					return false;
+			} while (Expect(','));
+			return Expect('}');
+		}
+		case '[':
+		{
+			fPos++;
+			if (Expect(']'))
+				return true;
+			do
+			{
+				if (!SkipValue())
+					return false;
+			} while (Expect(','));
+			return Expect(']');
+		}
+		case 't':
+			if (strncmp(fPos, "true", 4) != 0)
+				return false;
+			fPos += 4;
+			return true;
+		case 'f':
+			if (strncmp(fPos, "false", 5) != 0)
+				return false;
+			fPos += 5;
+			return true;
+		case 'n':
+			if (strncmp(fPos, "null", 4) != 0)
+				return false;
+			fPos += 4;
+			return true;
+		default:
+			return ReadNumber(NULL);
+	}
+}
+
+
+bool
+JSONDiagnosticReader::ReadDiagnosticList(int32 parent)
+{
+	if (!Expect('['))
+		return false;
+	if (Expect(']'))
+		return true;
+
+	do
+	{
+		if (!ReadDiagnostic(parent))
+			return false;
+	} while (Expect(','));
+
+	return Expect(']');
+}
+
+
+bool
+JSONDiagnosticReader::ReadDiagnostic(int32 parent)
+{
+	// Nothing gcc writes comes close to this, but a broken document shouldn't
+	// be able to blow the stack
+	if (fDepth > 32 || !Expect('{'))
+		return false;
+
+	// The item goes into the list before its children are read -- gcc puts
+	// "children" ahead of "message" -- so that they land right behind it
+	error_msg *msg = new error_msg;
+	int32 index = fList.msglist.CountItems();
+	fList.msglist.AddItem(msg);
+	if (parent >= 0)
+		msg->parent = index - parent;
+
+	BString kind, message, option;
+	json_location caret;
+	caret.line = -1;
+	caret.column = -1;
+	BObjectList<json_fixit> fixits(20, true);
+
+	fDepth++;
+	bool ok = true;
+	if (!Expect('}'))
+	{
+		do
+		{
+			BString key;
+			if (!ReadString(&key) || !Expect(':'))
+			{
+				ok = false;
+				break;
+			}
+
+			if (key == "kind")
+				ok = ReadString(&kind);
+			else if (key == "message")
+				ok = ReadString(&message);
+			else if (key == "option")
+				ok = ReadString(&option);
+			else if (key == "locations")
+				ok = ReadLocations(caret);
+			else if (key == "children")
+				ok = ReadDiagnosticList(index);
+			else if (key == "fixits")
+				ok = ReadFixits(fixits);
+			else
+				ok = SkipValue();
+		} while (ok && Expect(','));
+
+		ok = ok && Expect('}');
+	}
+	fDepth--;
+
+	if (!ok)
+		return false;
+
+	msg->path = caret.file;
+	msg->line = caret.line;
+	msg->column = caret.column;
+	msg->type = TypeForKind(kind);
+
+	msg->error << kind << ": " << message;
+	if (option.Length() > 0)
+		msg->error << " [" << option << "]";
+
+	AppendLocation(msg->rawdata, caret);
+	msg->rawdata << msg->error;
+
+	for (int32 i = 0; i < fixits.CountItems(); i++)
+		AddFixit(index, *fixits.ItemAt(i));
+
+	return true;
+}
+
+
+bool
+JSONDiagnosticReader::ReadLocations(json_location &caret)
+{
+	if (!Expect('['))
+		return false;
+	if (Expect(']'))
+		return true;
+
+	// Only the primary location is kept. The rest are secondary ranges
+	// that the text output only underlines.
+	bool first = true;
+	do
+	{
+		if (!Expect('{'))
+			return false;
+
+		if (!Expect('}'))
+		{
+			do
+			{
+				BString key;
+				if (!ReadString(&key) || !Expect(':'))
+					return false;
+
+				bool ok;
+				if (first && key == "caret")
+					ok = ReadLocation(caret);
+				else
+					ok = SkipValue();
+				if (!ok)
+					return false;
+			} while (Expect(','));
+
+			if (!Expect('}'))
+				return false;
+		}
+		first = false;
+	} while (Expect(','));
+
+	return Expect(']');
+}
+
+
+bool
+JSONDiagnosticReader::ReadLocation(json_location &location)
+{
+	location.line = -1;
+	location.column = -1;
+
+	if (!Expect('{'))
+		return false;
+	if (Expect('}'))
+		return true;
+
+	do
+	{
+		BString key;
+		if (!ReadString(&key) || !Expect(':'))
+			return false;
+
+		bool ok;
+		if (key == "file")
+			ok = ReadString(&location.file);
+		else if (key == "line")
+			ok = ReadNumber(&location.line);
+		else if (key == "column")
+			ok = ReadNumber(&location.column);
+		else
+			ok = SkipValue();
+		if (!ok)
+			return false;
+	} while (Expect(','));
+
+	return Expect('}');
+}
+
+
+bool
+JSONDiagnosticReader::ReadFixits(BObjectList<json_fixit> &fixits)
+{
+	if (!Expect('['))
+		return false;
+	if (Expect(']'))
+		return true;
+
+	do
+	{
+		if (!Expect('{'))
+			return false;
+
+		json_fixit *fixit = new json_fixit;
+		fixit->start.line = fixit->start.column = -1;
+		fixit->next.line = fixit->next.column = -1;
+		fixits.AddItem(fixit);
+
+		if (Expect('}'))
+			continue;
+
+		do
+		{
+			BString key;
+			if (!ReadString(&key) || !Expect(':'))
+				return false;
+
+			bool ok;
+			if (key == "start")
+				ok = ReadLocation(fixit->start);
+			else if (key == "next")
+				ok = ReadLocation(fixit->next);
+			else if (key == "string")
+				ok = ReadString(&fixit->text);
+			else
+				ok = SkipValue();
+			if (!ok)
+				return false;
+		} while (Expect(','));
+
+		if (!Expect('}'))
+			return false;
+	} while (Expect(','));
+
+	return Expect(']');
+}
+
+
+void
+JSONDiagnosticReader::AddFixit(int32 parent, const json_fixit &fixit)
+{
+	error_msg *msg = new error_msg;
+	int32 index = fList.msglist.CountItems();
+	fList.msglist.AddItem(msg);
+
+	msg->parent = index - parent;
+	msg->path = fixit.start.file;
+	msg->line = fixit.start.line;
+	msg->column = fixit.start.column;
+	msg->type = ERROR_NOTE;
+
+	bool empty = fixit.start.line == fixit.next.line
+				&& fixit.start.column == fixit.next.column;
+	if (fixit.text.Length() < 1)
+		msg->error << "fix-it: remove";
+	else if (empty)
+		msg->error << "fix-it: insert \"" << fixit.text << "\"";
+	else
+		msg->error << "fix-it: replace with \"" << fixit.text << "\"";
+
+	AppendLocation(msg->rawdata, fixit.start);
+	msg->rawdata << msg->error;
+}
+
+
+void
+ParseGCCJSONErrors(const char *string, ErrorList &list)
+{
+	list.MakeEmpty();
+	if (!string)
+		return;
+
+	// gcc writes the whole document on one line of its own. Anything around
+	// it came from somewhere else -- ccache, the assembler, a crashing cc1 --
+	// and goes through the text parser.
+	const char *start = string;
+	while (start && *start != '[')
+	{
+		start = strchr(start, '\n');
+		if (start)
+			start++;
+	}
+
+	if (!start)
+	{
+		ParseGCCErrors(string, list);
+		return;
+	}
+
+	JSONDiagnosticReader reader(start, list);
+	if (!reader.Read())
+	{
+		ParseGCCErrors(string, list);
+		return;
+	}
+
+	BString other(string, start - string);
+	other << reader.Position();
+	if (other.Length() > 0)
+	{
+		ErrorList extra;
+		ParseGCCErrors(other.String(), extra);
+		list.Append(extra);
+	}
+}
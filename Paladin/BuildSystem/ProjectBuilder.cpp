@@ -134,6 +134,11 @@ ProjectBuilder::BuildProject(Project *proj, int32 postbuild)
 		}
 	}
 	
+	// Checking may have filled in dependencies for the first time
+	proj->Lock();
+	proj->UpdateDependencyGraph();
+	proj->Unlock();
+	
 	if (saveproj)
 		fProject->Save();
 	
@@ -275,8 +280,12 @@ ProjectBuilder::DoPostBuild(void)
 
 
 void
-ProjectBuilder::SendErrorMessage(ErrorList &list)
+ProjectBuilder::SendErrorMessage(ErrorList &list, const char *origin)
 {
+	// The origin lets the receiving ErrorList tell which files reported the
+	// same diagnostic when it merges them
+	list.SetOrigin(origin);
+	
 	BMessage errmsg;
 	if (list.CountErrors() > 0)
 		errmsg.what = M_BUILD_FAILURE;
@@ -336,12 +345,13 @@ ProjectBuilder::BuildThread(void *data)
 		BTRACE(("Thread %ld is building file %s\n",thisThread,file->GetPath().GetFileName()));
 		
 		BuildInfo *info = proj->GetBuildInfo();
-		info->errorList.msglist.MakeEmpty();
+		info->errorList.MakeEmpty();
 		proj->PrecompileFile(file);
 		
 		if (info->errorList.msglist.CountItems() > 0)
 		{
-			parent->SendErrorMessage(info->errorList);
+			parent->SendErrorMessage(info->errorList,
+								file->GetPath().GetFileName());
 			
 			if (info->errorList.CountErrors() > 0)
 			{
@@ -362,7 +372,7 @@ ProjectBuilder::BuildThread(void *data)
 				return B_ERROR;
 			}
 			else
-				info->errorList.msglist.MakeEmpty();
+				info->errorList.MakeEmpty();
 		}
 		
 		if (parent->fManager.ThreadCheckQuit())
@@ -377,7 +387,8 @@ ProjectBuilder::BuildThread(void *data)
 		
 		if (info->errorList.msglist.CountItems() > 0)
 		{
-			parent->SendErrorMessage(info->errorList);
+			parent->SendErrorMessage(info->errorList,
+								file->GetPath().GetFileName());
 			
 			if (info->errorList.CountErrors() > 0)
 			{
@@ -398,7 +409,7 @@ ProjectBuilder::BuildThread(void *data)
 				return B_ERROR;
 			}
 			else
-				info->errorList.msglist.MakeEmpty();
+				info->errorList.MakeEmpty();
 		}
 		
 		msg.MakeEmpty();
@@ -485,18 +496,29 @@ ProjectBuilder::BuildThread(void *data)
 			
 			proj->Lock();
 			proj->Link();
+			ErrorList linkErrors(info->errorList);
+			info->errorList.MakeEmpty();
+			proj->Unlock();
 			
-			if (info->errorList.msglist.CountItems() > 0)
+			if (linkErrors.msglist.CountItems() > 0)
 			{
-				parent->SendErrorMessage(info->errorList);
+				// Telling where the missing symbols might be found reads the
+				// objects built since the last time, so the project is left
+				// unlocked for it
+				if (linkErrors.CountErrors() > 0)
+				{
+					proj->UpdateSymbolXref();
+					proj->AddLibraryNotes(linkErrors);
+				}
+				
+				parent->SendErrorMessage(linkErrors);
 				
-				if (info->errorList.CountErrors() > 0)
+				if (linkErrors.CountErrors() > 0)
 				{
 					parent->Lock();
 					parent->fIsLinking = false;
 					parent->fIsBuilding = false;
 					parent->Unlock();
-					proj->Unlock();
 					
 					parent->fManager.RemoveThread(thisThread);
 					parent->fManager.QuitAllThreads();
@@ -505,19 +527,14 @@ ProjectBuilder::BuildThread(void *data)
 					
 					return B_ERROR;
 				}
-				else
-					info->errorList.msglist.MakeEmpty();
 			}
 			
 			if (parent->fManager.ThreadCheckQuit())
 			{
 				BTRACE(("Thread %ld asked to quit after link\n",thisThread));
 				parent->fManager.RemoveThread(thisThread);
-				proj->Unlock();
 				return B_OK;
 			}
-			
-			proj->Unlock();
 		}
 		
 		// Now that the linking is done, we should add any resource files
@@ -568,12 +585,24 @@ ProjectBuilder::BuildThread(void *data)
 				
 				if (info->errorList.msglist.CountItems() > 0)
 				{
-					parent->SendErrorMessage(info->errorList);
-					info->errorList.msglist.MakeEmpty();
+					parent->SendErrorMessage(info->errorList,
+										file->GetPath().GetFileName());
+					info->errorList.MakeEmpty();
 				}
 			}
 		}
 		
+		// Only the objects which were just built are read again, which keeps
+		// looking for conflicting definitions cheap enough for every build
+		proj->UpdateSymbolXref();
+		proj->AddSymbolConflicts(info->errorList);
+		
+		if (info->errorList.msglist.CountItems() > 0)
+		{
+			parent->SendErrorMessage(info->errorList, proj->GetName());
+			info->errorList.MakeEmpty();
+		}
+		
 		parent->Lock();
 		parent->fIsLinking = false;
 		parent->fIsBuilding = false;
@@ -71,7 +71,8 @@ public:
 private:
 			void		DoBuild(void);
 			void		DoPostBuild(void);
-			void		SendErrorMessage(ErrorList &list);
+			void		SendErrorMessage(ErrorList &list,
+										const char *origin = NULL);
 	static	int32		BuildThread(void *data);
 	
 	BMessenger			fMsgr;
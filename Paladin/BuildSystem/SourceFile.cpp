@@ -11,7 +11,8 @@
 SourceFile::SourceFile(const char *path)
 	:	fNeedsBuild(BUILD_YES),
 		fType(TYPE_UNKNOWN),
-		fModTime(0)
+		fModTime(0),
+		fCompileTime(0)
 {
 	SetPath(path);
 }
@@ -20,7 +21,8 @@ SourceFile::SourceFile(const char *path)
 SourceFile::SourceFile(const entry_ref &ref)
 	:	fNeedsBuild(BUILD_YES),
 		fType(TYPE_UNKNOWN),
-		fModTime(0)
+		fModTime(0),
+		fCompileTime(0)
 {
 	BPath path(&ref);
 	SetPath(path.Path());
@@ -39,7 +41,7 @@ SourceFile::SetPath(const char *path)
 	
 	fNeedsBuild = BUILD_MAYBE;
 	
-	BString ext = fPath.GetExtension();
+	BString ext = fPath.Path().GetExtension();
 	if (ext == "cpp" || ext == "c" || ext == "cc" || ext == "cxx")
 		fType = TYPE_C;
 	else if (ext == "so" || ext == "a" || ext == "o")
@@ -57,10 +59,10 @@ SourceFile::SetPath(const char *path)
 }
 
 
-DPath
+const DPath &
 SourceFile::GetPath(void) const
 {
-	return fPath;
+	return fPath.Path();
 }
 
 
@@ -90,11 +92,11 @@ SourceFile::UpdateModTime(void)
 {
 /*
 	struct stat data;
-	if (stat(fPath.GetFullPath(),&data))
+	if (stat(fPath.Path().GetFullPath(),&data))
 		return;
 */
 	struct stat data;
-	GetStat(fPath.GetFullPath(),&data);
+	GetStat(fPath.Path().GetFullPath(),&data);
 	fModTime = data.st_mtime;
 }
 
@@ -104,7 +106,7 @@ SourceFile::GetModTime(void) const
 {
 //	return fModTime;
 	struct stat data;
-	GetStat(fPath.GetFullPath(),&data);
+	GetStat(fPath.Path().GetFullPath(),&data);
 	return data.st_mtime;
 }
 
@@ -127,22 +129,6 @@ SourceFile::UpdateDependencies(BuildInfo &info)
 }
 
 
-bool
-SourceFile::DependsOn(const char *path) const
-{
-	if (!path || fDependencies.CountChars() < 1)
-		return false;
-	
-	// strip absolute paths down to their filenames
-	BString pathstr(path);
-	int32 pos = pathstr.FindLast("/");
-	if (pos >= 0)
-		pathstr = path + pos + 1;
-	
-	return (fDependencies.FindFirst(pathstr) != B_ERROR) ? true : false;
-}
-
-
 DPath
 SourceFile::FindDependency(BuildInfo &info, const char *name)
 {
@@ -306,8 +292,8 @@ compare_source_files(const SourceFile *one, const SourceFile *two)
 	if (!one)
 		return 1;
 	
-	DPath pathone(one->GetPath());
-	DPath pathtwo(two->GetPath());
+	const DPath &pathone = one->GetPath();
+	const DPath &pathtwo = two->GetPath();
 	
 	if (!pathone.GetFileName())
 		return (pathtwo.GetFileName() != NULL) ? 1 : 0;
@@ -5,6 +5,7 @@
 
 #include "DPath.h"
 #include "ErrorParser.h"
+#include "InternedPath.h"
 #include "ObjectList.h"
 
 class BuildInfo;
@@ -37,7 +38,7 @@ public:
 	virtual				~SourceFile(void);
 						
 			void		SetPath(const char *path);
-			DPath		GetPath(void) const;
+			const DPath &GetPath(void) const;
 			
 			void		SetBuildFlag(const int8 &value);
 			int8		BuildFlag(void) const;
@@ -48,13 +49,17 @@ public:
 			void		UpdateModTime(void);
 			time_t		GetModTime(void) const;
 			
+			// How long the last successful compile of the file took, or 0
+			// if unknown
+			void		SetCompileTime(bigtime_t time) { fCompileTime = time; }
+			bigtime_t	CompileTime(void) const { return fCompileTime; }
+			
 	virtual	void		AddActionsItems(BMenu *menu);
 	virtual	int8		CountActions(void) const;
 	
 	virtual	void		UpdateDependencies(BuildInfo &info);
 	
 			const char *GetDependencies(void) const { return fDependencies.String(); }
-			bool		DependsOn(const char *path) const;
 			DPath		FindDependency(BuildInfo &info, const char *name);
 	
 	virtual	bool		CheckNeedsBuild(BuildInfo &info, bool check_deps = true);
@@ -77,11 +82,12 @@ protected:
 private:
 	friend class Project;
 	
-	DPath			fPath;
+	InternedPath	fPath;
 					
 	int8			fNeedsBuild;
 	SourceFileType	fType;
 	time_t			fModTime;
+	bigtime_t		fCompileTime;
 };
 
 
@@ -403,6 +403,10 @@ SourceFileC::Compile(BuildInfo &info, const char *options)
 	if (ext.ICompare("c") != 0)
 		compileString << "-Wno-ctor-dtor-privacy ";
 	
+	bool jsonDiagnostics = gUseJSONDiagnostics && gJSONDiagnosticsAvailable;
+	if (jsonDiagnostics)
+		compileString << "-fdiagnostics-format=json ";
+	
 	// We should put extra compiler options so that -W options actually work
 	if (options)
 		compileString << options;
@@ -415,7 +419,10 @@ SourceFileC::Compile(BuildInfo &info, const char *options)
 	STRACE(1,("Compiling %s\nCommand:%s\nOutput:%s\n",
 			abspath.String(),compileString.String(),errmsg.String()));
 	
-	ParseGCCErrors(errmsg.String(),info.errorList);
+	if (jsonDiagnostics)
+		ParseGCCJSONErrors(errmsg.String(),info.errorList);
+	else
+		ParseGCCErrors(errmsg.String(),info.errorList);
 }
 
 
@@ -0,0 +1,529 @@
+#include "ElfSymbols.h"
+
+#include <cxxabi.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+
+
+// Only the parts of the ELF format needed to get at the symbol tables
+enum {
+	ELF_CLASS_32		= 1,
+	ELF_CLASS_64		= 2,
+	ELF_DATA_LSB		= 1,
+	ELF_DATA_MSB		= 2,
+
+	ELF_TYPE_RELOCATABLE	= 1,
+
+	SECTION_SYMTAB		= 2,
+	SECTION_NOBITS		= 8,
+	SECTION_REL			= 9,
+	SECTION_DYNSYM		= 11,
+	SECTION_GROUP		= 17,
+
+	GROUP_COMDAT		= 0x1,
+
+	SECTION_WRITE		= 0x1,
+	SECTION_EXECUTE		= 0x4,
+
+	INDEX_UNDEFINED		= 0,
+	INDEX_ABSOLUTE		= 0xfff1,
+	INDEX_COMMON		= 0xfff2,
+
+	BIND_LOCAL			= 0,
+	BIND_WEAK			= 2,
+	BIND_UNIQUE			= 10,
+
+	TYPE_OBJECT			= 1,
+	TYPE_SECTION		= 3,
+	TYPE_FILE			= 4
+};
+
+static const char kArchiveMagic[] = "!<arch>\n";
+static const size_t kArchiveHeaderSize = 60;
+
+
+class ElfImage {
+public:
+	ElfImage(const uint8* data, size_t size)
+		:
+		fData(data),
+		fSize(size),
+		f64Bit(false),
+		fSwap(false)
+	{
+	}
+
+	bool Init()
+	{
+		if (fSize < 52 || memcmp(fData, "\x7f" "ELF", 4) != 0)
+			return false;
+		if (fData[4] != ELF_CLASS_32 && fData[4] != ELF_CLASS_64)
+			return false;
+
+		f64Bit = fData[4] == ELF_CLASS_64;
+		uint16 test = 1;
+		bool littleHost = *(const uint8*)&test == 1;
+		fSwap = (fData[5] == ELF_DATA_LSB) != littleHost;
+		return !f64Bit || fSize >= 64;
+	}
+
+	uint16 Read16(size_t offset) const
+	{
+		if (offset + 2 > fSize)
+			return 0;
+		uint16 value;
+		memcpy(&value, fData + offset, 2);
+		return fSwap ? (value >> 8) | (value << 8) : value;
+	}
+
+	uint32 Read32(size_t offset) const
+	{
+		if (offset + 4 > fSize)
+			return 0;
+		uint32 value;
+		memcpy(&value, fData + offset, 4);
+		if (fSwap) {
+			value = (value >> 24) | ((value >> 8) & 0xff00)
+				| ((value << 8) & 0xff0000) | (value << 24);
+		}
+		return value;
+	}
+
+	uint64 Read64(size_t offset) const
+	{
+		uint64 low = Read32(offset);
+		uint64 high = Read32(offset + 4);
+		if (fSwap)
+			return (low << 32) | high;
+		return (high << 32) | low;
+	}
+
+	// Addresses and sizes are 32 or 64 bits wide depending on the class
+	uint64 ReadWord(size_t offset) const
+	{
+		return f64Bit ? Read64(offset) : Read32(offset);
+	}
+
+	status_t ReadSymbols(int32 member, std::vector<elf_symbol>& symbols,
+		bool hashContents) const;
+
+private:
+	struct section {
+		uint32	type;
+		uint64	flags;
+		uint64	offset;
+		uint64	size;
+		uint32	link;
+		uint32	info;
+		uint64	entrySize;
+	};
+
+	typedef std::map<uint32, std::vector<uint64> > relocation_map;
+
+	bool ReadSection(uint32 index, section& header) const;
+	char TypeFor(uint8 info, uint16 sectionIndex) const;
+	void ReadComdatSections(std::vector<bool>& comdat) const;
+	void ReadRelocations(relocation_map& relocations) const;
+	uint32 HashContents(uint16 sectionIndex, uint64 value, uint64 size,
+		const relocation_map& relocations) const;
+
+	const uint8*	fData;
+	size_t			fSize;
+	bool			f64Bit;
+	bool			fSwap;
+};
+
+
+bool
+ElfImage::ReadSection(uint32 index, section& header) const
+{
+	uint64 tableOffset = ReadWord(f64Bit ? 0x28 : 0x20);
+	uint16 entrySize = Read16(f64Bit ? 0x3a : 0x2e);
+	uint16 count = Read16(f64Bit ? 0x3c : 0x30);
+	if (index >= count || entrySize == 0)
+		return false;
+
+	size_t offset = tableOffset + (uint64)index * entrySize;
+	if (offset + entrySize > fSize)
+		return false;
+
+	header.type = Read32(offset + 4);
+	if (f64Bit) {
+		header.flags = Read64(offset + 8);
+		header.offset = Read64(offset + 24);
+		header.size = Read64(offset + 32);
+		header.link = Read32(offset + 40);
+		header.info = Read32(offset + 44);
+		header.entrySize = Read64(offset + 56);
+	} else {
+		header.flags = Read32(offset + 8);
+		header.offset = Read32(offset + 16);
+		header.size = Read32(offset + 20);
+		header.link = Read32(offset + 24);
+		header.info = Read32(offset + 28);
+		header.entrySize = Read32(offset + 36);
+	}
+
+	return header.offset <= fSize
+		&& (header.type == SECTION_NOBITS
+			|| header.size <= fSize - header.offset);
+}
+
+
+// The letter nm would show for a symbol
+char
+ElfImage::TypeFor(uint8 info, uint16 sectionIndex) const
+{
+	uint8 binding = info >> 4;
+	uint8 type = info & 0xf;
+
+	char letter;
+	if (sectionIndex == INDEX_UNDEFINED)
+		return binding == BIND_WEAK ? 'w' : 'U';
+	if (sectionIndex == INDEX_COMMON)
+		return 'C';
+	if (binding == BIND_WEAK)
+		return type == TYPE_OBJECT ? 'V' : 'W';
+	if (binding == BIND_UNIQUE)
+		return 'u';
+
+	section header;
+	if (sectionIndex == INDEX_ABSOLUTE)
+		letter = 'A';
+	else if (!ReadSection(sectionIndex, header))
+		letter = '?';
+	else if ((header.flags & SECTION_EXECUTE) != 0)
+		letter = 'T';
+	else if (header.type == SECTION_NOBITS)
+		letter = 'B';
+	else if ((header.flags & SECTION_WRITE) != 0)
+		letter = 'D';
+	else
+		letter = 'R';
+
+	if (binding == BIND_LOCAL && letter != '?')
+		letter += 'a' - 'A';
+	return letter;
+}
+
+
+// Which sections are in COMDAT groups
+void
+ElfImage::ReadComdatSections(std::vector<bool>& comdat) const
+{
+	uint16 count = Read16(f64Bit ? 0x3c : 0x30);
+	comdat.assign(count, false);
+	for (uint16 i = 0; i < count; i++) {
+		section header;
+		if (!ReadSection(i, header) || header.type != SECTION_GROUP
+			|| (Read32(header.offset) & GROUP_COMDAT) == 0) {
+			continue;
+		}
+
+		// The flags are followed by the indices of the sections in it
+		for (uint64 offset = 4; offset + 4 <= header.size; offset += 4) {
+			uint32 index = Read32(header.offset + offset);
+			if (index < count)
+				comdat[index] = true;
+		}
+	}
+}
+
+
+// The offsets which REL style relocations apply to, by the section they
+// apply to. Those keep their addends in the relocated bytes themselves, which
+// differ between objects even for the same code, like the offsets of string
+// constants. RELA style ones leave the bytes 0.
+void
+ElfImage::ReadRelocations(relocation_map& relocations) const
+{
+	uint16 count = Read16(f64Bit ? 0x3c : 0x30);
+	for (uint16 i = 0; i < count; i++) {
+		section header;
+		if (!ReadSection(i, header) || header.type != SECTION_REL
+			|| header.entrySize == 0) {
+			continue;
+		}
+
+		std::vector<uint64>& offsets = relocations[header.info];
+		uint64 entryCount = header.size / header.entrySize;
+		for (uint64 j = 0; j < entryCount; j++)
+			offsets.push_back(ReadWord(header.offset + j * header.entrySize));
+	}
+
+	for (relocation_map::iterator it = relocations.begin();
+			it != relocations.end(); it++) {
+		std::sort(it->second.begin(), it->second.end());
+	}
+}
+
+
+// FNV-1a over the symbol's bytes, leaving out those which are relocated
+uint32
+ElfImage::HashContents(uint16 sectionIndex, uint64 value, uint64 size,
+	const relocation_map& relocations) const
+{
+	section header;
+	if (sectionIndex == INDEX_UNDEFINED || sectionIndex >= INDEX_ABSOLUTE
+		|| !ReadSection(sectionIndex, header)
+		|| header.type == SECTION_NOBITS || value > header.size
+		|| size > header.size - value) {
+		return 0;
+	}
+
+	const std::vector<uint64>* offsets = NULL;
+	relocation_map::const_iterator found = relocations.find(sectionIndex);
+	if (found != relocations.end())
+		offsets = &found->second;
+
+	// Relocations are 4 bytes wide in the objects which use REL ones, so
+	// one starting up to 3 bytes before the symbol can still reach into it
+	std::vector<uint64>::const_iterator next;
+	if (offsets != NULL) {
+		next = std::lower_bound(offsets->begin(), offsets->end(),
+			value < 3 ? 0 : value - 3);
+	}
+
+	const uint8* bytes = fData + header.offset;
+	uint32 hash = 2166136261u;
+	uint64 skipEnd = 0;
+	for (uint64 position = value; position < value + size; position++) {
+		while (offsets != NULL && next != offsets->end() && *next <= position) {
+			skipEnd = std::max(skipEnd, *next + 4);
+			next++;
+		}
+		if (position < skipEnd)
+			continue;
+
+		hash = (hash ^ bytes[position]) * 16777619u;
+	}
+
+	// 0 is kept for symbols without contents
+	return hash != 0 ? hash : 1;
+}
+
+
+status_t
+ElfImage::ReadSymbols(int32 member, std::vector<elf_symbol>& symbols,
+	bool hashContents) const
+{
+	// The full table if it is still there, the dynamic one otherwise
+	uint16 count = Read16(f64Bit ? 0x3c : 0x30);
+	section table;
+	bool found = false;
+	for (uint16 i = 0; i < count; i++) {
+		section header;
+		if (!ReadSection(i, header))
+			continue;
+		if (header.type == SECTION_SYMTAB) {
+			table = header;
+			found = true;
+			break;
+		}
+		if (header.type == SECTION_DYNSYM && !found) {
+			table = header;
+			found = true;
+		}
+	}
+	if (!found)
+		return B_OK;
+
+	section strings;
+	if (table.entrySize < (f64Bit ? 24 : 16)
+		|| !ReadSection(table.link, strings)
+		|| strings.type == SECTION_NOBITS) {
+		return B_BAD_DATA;
+	}
+
+	const char* names = (const char*)fData + strings.offset;
+	uint64 symbolCount = table.size / table.entrySize;
+
+	// The values of symbols in relocatable objects are offsets into their
+	// sections, which is what makes their contents easy to get at
+	relocation_map relocations;
+	std::vector<bool> comdat;
+	bool relocatable = Read16(0x10) == ELF_TYPE_RELOCATABLE;
+	hashContents = hashContents && relocatable;
+	if (hashContents)
+		ReadRelocations(relocations);
+	if (relocatable)
+		ReadComdatSections(comdat);
+
+	// The first symbol is always the null one
+	for (uint64 i = 1; i < symbolCount; i++) {
+		size_t offset = table.offset + i * table.entrySize;
+		uint32 nameOffset = Read32(offset);
+		uint8 info;
+		uint16 sectionIndex;
+		uint64 value;
+		uint64 size;
+		if (f64Bit) {
+			info = fData[offset + 4];
+			sectionIndex = Read16(offset + 6);
+			value = Read64(offset + 8);
+			size = Read64(offset + 16);
+		} else {
+			info = fData[offset + 12];
+			sectionIndex = Read16(offset + 14);
+			value = Read32(offset + 4);
+			size = Read32(offset + 8);
+		}
+
+		uint8 type = info & 0xf;
+		if (type == TYPE_SECTION || type == TYPE_FILE
+			|| nameOffset >= strings.size || names[nameOffset] == '\0') {
+			continue;
+		}
+
+		// The name might not be terminated in a broken file
+		size_t length = strnlen(names + nameOffset, strings.size - nameOffset);
+
+		elf_symbol symbol;
+		symbol.name.SetTo(names + nameOffset, length);
+		symbol.member = member;
+		symbol.type = TypeFor(info, sectionIndex);
+		symbol.global = (info >> 4) != BIND_LOCAL;
+		symbol.defined = sectionIndex != INDEX_UNDEFINED;
+		symbol.size = size;
+		symbol.comdat = sectionIndex < comdat.size() && comdat[sectionIndex];
+		symbol.hash = hashContents
+			? HashContents(sectionIndex, value, size, relocations) : 0;
+		symbols.push_back(symbol);
+	}
+
+	return B_OK;
+}
+
+
+static uint64
+ParseDecimal(const char* text, size_t length)
+{
+	uint64 value = 0;
+	for (size_t i = 0; i < length && text[i] >= '0' && text[i] <= '9'; i++)
+		value = value * 10 + text[i] - '0';
+	return value;
+}
+
+
+static status_t
+ReadArchive(const uint8* data, size_t size, std::vector<elf_symbol>& symbols,
+	std::vector<BString>& members, bool hashContents)
+{
+	const char* longNames = NULL;
+	size_t longNamesSize = 0;
+
+	size_t offset = sizeof(kArchiveMagic) - 1;
+	while (offset + kArchiveHeaderSize <= size) {
+		const char* header = (const char*)data + offset;
+		uint64 memberSize = ParseDecimal(header + 48, 10);
+		size_t start = offset + kArchiveHeaderSize;
+		if (memberSize > size - start)
+			break;
+
+		// Members start on even offsets
+		offset = start + memberSize + (memberSize & 1);
+
+		BString name;
+		if (header[0] == '/' && header[1] == ' ') {
+			// The archive's own symbol table
+			continue;
+		} else if (header[0] == '/' && header[1] == '/') {
+			longNames = (const char*)data + start;
+			longNamesSize = memberSize;
+			continue;
+		} else if (header[0] == '/' && longNames != NULL) {
+			// GNU style long name, an offset into the long name table
+			uint64 nameOffset = ParseDecimal(header + 1, 15);
+			if (nameOffset < longNamesSize) {
+				const char* longName = longNames + nameOffset;
+				const char* end = (const char*)memchr(longName, '\n',
+					longNamesSize - nameOffset);
+				size_t length = end != NULL ? end - longName
+					: longNamesSize - nameOffset;
+				name.SetTo(longName, length);
+			}
+		} else if (strncmp(header, "#1/", 3) == 0) {
+			// BSD style long name, right in front of the member's data
+			uint64 length = ParseDecimal(header + 3, 13);
+			if (length > memberSize)
+				continue;
+			name.SetTo((const char*)data + start, length);
+			start += length;
+			memberSize -= length;
+		} else
+			name.SetTo(header, 16);
+
+		name.Trim();
+		if (name.EndsWith("/"))
+			name.Truncate(name.Length() - 1);
+
+		ElfImage image(data + start, memberSize);
+		if (!image.Init())
+			continue;
+
+		members.push_back(name);
+		image.ReadSymbols(members.size() - 1, symbols, hashContents);
+	}
+
+	return B_OK;
+}
+
+
+status_t
+ReadElfSymbols(const char* path, std::vector<elf_symbol>& symbols,
+	std::vector<BString>& members, bool hashContents)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return B_ENTRY_NOT_FOUND;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)
+		|| fileStat.st_size < 8) {
+		close(fd);
+		return B_BAD_VALUE;
+	}
+
+	size_t size = fileStat.st_size;
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return B_NO_MEMORY;
+
+	status_t status = B_BAD_TYPE;
+	const uint8* bytes = (const uint8*)data;
+	if (memcmp(bytes, kArchiveMagic, sizeof(kArchiveMagic) - 1) == 0)
+		status = ReadArchive(bytes, size, symbols, members, hashContents);
+	else {
+		ElfImage image(bytes, size);
+		if (image.Init())
+			status = image.ReadSymbols(-1, symbols, hashContents);
+	}
+
+	munmap(data, size);
+	return status;
+}
+
+
+BString
+DemangleSymbol(const char* name)
+{
+	if (name[0] != '_' || name[1] != 'Z')
+		return BString(name);
+
+	int status;
+	char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+	if (demangled == NULL)
+		return BString(name);
+
+	BString result(demangled);
+	free(demangled);
+	return result;
+}
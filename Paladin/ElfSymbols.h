@@ -0,0 +1,43 @@
+#ifndef _ELF_SYMBOLS_H
+#define _ELF_SYMBOLS_H
+
+
+#include <String.h>
+#include <SupportDefs.h>
+
+#include <vector>
+
+
+struct elf_symbol {
+	BString		name;
+	int32		member;
+	char		type;
+	bool		global;
+	bool		defined;
+	uint64		size;
+
+	// Defined in a COMDAT group, like template instances and inline
+	// functions, of which the linker keeps one copy however many there are
+	bool		comdat;
+
+	// For definitions in relocatable objects when asked for, a hash of the
+	// symbol's contents, for telling whether two definitions are the same.
+	// 0 otherwise, and for symbols without any contents in the file.
+	uint32		hash;
+};
+
+
+// Reads the symbol tables of an ELF object, shared library or ar archive
+// of them without running nm. Shared libraries which have been stripped
+// only have their dynamic symbols read. For archives, members is filled
+// with the names of the members and each symbol's member is an index into
+// it. Section and file symbols are left out. Names are left mangled.
+status_t	ReadElfSymbols(const char* path, std::vector<elf_symbol>& symbols,
+				std::vector<BString>& members, bool hashContents = false);
+
+// Turns a mangled C++ name back into what it looked like in the source, or
+// returns it as it is if it isn't one
+BString		DemangleSymbol(const char* name);
+
+
+#endif // _ELF_SYMBOLS_H
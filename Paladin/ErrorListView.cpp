@@ -0,0 +1,469 @@
+#include "ErrorListView.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include <Catalog.h>
+#include <Locale.h>
+#include <PopUpMenu.h>
+#include <ScrollBar.h>
+#include <Window.h>
+
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "ErrorWindow"
+
+
+ErrorListView::ErrorListView(const char* name)
+	:
+	BView(name, B_WILL_DRAW | B_FRAME_EVENTS | B_NAVIGABLE),
+	fList(NULL),
+	fScanned(0),
+	fSelected(-1),
+	fShowErrors(true),
+	fShowWarnings(true),
+	fErrorCount(0),
+	fWarningCount(0),
+	fWidestRow(-1),
+	fRowHeight(16),
+	fBaseline(12),
+	fContextMenu(NULL)
+{
+}
+
+
+ErrorListView::~ErrorListView(void)
+{
+	delete fContextMenu;
+}
+
+
+void
+ErrorListView::AttachedToWindow(void)
+{
+	BView::AttachedToWindow();
+
+	// Every pixel is painted in Draw(), so don't let the app_server clear
+	// the view first
+	SetViewColor(B_TRANSPARENT_COLOR);
+
+	font_height fontHeight;
+	GetFontHeight(&fontHeight);
+	fRowHeight = ceilf(fontHeight.ascent + fontHeight.descent
+		+ fontHeight.leading) + 2;
+	fBaseline = ceilf(fontHeight.ascent) + 1;
+
+	if (!Messenger().IsValid())
+		SetTarget(Window());
+
+	UpdateScrollBars();
+}
+
+
+void
+ErrorListView::Draw(BRect updateRect)
+{
+	int32 first = std::max((int32)0, (int32)(updateRect.top / fRowHeight));
+	int32 last = std::min(CountRows() - 1, (int32)(updateRect.bottom / fRowHeight));
+
+	for (int32 row = first; row <= last; row++)
+		DrawRow(row, RowFrame(row));
+
+	BRect rest(updateRect);
+	rest.top = std::max(updateRect.top, CountRows() * fRowHeight);
+	if (rest.IsValid()) {
+		SetLowColor(ui_color(B_LIST_BACKGROUND_COLOR));
+		FillRect(rest, B_SOLID_LOW);
+	}
+}
+
+
+void
+ErrorListView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	UpdateScrollBars();
+}
+
+
+void
+ErrorListView::KeyDown(const char* bytes, int32 count)
+{
+	int32 rows = CountRows();
+	int32 row = RowOf(fSelected);
+	int32 page = std::max((int32)1, (int32)(Bounds().Height() / fRowHeight));
+
+	switch (bytes[0]) {
+		case B_UP_ARROW:
+			row--;
+			break;
+
+		case B_DOWN_ARROW:
+			row++;
+			break;
+
+		case B_PAGE_UP:
+			row -= page;
+			break;
+
+		case B_PAGE_DOWN:
+			row += page;
+			break;
+
+		case B_HOME:
+			row = 0;
+			break;
+
+		case B_END:
+			row = rows - 1;
+			break;
+
+		case B_ENTER:
+		case B_SPACE:
+			if (fSelected >= 0)
+				Invoke();
+			return;
+
+		default:
+			BView::KeyDown(bytes, count);
+			return;
+	}
+
+	if (rows > 0)
+		Select(std::max((int32)0, std::min(row, rows - 1)));
+}
+
+
+void
+ErrorListView::MouseDown(BPoint where)
+{
+	MakeFocus(true);
+
+	int32 buttons = B_PRIMARY_MOUSE_BUTTON;
+	int32 clicks = 1;
+	BMessage* message = Window()->CurrentMessage();
+	if (message != NULL) {
+		message->FindInt32("buttons", &buttons);
+		message->FindInt32("clicks", &clicks);
+	}
+
+	int32 row = RowAt(where);
+	if (row >= 0)
+		Select(row);
+
+	if ((buttons & B_SECONDARY_MOUSE_BUTTON) != 0) {
+		if (fContextMenu != NULL) {
+			BPoint screenPoint(ConvertToScreen(where));
+			screenPoint.x -= 5;
+			screenPoint.y -= 5;
+			fContextMenu->Go(screenPoint, true, false);
+		}
+		return;
+	}
+
+	if (row >= 0 && clicks > 1)
+		Invoke();
+}
+
+
+void
+ErrorListView::SetList(ErrorList* list)
+{
+	fList = list;
+	Reload();
+}
+
+
+void
+ErrorListView::ItemsAdded(void)
+{
+	if (fList == NULL)
+		return;
+
+	if (fList->msglist.CountItems() < fScanned) {
+		Reload();
+		return;
+	}
+
+	AddRows(fScanned);
+	UpdateScrollBars();
+
+	// Merged diagnostics can change the count shown on rows already on
+	// screen, and only the visible rows are drawn anyway
+	Invalidate();
+}
+
+
+void
+ErrorListView::Reload(void)
+{
+	fSelected = -1;
+	Refilter();
+}
+
+
+void
+ErrorListView::SetShowErrors(bool show)
+{
+	if (show == fShowErrors)
+		return;
+
+	fShowErrors = show;
+	Refilter();
+}
+
+
+void
+ErrorListView::SetShowWarnings(bool show)
+{
+	if (show == fShowWarnings)
+		return;
+
+	fShowWarnings = show;
+	Refilter();
+}
+
+
+void
+ErrorListView::SetFilterText(const char* text)
+{
+	if (fFilterText == text)
+		return;
+
+	fFilterText = text;
+	Refilter();
+}
+
+
+error_msg*
+ErrorListView::SelectedMessage(void) const
+{
+	if (fList == NULL || fSelected < 0)
+		return NULL;
+
+	return fList->msglist.ItemAt(fSelected);
+}
+
+
+void
+ErrorListView::SetContextMenu(BPopUpMenu* menu)
+{
+	delete fContextMenu;
+	fContextMenu = menu;
+}
+
+
+bool
+ErrorListView::Matches(int32 index, error_msg* message)
+{
+	// Notes and fix-its go wherever the diagnostic they belong to goes
+	if (message->parent > 0 && index - message->parent >= 0)
+		return fShown[index - message->parent];
+
+	// Context lines come before the diagnostic they lead up to
+	if (message->parent < 0
+		&& index - message->parent < fList->msglist.CountItems()) {
+		return Matches(index - message->parent,
+			fList->msglist.ItemAt(index - message->parent));
+	}
+
+	if (message->type == ERROR_ERROR && !fShowErrors)
+		return false;
+
+	if (message->type == ERROR_WARNING && !fShowWarnings)
+		return false;
+
+	if (fFilterText.Length() > 0 && message->rawdata.IFindFirst(fFilterText) < 0)
+		return false;
+
+	return true;
+}
+
+
+void
+ErrorListView::AddRows(int32 from)
+{
+	int32 count = fList != NULL ? fList->msglist.CountItems() : 0;
+	fShown.resize(count, false);
+
+	for (int32 i = from; i < count; i++) {
+		error_msg* message = fList->msglist.ItemAt(i);
+
+		if (message->type == ERROR_ERROR)
+			fErrorCount++;
+		else if (message->type == ERROR_WARNING)
+			fWarningCount++;
+
+		fShown[i] = Matches(i, message);
+		if (!fShown[i])
+			continue;
+
+		fRows.push_back(i);
+		if (fWidestRow < 0 || message->rawdata.Length()
+				> fList->msglist.ItemAt(fWidestRow)->rawdata.Length())
+			fWidestRow = i;
+	}
+
+	fScanned = count;
+}
+
+
+void
+ErrorListView::Refilter(void)
+{
+	fRows.clear();
+	fShown.clear();
+	fScanned = 0;
+	fErrorCount = fWarningCount = 0;
+	fWidestRow = -1;
+
+	AddRows(0);
+
+	if (fSelected >= fScanned)
+		fSelected = -1;
+
+	UpdateScrollBars();
+	Invalidate();
+}
+
+
+int32
+ErrorListView::RowAt(BPoint where) const
+{
+	if (where.y < 0)
+		return -1;
+
+	int32 row = (int32)(where.y / fRowHeight);
+	return row < CountRows() ? row : -1;
+}
+
+
+int32
+ErrorListView::RowOf(int32 index) const
+{
+	std::vector<int32>::const_iterator row = std::lower_bound(fRows.begin(),
+		fRows.end(), index);
+	if (row == fRows.end() || *row != index)
+		return -1;
+
+	return row - fRows.begin();
+}
+
+
+BRect
+ErrorListView::RowFrame(int32 row) const
+{
+	BRect bounds(Bounds());
+	return BRect(bounds.left, row * fRowHeight, bounds.right,
+		(row + 1) * fRowHeight - 1);
+}
+
+
+void
+ErrorListView::DrawRow(int32 row, BRect frame)
+{
+	int32 index = fRows[row];
+	error_msg* message = fList->msglist.ItemAt(index);
+
+	rgb_color color;
+	switch (message->type) {
+		case ERROR_ERROR:
+			color = make_color(250, 170, 170);
+			break;
+
+		case ERROR_WARNING:
+			color = make_color(250, 250, 170);
+			break;
+
+		case ERROR_NOTE:
+			color = make_color(230, 230, 250);
+			break;
+
+		case ERROR_UNKNOWN:
+			color = make_color(250, 210, 210);
+			break;
+
+		default:
+			color = ui_color(B_LIST_BACKGROUND_COLOR);
+			break;
+	}
+
+	if (index == fSelected)
+		color = tint_color(color, B_DARKEN_2_TINT);
+
+	SetLowColor(color);
+	FillRect(frame, B_SOLID_LOW);
+
+	const char* text = message->rawdata.String();
+	BString counted;
+	if (message->count > 1) {
+		counted = B_TRANSLATE("%rawdata% (reported by %count% files)");
+		BString count;
+		count << message->count;
+		counted.ReplaceFirst("%count%", count.String());
+		counted.ReplaceFirst("%rawdata%", text);
+		text = counted.String();
+	}
+
+	// Indent notes under the diagnostic they belong to
+	float indent = message->parent > 0 ? fRowHeight : 0;
+
+	SetHighColor(ui_color(B_LIST_ITEM_TEXT_COLOR));
+	DrawString(text, BPoint(4 + indent, frame.top + fBaseline));
+}
+
+
+void
+ErrorListView::Select(int32 row)
+{
+	int32 oldRow = RowOf(fSelected);
+	fSelected = row >= 0 ? fRows[row] : -1;
+
+	if (oldRow >= 0)
+		Invalidate(RowFrame(oldRow));
+
+	if (row < 0)
+		return;
+
+	BRect frame(RowFrame(row));
+	Invalidate(frame);
+
+	BRect bounds(Bounds());
+	if (frame.top < bounds.top)
+		ScrollTo(BPoint(bounds.left, frame.top));
+	else if (frame.bottom > bounds.bottom)
+		ScrollTo(BPoint(bounds.left, frame.bottom - bounds.Height()));
+}
+
+
+void
+ErrorListView::UpdateScrollBars(void)
+{
+	BRect bounds(Bounds());
+
+	BScrollBar* scrollBar = ScrollBar(B_VERTICAL);
+	if (scrollBar != NULL) {
+		float height = CountRows() * fRowHeight;
+		float max = std::max(0.0f, height - 1 - bounds.Height());
+		scrollBar->SetRange(0, max);
+		scrollBar->SetProportion(height > 0
+			? std::min(1.0f, bounds.Height() / height) : 1.0f);
+		scrollBar->SetSteps(fRowHeight,
+			std::max(fRowHeight, bounds.Height() - fRowHeight));
+	}
+
+	scrollBar = ScrollBar(B_HORIZONTAL);
+	if (scrollBar != NULL) {
+		// Measuring every row would defeat the purpose, so the longest one
+		// stands in for the widest
+		float width = 0;
+		if (fWidestRow >= 0)
+			width = StringWidth(fList->msglist.ItemAt(fWidestRow)->rawdata.String())
+				+ fRowHeight + 8;
+		float max = std::max(0.0f, width - bounds.Width());
+		scrollBar->SetRange(0, max);
+		scrollBar->SetProportion(width > 0
+			? std::min(1.0f, bounds.Width() / width) : 1.0f);
+		scrollBar->SetSteps(25, 75);
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef ERROR_LIST_VIEW_H
+#define ERROR_LIST_VIEW_H
+
+
+#include <Invoker.h>
+#include <String.h>
+#include <View.h>
+
+#include <vector>
+
+#include "ErrorParser.h"
+
+
+class BPopUpMenu;
+
+// Shows the items of an ErrorList without making a list item for each one.
+// The view keeps only the indices of the items which pass the filter and
+// draws just the rows which are on screen, so it copes with build logs which
+// would bury a BListView.
+class ErrorListView : public BView, public BInvoker {
+public:
+								ErrorListView(const char* name);
+	virtual						~ErrorListView(void);
+
+	virtual	void				AttachedToWindow(void);
+	virtual	void				Draw(BRect updateRect);
+	virtual	void				FrameResized(float width, float height);
+	virtual	void				KeyDown(const char* bytes, int32 count);
+	virtual	void				MouseDown(BPoint where);
+
+			void				SetList(ErrorList* list);
+			void				ItemsAdded(void);
+			void				Reload(void);
+
+			void				SetShowErrors(bool show);
+			void				SetShowWarnings(bool show);
+			void				SetFilterText(const char* text);
+
+			int32				CountRows(void) const { return fRows.size(); }
+			int32				CountErrors(void) const { return fErrorCount; }
+			int32				CountWarnings(void) const { return fWarningCount; }
+
+			error_msg*			SelectedMessage(void) const;
+
+			void				SetContextMenu(BPopUpMenu* menu);
+
+private:
+			bool				Matches(int32 index, error_msg* message);
+			void				AddRows(int32 from);
+			void				Refilter(void);
+			int32				RowAt(BPoint where) const;
+			int32				RowOf(int32 index) const;
+			BRect				RowFrame(int32 row) const;
+			void				DrawRow(int32 row, BRect frame);
+			void				Select(int32 row);
+			void				UpdateScrollBars(void);
+
+			ErrorList*			fList;
+			std::vector<int32>	fRows;
+			std::vector<bool>	fShown;
+			int32				fScanned;
+			int32				fSelected;
+
+			bool				fShowErrors;
+			bool				fShowWarnings;
+			BString				fFilterText;
+
+			int32				fErrorCount;
+			int32				fWarningCount;
+			int32				fWidestRow;
+
+			float				fRowHeight;
+			float				fBaseline;
+			BPopUpMenu*			fContextMenu;
+};
+
+
+#endif	// ERROR_LIST_VIEW_H
@@ -22,11 +22,11 @@
 #include <Locale.h>
 #include <ScrollView.h>
 #include <String.h>
-#include <StringItem.h>
+#include <TextControl.h>
 #include <TypeConstants.h>
 
-#include "DListView.h"
 #include "DebugTools.h"
+#include "ErrorListView.h"
 #include "MsgDefs.h"
 #include "Project.h"
 #include "ProjectBuilder.h"
@@ -40,76 +40,12 @@ enum
 {
 	M_TOGGLE_ERRORS = 'tger',
 	M_TOGGLE_WARNINGS = 'tgwn',
-	M_COPY_ERRORS = 'cper'
+	M_COPY_ERRORS = 'cper',
+	M_FILTER_ERRORS = 'fler',
+	M_ADD_SELECTED_LIBRARY = 'adsl'
 };
 
 
-class ErrorItem : public BStringItem {
-public:
-								ErrorItem(error_msg* errorMessage);
-	virtual	void				DrawItem(BView* owner, BRect frame, bool complete);
-	
-			error_msg*			GetMessage(void) const { return fMessage; }
-
-private:
-			error_msg*			fMessage;
-};
-
-
-//	#pragma mark - ErrorItem
-
-
-ErrorItem::ErrorItem(error_msg* message)
-	:
-	BStringItem(""),
-	fMessage(message)
-{
-	if (fMessage != NULL)
-		SetText(message->rawdata.String());
-}
-
-
-void
-ErrorItem::DrawItem(BView* owner, BRect frame, bool complete)
-{
-	switch (fMessage->type) {
-		case ERROR_ERROR:
-		{
-			owner->SetLowColor(250, 170, 170);
-			break;
-		}
-
-		case ERROR_WARNING:
-		{
-			owner->SetLowColor(250, 250, 170);
-			break;
-		}
-		
-		case ERROR_NOTE:
-		{
-			owner->SetLowColor(230, 230, 250);
-			break;
-		}
-		
-		case ERROR_UNKNOWN:
-		{
-			owner->SetLowColor(250, 210, 210);
-			break;
-		}
-
-		default:
-		{
-			owner->SetLowColor(255, 255, 255);
-			break;
-		}
-	}
-
-	owner->SetDrawingMode(B_OP_OVER);
-	owner->FillRect(frame, B_SOLID_LOW);
-	BStringItem::DrawItem(owner, frame, complete);
-}
-
-
 //	#pragma mark - ErrorWindow
 
 
@@ -117,9 +53,7 @@ ErrorWindow::ErrorWindow(BRect frame, ProjectWindow* parent, ErrorList* list)
 	:
 	BWindow(frame, B_TRANSLATE("Errors and warnings"), B_DOCUMENT_WINDOW,
 		B_ASYNCHRONOUS_CONTROLS),
-	fParent(parent),
-	fErrorCount(0),
-	fWarningCount(0)
+	fParent(parent)
 {
 	SetSizeLimits(400, 30000, 250, 30000);
 	MoveTo(100,100);
@@ -166,14 +100,19 @@ ErrorWindow::ErrorWindow(BRect frame, ProjectWindow* parent, ErrorList* list)
 	fCopyButton = new BButton("copy", B_TRANSLATE("Copy to clipboard"),
 		new BMessage(M_COPY_ERRORS));
 
-	fErrorList = new DListView("errorlist", B_SINGLE_SELECTION_LIST,
-		B_WILL_DRAW | B_NAVIGABLE);
-	BScrollView* errorScrollView = fErrorList->MakeScrollView("scroller", true, true);
-	errorScrollView->ScrollBar(B_HORIZONTAL)->SetSteps(25, 75);
+	fFilterText = new BTextControl("filter", B_TRANSLATE("Filter:"), "", NULL);
+	fFilterText->SetModificationMessage(new BMessage(M_FILTER_ERRORS));
+
+	fErrorList = new ErrorListView("errorlist");
+	BScrollView* errorScrollView = new BScrollView("scroller", fErrorList, 0,
+		true, true);
 
 	BPopUpMenu* contextMenu = new BPopUpMenu("context_menu", false, false);
 	contextMenu->AddItem(new BMenuItem(B_TRANSLATE("Copy list to clipboard"),
 		new BMessage(M_COPY_ERRORS)));
+	contextMenu->AddItem(new BMenuItem(
+		B_TRANSLATE("Add suggested library to project"),
+		new BMessage(M_ADD_SELECTED_LIBRARY)));
 	contextMenu->SetTargetForItems(this);
 	fErrorList->SetContextMenu(contextMenu);
 
@@ -182,6 +121,7 @@ ErrorWindow::ErrorWindow(BRect frame, ProjectWindow* parent, ErrorList* list)
 		.Add(fWarningBox)
 		.Add(fCopyButton)
 		.AddGlue()
+		.Add(fFilterText)
 		.SetInsets(B_USE_DEFAULT_SPACING, 0, B_USE_DEFAULT_SPACING, 0)
 		.View();
 	header->SetName("header");
@@ -193,8 +133,8 @@ ErrorWindow::ErrorWindow(BRect frame, ProjectWindow* parent, ErrorList* list)
 		.SetInsets(-1.0f)
 		.End();
 
-	if (list != NULL)
-		RefreshList();
+	fErrorList->SetList(&fErrors);
+	UpdateLabels();
 
 	BRect newframe;
 	BNode node(fParent->GetProject()->GetPath().GetFullPath());
@@ -210,7 +150,7 @@ ErrorWindow::ErrorWindow(BRect frame, ProjectWindow* parent, ErrorList* list)
 	fErrorBox->SetValue(B_CONTROL_ON);
 	fWarningBox->SetValue(B_CONTROL_ON);
 
-	fErrorList->SetInvocationMessage(new BMessage(M_JUMP_TO_MSG));
+	fErrorList->SetMessage(new BMessage(M_JUMP_TO_MSG));
 	fErrorList->MakeFocus(true);
 }
 
@@ -245,7 +185,14 @@ ErrorWindow::MessageReceived(BMessage* message)
 		case M_TOGGLE_ERRORS:
 		case M_TOGGLE_WARNINGS:
 		{
-			RefreshList();
+			fErrorList->SetShowErrors(fErrorBox->Value() == B_CONTROL_ON);
+			fErrorList->SetShowWarnings(fWarningBox->Value() == B_CONTROL_ON);
+			break;
+		}
+
+		case M_FILTER_ERRORS:
+		{
+			fErrorList->SetFilterText(fFilterText->Text());
 			break;
 		}
 
@@ -255,10 +202,19 @@ ErrorWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case M_ADD_SELECTED_LIBRARY:
+		{
+			error_msg* selected = fErrorList->SelectedMessage();
+			if (selected != NULL)
+				AddLibrary(selected->library.String());
+			break;
+		}
+
 		case M_CLEAR_ERROR_LIST:
 		{
-			EmptyList();
-		 	fErrors.msglist.MakeEmpty();
+			fErrors.MakeEmpty();
+			fErrorList->Reload();
+			UpdateLabels();
 			break;
 		}
 
@@ -274,10 +230,13 @@ ErrorWindow::MessageReceived(BMessage* message)
  		case M_JUMP_TO_MSG:
  		{
 			STRACE(2,("M_JUMP_TO_MSG called\n"));
- 			int32 selection = fErrorList->CurrentSelection();
- 			if (selection >= 0) {
- 				ErrorItem* item = (ErrorItem*)fErrorList->ItemAt(selection);
- 				error_msg* gcc = item->GetMessage();
+ 			error_msg* gcc = fErrorList->SelectedMessage();
+			if (gcc != NULL && gcc->library.Length() > 0) {
+				AddLibrary(gcc->library.String());
+				break;
+			}
+
+ 			if (gcc != NULL) {
 				STRACE(2,("gcc message info: line: %i\n",gcc->line));
 				STRACE(2,("gcc message info: column: %i\n",gcc->column));
 
@@ -321,89 +280,34 @@ ErrorWindow::QuitRequested(void)
 void
 ErrorWindow::AppendToList(ErrorList& list)
 {
-	list.Rewind();
-
-	error_msg* message = list.GetNextItem();
-	int32 counter = 0;
-	while (message != NULL) {
-		error_msg* newmessage = new error_msg;
-		*newmessage = *message;
-		fErrors.msglist.AddItem(newmessage);
-		ErrMsgToItem(newmessage);
-		if (counter % 5 == 0)
-			UpdateIfNeeded();
-
-		counter++;
-		message = list.GetNextItem();
-	}
+	fErrors.Merge(list);
+	fErrorList->ItemsAdded();
+	UpdateLabels();
 }
 
 
 void
-ErrorWindow::RefreshList(void)
+ErrorWindow::UpdateLabels(void)
 {
-	EmptyList();
+	BString label(B_TRANSLATE("Errors"));
+	label << " (" << fErrorList->CountErrors() << ")";
+	fErrorBox->SetLabel(label.String());
 
-	fErrors.Rewind();
-	error_msg* item = fErrors.GetNextItem();
-	int32 counter = 0;
-	while (item != NULL) {
-		ErrMsgToItem(item);
-		if (counter % 5 == 0)
-			UpdateIfNeeded();
-
-		counter++;
-		item = fErrors.GetNextItem();
-	}
+	label = B_TRANSLATE("Warnings");
+	label << " (" << fErrorList->CountWarnings() << ")";
+	fWarningBox->SetLabel(label.String());
 }
 
 
-
 void
-ErrorWindow::ErrMsgToItem(error_msg* message)
+ErrorWindow::AddLibrary(const char* path)
 {
-	if (message == NULL)
+	if (path == NULL || *path == '\0')
 		return;
-	
-	if ((message->type == ERROR_ERROR && fErrorBox->Value() == B_CONTROL_ON)
-		|| (message->type == ERROR_WARNING && fWarningBox->Value() == B_CONTROL_ON)
-		|| message->type == ERROR_UNKNOWN
-		|| message->type == ERROR_NOTE
-		|| message->type == ERROR_MSG) {
-		fErrorList->AddItem(new ErrorItem(message));
-
-		BString boxLabel;
-		if (message->type == ERROR_ERROR) {
-			fErrorCount++;
-			boxLabel = B_TRANSLATE("Errors");
-			boxLabel << " (" << fErrorCount << ")";
-			fErrorBox->SetLabel(boxLabel.String());
-		} else if (message->type == ERROR_WARNING) {
-			fWarningCount++;
-			boxLabel = B_TRANSLATE("Warnings");
-			boxLabel << " (" << fWarningCount << ")";
-			fWarningBox->SetLabel(boxLabel.String());
-		}
-	}
-}
 
-
-void
-ErrorWindow::EmptyList(void)
-{
-	for (int32 i = fErrorList->CountItems() - 1; i >= 0; i--) {
-		ErrorItem* item = (ErrorItem*)fErrorList->RemoveItem(i);
-		delete item;
-	}
-
-	fErrorCount = fWarningCount = 0;
-
-	BString label(B_TRANSLATE("Errors"));
-	label << " (0)";
-	fErrorBox->SetLabel(label.String());
-	label = B_TRANSLATE("Warnings");
-	label << " (0)";
-	fWarningBox->SetLabel(label.String());
+	BMessage message(M_ADD_ERROR_LIBRARY);
+	message.AddString("path", path);
+	fParent->PostMessage(&message);
 }
 
 
@@ -19,11 +19,13 @@
 #define M_ERRORWIN_CLOSED 'erwc'
 #define M_CLEAR_ERROR_LIST 'clel'
 #define M_ADD_WARNINGS 'adwn'
+#define M_ADD_ERROR_LIBRARY 'aelb'
 
 
 class BButton;
 class BCheckBox;
-class DListView;
+class BTextControl;
+class ErrorListView;
 class ProjectWindow;
 
 class ErrorWindow : public BWindow {
@@ -38,9 +40,8 @@ public:
 
 private:
 			void				AppendToList(ErrorList &list);
-			void				RefreshList(void);
-			void				ErrMsgToItem(error_msg *msg);
-			void				EmptyList(void);
+			void				UpdateLabels(void);
+			void				AddLibrary(const char* path);
 			void				CopyList(void);
 
 			ProjectWindow*		fParent;
@@ -48,11 +49,10 @@ private:
 			BCheckBox*			fErrorBox;
 			BCheckBox*			fWarningBox;
 			BButton*			fCopyButton;
-			DListView*			fErrorList;
+			BTextControl*		fFilterText;
+			ErrorListView*		fErrorList;
 
 			ErrorList			fErrors;
-			int32				fErrorCount;
-			int32				fWarningCount;
 };
 
 
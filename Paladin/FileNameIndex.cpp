@@ -0,0 +1,379 @@
+#include "FileNameIndex.h"
+
+#include <Autolock.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <set>
+
+#include "DebugTools.h"
+
+
+enum {
+	M_REFRESH_FILE_NAMES = 'fnrf'
+};
+
+// How many folders are read between telling the watchers about them
+static const int32 kNotifyInterval = 64;
+
+
+static bool
+BetterMatch(const file_name_match& a, const file_name_match& b)
+{
+	if (a.score != b.score)
+		return a.score > b.score;
+	if (a.folder != b.folder)
+		return a.folder < b.folder;
+	if (a.path.Length() != b.path.Length())
+		return a.path.Length() < b.path.Length();
+	return a.path < b.path;
+}
+
+
+FileNameIndex::FileNameIndex(void)
+	:
+	BLooper("file name index", B_LOW_PRIORITY),
+	fCancelled(0),
+	fScanning(0),
+	fDataLock("file name index data")
+{
+}
+
+
+FileNameIndex::~FileNameIndex(void)
+{
+}
+
+
+void
+FileNameIndex::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_REFRESH_FILE_NAMES:
+		{
+			BStringList folders;
+			BString folder;
+			for (int32 i = 0; message->FindString("folder", i, &folder) == B_OK;
+					i++) {
+				folders.Add(folder);
+			}
+
+			Scan(folders);
+			atomic_add(&fScanning, -1);
+
+			// Also tells the watchers that the scan is over
+			NotifyWatchers();
+			break;
+		}
+
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+void
+FileNameIndex::Refresh(const BStringList& folders)
+{
+	BMessage message(M_REFRESH_FILE_NAMES);
+	for (int32 i = 0; i < folders.CountStrings(); i++)
+		message.AddString("folder", folders.StringAt(i));
+
+	atomic_add(&fScanning, 1);
+	if (PostMessage(&message) != B_OK)
+		atomic_add(&fScanning, -1);
+}
+
+
+bool
+FileNameIndex::IsScanning(void) const
+{
+	return atomic_get((int32*)&fScanning) > 0;
+}
+
+
+void
+FileNameIndex::StartWatching(BMessenger target)
+{
+	BAutolock lock(fDataLock);
+	fWatchers.push_back(target);
+}
+
+
+void
+FileNameIndex::StopWatching(BMessenger target)
+{
+	BAutolock lock(fDataLock);
+	fWatchers.erase(std::remove(fWatchers.begin(), fWatchers.end(), target),
+		fWatchers.end());
+}
+
+
+void
+FileNameIndex::Shutdown(void)
+{
+	atomic_set(&fCancelled, 1);
+
+	thread_id thread = Thread();
+	PostMessage(B_QUIT_REQUESTED);
+
+	status_t result;
+	wait_for_thread(thread, &result);
+}
+
+
+void
+FileNameIndex::Find(const char* query, const BStringList& folders,
+	int32 maxCount, std::vector<file_name_match>& matches)
+{
+	matches.clear();
+
+	BString name(query);
+	name.Trim();
+	BString folderPart;
+	int32 slash = name.FindLast('/');
+	if (slash >= 0) {
+		folderPart.SetTo(name, slash);
+		folderPart.ToLower();
+		name.Remove(0, slash + 1);
+	}
+	if (name.Length() == 0 || maxCount <= 0)
+		return;
+
+	BString lowerName(name);
+	lowerName.ToLower();
+
+	std::vector<BString> roots;
+	for (int32 i = 0; i < folders.CountStrings(); i++) {
+		BString root(folders.StringAt(i));
+		while (root.Length() > 1 && root.EndsWith("/"))
+			root.Truncate(root.Length() - 1);
+		roots.push_back(root);
+	}
+
+	bigtime_t startTime = system_time();
+	BAutolock lock(fDataLock);
+
+	for (std::map<BString, folder_info>::const_iterator it = fFolders.begin();
+			it != fFolders.end(); it++) {
+		const BString& path = it->first;
+
+		// The first folder a file is under is the one it ranks by
+		int32 folder = -1;
+		for (size_t i = 0; i < roots.size() && folder < 0; i++) {
+			if (path == roots[i] || (path.StartsWith(roots[i])
+					&& path[roots[i].Length()] == '/')) {
+				folder = i;
+			}
+		}
+		if (folder < 0)
+			continue;
+
+		if (folderPart.Length() > 0) {
+			BString lowerPath(path);
+			lowerPath.ToLower();
+			if (lowerPath.FindFirst(folderPart) < 0)
+				continue;
+		}
+
+		const std::vector<BString>& files = it->second.files;
+		for (size_t i = 0; i < files.size(); i++) {
+			BString lowerFile(files[i]);
+			lowerFile.ToLower();
+
+			int32 score = Score(files[i], lowerFile, name, lowerName);
+			if (score <= 0)
+				continue;
+
+			file_name_match match;
+			match.path = path;
+			match.path << "/" << files[i];
+			match.score = score;
+			match.folder = folder;
+			matches.push_back(match);
+		}
+	}
+
+	if ((int32)matches.size() > maxCount) {
+		std::partial_sort(matches.begin(), matches.begin() + maxCount,
+			matches.end(), BetterMatch);
+		matches.resize(maxCount);
+	} else
+		std::sort(matches.begin(), matches.end(), BetterMatch);
+
+	STRACE(2, ("Looked up %s in %ld folders in %lld us\n", query,
+		(long)fFolders.size(), system_time() - startTime));
+}
+
+
+void
+FileNameIndex::Scan(const BStringList& roots)
+{
+	bigtime_t startTime = system_time();
+	int32 readCount = 0;
+
+	std::set<BString> visited;
+	std::vector<BString> stack;
+	for (int32 i = roots.CountStrings() - 1; i >= 0; i--)
+		stack.push_back(roots.StringAt(i));
+
+	while (!stack.empty() && atomic_get(&fCancelled) == 0) {
+		BString path = stack.back();
+		stack.pop_back();
+		if (!visited.insert(path).second)
+			continue;
+
+		struct stat folderStat;
+		if (stat(path.String(), &folderStat) != 0
+			|| !S_ISDIR(folderStat.st_mode)) {
+			RemoveFolder(path);
+			continue;
+		}
+
+		// A change further down doesn't touch this folder, so its subfolders
+		// need a look even if it hasn't changed itself
+		std::vector<BString> subfolders;
+		fDataLock.Lock();
+		std::map<BString, folder_info>::iterator it = fFolders.find(path);
+		bool current = it != fFolders.end()
+			&& it->second.modified == folderStat.st_mtime;
+		if (current)
+			subfolders = it->second.folders;
+		fDataLock.Unlock();
+
+		if (!current) {
+			folder_info info;
+			if (!ReadFolder(path, folderStat.st_mtime, info))
+				continue;
+
+			subfolders = info.folders;
+
+			// Subfolders which went away take everything under them along
+			std::vector<BString> gone;
+			fDataLock.Lock();
+			it = fFolders.find(path);
+			if (it != fFolders.end()) {
+				const std::vector<BString>& old = it->second.folders;
+				for (size_t i = 0; i < old.size(); i++) {
+					if (std::find(subfolders.begin(), subfolders.end(), old[i])
+							== subfolders.end()) {
+						gone.push_back(BString(path) << "/" << old[i]);
+					}
+				}
+			}
+			std::swap(fFolders[path], info);
+			fDataLock.Unlock();
+
+			for (size_t i = 0; i < gone.size(); i++)
+				RemoveFolder(gone[i]);
+
+			// Let the windows show what has been found so far
+			if (++readCount % kNotifyInterval == 0)
+				NotifyWatchers();
+		}
+
+		for (int32 i = subfolders.size() - 1; i >= 0; i--)
+			stack.push_back(BString(path) << "/" << subfolders[i]);
+	}
+
+	STRACE(1, ("Checked %ld folders for file names and read %ld of them in "
+		"%lld us\n", (long)visited.size(), (long)readCount,
+		system_time() - startTime));
+}
+
+
+bool
+FileNameIndex::ReadFolder(const BString& path, time_t modified,
+	folder_info& info)
+{
+	BDirectory directory(path.String());
+	if (directory.InitCheck() != B_OK)
+		return false;
+
+	info.modified = modified;
+
+	BEntry entry;
+	while (directory.GetNextEntry(&entry, false) == B_OK) {
+		if (atomic_get(&fCancelled) != 0)
+			return false;
+
+		char name[B_FILE_NAME_LENGTH];
+		if (entry.GetName(name) != B_OK)
+			continue;
+
+		// Symbolic links count as files, so there are no loops to follow.
+		// Folders like .git are left out.
+		if (entry.IsDirectory()) {
+			if (name[0] != '.')
+				info.folders.push_back(name);
+		} else
+			info.files.push_back(name);
+	}
+
+	return true;
+}
+
+
+void
+FileNameIndex::RemoveFolder(const BString& path)
+{
+	BAutolock lock(fDataLock);
+
+	fFolders.erase(path);
+
+	// Everything under it sorts right after its path and a slash
+	BString prefix(path);
+	prefix << "/";
+	std::map<BString, folder_info>::iterator it = fFolders.lower_bound(prefix);
+	while (it != fFolders.end() && it->first.StartsWith(prefix))
+		fFolders.erase(it++);
+}
+
+
+void
+FileNameIndex::NotifyWatchers(void)
+{
+	fDataLock.Lock();
+	std::vector<BMessenger> watchers(fWatchers);
+	fDataLock.Unlock();
+
+	for (size_t i = 0; i < watchers.size(); i++)
+		watchers[i].SendMessage(M_FILE_NAMES_CHANGED);
+}
+
+
+int32
+FileNameIndex::Score(const BString& name, const BString& lowerName,
+	const BString& query, const BString& lowerQuery)
+{
+	int32 extra = std::min(lowerName.Length() - lowerQuery.Length(),
+		(int32)100);
+
+	if (name == query)
+		return 1000;
+	if (lowerName == lowerQuery)
+		return 900;
+	if (lowerName.StartsWith(lowerQuery))
+		return kPrefixMatchScore + 100 - extra;
+
+	int32 position = lowerName.FindFirst(lowerQuery);
+	if (position >= 0)
+		return 500 - std::min(position, (int32)50) - extra;
+
+	// The query's characters in order, the fewer of them apart the better
+	int32 matched = 0;
+	int32 gaps = 0;
+	for (int32 i = 0; i < lowerName.Length()
+			&& matched < lowerQuery.Length(); i++) {
+		if (lowerName[i] == lowerQuery[matched])
+			matched++;
+		else if (matched > 0)
+			gaps++;
+	}
+	if (matched < lowerQuery.Length())
+		return 0;
+
+	return std::max((int32)1, 300 - gaps * 10 - extra);
+}
@@ -0,0 +1,95 @@
+#ifndef FILE_NAME_INDEX_H
+#define FILE_NAME_INDEX_H
+
+
+#include <Locker.h>
+#include <Looper.h>
+#include <Messenger.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <map>
+#include <vector>
+
+
+// Sent to watchers whenever a scan has added or removed names
+enum {
+	M_FILE_NAMES_CHANGED = 'fnic'
+};
+
+
+struct file_name_match {
+	BString		path;
+	int32		score;
+	int32		folder;
+};
+
+// Matches scoring at least this have names which are or start with the query
+static const int32 kPrefixMatchScore = 600;
+
+
+// The names of the files under a set of folders, such as the project's and
+// the system's header folders, so files can be found by name without
+// walking the folders every time. The folders are scanned on the looper's
+// own thread. After the first scan, Refresh() only reads the folders whose
+// modification time has changed, which is what happens when entries are
+// added to or removed from them. Find() can be called from any thread at
+// any time, also while a scan is still going on.
+class FileNameIndex : public BLooper {
+public:
+								FileNameIndex(void);
+	virtual						~FileNameIndex(void);
+
+	virtual	void				MessageReceived(BMessage* message);
+
+			// Scans folders the index doesn't have yet and checks the
+			// others for changes
+			void				Refresh(const BStringList& folders);
+			bool				IsScanning(void) const;
+
+			void				StartWatching(BMessenger target);
+			void				StopWatching(BMessenger target);
+
+			// Stops any scan in progress and quits the looper
+			void				Shutdown(void);
+
+			// Puts up to maxCount of the files under folders whose names
+			// match query into matches, best first. Names starting with
+			// query beat ones just containing it, which beat ones containing
+			// its characters in order, and files under earlier folders win
+			// ties. A query with a slash in it has to match the end of the
+			// path.
+			void				Find(const char* query,
+									const BStringList& folders, int32 maxCount,
+									std::vector<file_name_match>& matches);
+
+private:
+	struct folder_info {
+		time_t					modified;
+		std::vector<BString>	files;
+		std::vector<BString>	folders;
+	};
+
+			void				Scan(const BStringList& folders);
+			bool				ReadFolder(const BString& path,
+									time_t modified, folder_info& info);
+			void				RemoveFolder(const BString& path);
+			void				NotifyWatchers(void);
+
+	static	int32				Score(const BString& name,
+									const BString& lowerName,
+									const BString& query,
+									const BString& lowerQuery);
+
+			int32				fCancelled;
+			int32				fScanning;
+
+			// Guards everything below. It is only held briefly, never
+			// while reading folders.
+			BLocker				fDataLock;
+			std::map<BString, folder_info>	fFolders;
+			std::vector<BMessenger>	fWatchers;
+};
+
+
+#endif	// FILE_NAME_INDEX_H
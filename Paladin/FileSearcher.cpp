@@ -0,0 +1,624 @@
+#include "FileSearcher.h"
+
+#include <ctype.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <fcntl.h>
+#include <OS.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "CRegex.h"
+#include "DebugTools.h"
+#include "Globals.h"
+
+// Only the start of a file is checked for NUL bytes, like grep does
+static const size_t kBinaryCheckSize = 4096;
+
+// How long a worker waits for room in the target's queue before checking
+// whether the search was cancelled
+static const bigtime_t kSendTimeout = 100000;
+
+
+static bool
+IsWordChar(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+
+// Picks the longest run of plain characters every match of a pattern has to
+// contain, or nothing if that can't be told easily
+static BString
+RequiredLiteral(const char *pattern)
+{
+	BString longest;
+	if (strchr(pattern, '|') != NULL || strstr(pattern, "(?") != NULL)
+		return longest;
+
+	BString run;
+	int32 depth = 0;
+	for (const char *c = pattern; *c != '\0'; c++)
+	{
+		char literal = 0;
+		switch (*c)
+		{
+			case '\\':
+			{
+				// Escaped punctuation stands for itself. Anything else, like
+				// \d, \x41 or \p{L}, ends the run, and what it takes after
+				// it mustn't be mistaken for plain characters.
+				if (c[1] == '\0')
+					break;
+				c++;
+				if (!isalnum((unsigned char)*c))
+				{
+					literal = *c;
+					break;
+				}
+				if (*c == 'Q')
+				{
+					while (c[1] != '\0' && !(c[0] == '\\' && c[1] == 'E'))
+						c++;
+					if (c[1] != '\0')
+						c++;
+					break;
+				}
+				if (*c == 'x')
+				{
+					while (isxdigit((unsigned char)c[1]))
+						c++;
+				}
+				else if (*c == 'c')
+				{
+					if (c[1] != '\0')
+						c++;
+				}
+				else if (isdigit((unsigned char)*c))
+				{
+					while (isdigit((unsigned char)c[1]))
+						c++;
+				}
+				if (c[1] == '{' || c[1] == '<')
+				{
+					char close = c[1] == '{' ? '}' : '>';
+					while (c[1] != '\0' && *c != close)
+						c++;
+				}
+				break;
+			}
+			case '[':
+			{
+				c++;
+				if (*c == '^')
+					c++;
+				if (*c == ']')
+					c++;
+				while (*c != '\0' && *c != ']')
+					c++;
+				if (*c == '\0')
+					c--;
+				break;
+			}
+			case '(':
+				depth++;
+				break;
+			case ')':
+				depth = std::max((int32)0, depth - 1);
+				break;
+			case '?':
+			case '*':
+			case '{':
+			{
+				// The last character was optional after all
+				if (run.Length() > 0)
+					run.Truncate(run.Length() - 1);
+				if (*c == '{')
+				{
+					while (c[1] != '\0' && *c != '}')
+						c++;
+				}
+				break;
+			}
+			case '.':
+			case '^':
+			case '$':
+			case '+':
+				break;
+			default:
+				literal = *c;
+				break;
+		}
+
+		// Whatever is in a group might be optional
+		if (literal != 0 && depth == 0)
+		{
+			run << literal;
+			continue;
+		}
+
+		if (run.Length() > longest.Length())
+			longest = run;
+		run = "";
+	}
+
+	if (run.Length() > longest.Length())
+		longest = run;
+
+	return longest;
+}
+
+
+FileSearcher::FileSearcher(const char *pattern, bool isRegex, bool ignoreCase,
+							bool matchWord)
+	:	fPattern(pattern),
+		fIsRegex(isRegex),
+		fExpandReplacement(isRegex),
+		fIgnoreCase(ignoreCase),
+		fMatchWord(matchWord),
+		fInitStatus(B_OK),
+		fFiles(NULL),
+		fCancel(NULL),
+		fNextFile(0),
+		fMatchCount(0)
+{
+	if (fPattern.Length() == 0)
+	{
+		fInitStatus = B_BAD_VALUE;
+		return;
+	}
+
+	if (!fIsRegex)
+	{
+		fLiteral = fPattern;
+
+		// Caseless matching of anything outside ASCII is left to PCRE
+		for (int32 i = 0; i < fPattern.Length() && fIgnoreCase; i++)
+		{
+			if ((unsigned char)fPattern[i] >= 0x80)
+			{
+				fIsRegex = true;
+				for (int32 j = fPattern.Length() - 1; j >= 0; j--)
+				{
+					if (!isalnum((unsigned char)fPattern[j])
+						&& (unsigned char)fPattern[j] < 0x80)
+						fPattern.Insert('\\', 1, j);
+				}
+				break;
+			}
+		}
+	}
+	else
+		fLiteral = RequiredLiteral(fPattern.String());
+
+	// The prefilter only folds ASCII
+	for (int32 i = 0; i < fLiteral.Length() && fIgnoreCase; i++)
+	{
+		if ((unsigned char)fLiteral[i] >= 0x80)
+		{
+			fLiteral = "";
+			break;
+		}
+	}
+
+	if (fIsRegex)
+	{
+		CRegex regex(fPattern.String(), fIgnoreCase, fMatchWord);
+		fInitStatus = regex.InitCheck();
+		if (fInitStatus != B_OK)
+			fError = regex.ErrorStr();
+	}
+}
+
+
+FileSearcher::~FileSearcher(void)
+{
+}
+
+
+int32
+FileSearcher::Search(const std::vector<BString> &files, BMessenger target,
+					const BMessage &resultTemplate, int32 *cancel)
+{
+	if (fInitStatus != B_OK)
+		return 0;
+
+	fFiles = &files;
+	fTarget = target;
+	fTemplate = resultTemplate;
+	fCancel = cancel;
+	fNextFile = 0;
+	fMatchCount = 0;
+
+	bigtime_t startTime = system_time();
+
+	int32 threadCount = std::max(1, std::min((int)gCPUCount, (int)files.size()));
+	std::vector<thread_id> threads;
+	for (int32 i = 0; i < threadCount; i++)
+	{
+		thread_id thread = spawn_thread(WorkerThread, "search worker",
+										B_NORMAL_PRIORITY, this);
+		if (thread < 0)
+			break;
+
+		threads.push_back(thread);
+		resume_thread(thread);
+	}
+
+	if (threads.empty())
+		WorkerThread(this);
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+
+	STRACE(1,("Searched %ld files for %s with %ld threads in %lld us: "
+			"%ld matching lines\n", (long)files.size(), fPattern.String(),
+			(long)threads.size(), system_time() - startTime, (long)fMatchCount));
+
+	return fMatchCount;
+}
+
+
+int32
+FileSearcher::ReplaceMatches(const char *data, size_t length,
+							const char *replacement, std::string &output) const
+{
+	output.clear();
+
+	const char *end = data + length;
+	if (fInitStatus != B_OK
+		|| memchr(data, '\0', std::min(length, kBinaryCheckSize)) != NULL
+		|| (fLiteral.Length() > 0 && FindLiteral(data, end) == NULL))
+		return 0;
+
+	size_t replacementLength = strlen(replacement);
+	const char *copied = data;
+	int32 count = 0;
+
+	if (!fIsRegex)
+	{
+		size_t literalLength = fLiteral.Length();
+		const char *position = data;
+		const char *match;
+		while (position < end && (match = FindLiteral(position, end)) != NULL)
+		{
+			if (fMatchWord && !IsWordMatch(data, end, match, literalLength))
+			{
+				position = match + 1;
+				continue;
+			}
+
+			output.append(copied, match - copied);
+			output.append(replacement, replacementLength);
+			copied = position = match + literalLength;
+			count++;
+		}
+	}
+	else
+	{
+		// Compiled here so that every thread has its own
+		CRegex regex(fPattern.String(), fIgnoreCase, fMatchWord);
+		int32 offset = 0;
+		while (offset <= (int32)length
+			&& regex.Match(data, length, offset) == B_OK)
+		{
+			const char *match = data + regex.MatchStart();
+			const char *matchEnd = match + regex.MatchLen();
+
+			output.append(copied, match - copied);
+			if (fExpandReplacement)
+			{
+				char *expanded = regex.ReplaceString(data, length, replacement);
+				if (expanded != NULL)
+				{
+					output.append(expanded);
+					free(expanded);
+				}
+			}
+			else
+				output.append(replacement, replacementLength);
+			copied = matchEnd;
+			count++;
+
+			// An empty match would be found again at the same place, so skip
+			// ahead by a whole UTF-8 character
+			offset = matchEnd - data;
+			if (match == matchEnd)
+			{
+				if (matchEnd == end)
+					break;
+				offset++;
+				while (offset < (int32)length && (data[offset] & 0xc0) == 0x80)
+					offset++;
+			}
+		}
+	}
+
+	if (count == 0)
+	{
+		output.clear();
+		return 0;
+	}
+
+	output.append(copied, end - copied);
+	return count;
+}
+
+
+void
+FileSearcher::CollectFiles(const char *folder, std::vector<BString> &files,
+							int32 *cancel)
+{
+	BDirectory directory(folder);
+	if (directory.InitCheck() != B_OK)
+		return;
+
+	BEntry entry;
+	while (directory.GetNextEntry(&entry, false) == B_OK)
+	{
+		if (cancel != NULL && atomic_get(cancel) != 0)
+			return;
+
+		char name[B_FILE_NAME_LENGTH];
+		if (entry.GetName(name) != B_OK)
+			continue;
+
+		BString path(folder);
+		path << "/" << name;
+
+		if (entry.IsDirectory())
+		{
+			// Skip the likes of .git and .hg
+			if (name[0] != '.')
+				CollectFiles(path.String(), files, cancel);
+		}
+		else if (entry.IsFile())
+			files.push_back(path);
+	}
+}
+
+
+int32
+FileSearcher::WorkerThread(void *data)
+{
+	FileSearcher *searcher = static_cast<FileSearcher*>(data);
+
+	// CRegex keeps its match state, so each thread needs its own
+	CRegex regex;
+	if (searcher->fIsRegex)
+		regex.SetTo(searcher->fPattern.String(), searcher->fIgnoreCase,
+					searcher->fMatchWord);
+
+	int32 fileCount = searcher->fFiles->size();
+	while (atomic_get(searcher->fCancel) == 0)
+	{
+		int32 index = atomic_add(&searcher->fNextFile, 1);
+		if (index >= fileCount)
+			break;
+
+		const BString &path = (*searcher->fFiles)[index];
+		BMessage results(searcher->fTemplate);
+		searcher->SearchFile(path, &regex, results);
+
+		int32 count;
+		type_code type;
+		if (results.GetInfo("line", &type, &count) != B_OK)
+			continue;
+
+		atomic_add(&searcher->fMatchCount, count);
+		results.AddString("path", path);
+
+		// The target might be busy, and it might be waiting for us to quit
+		status_t status;
+		do
+		{
+			status = searcher->fTarget.SendMessage(&results, (BHandler*)NULL,
+													kSendTimeout);
+		} while (status == B_TIMED_OUT && atomic_get(searcher->fCancel) == 0);
+	}
+
+	return 0;
+}
+
+
+void
+FileSearcher::SearchFile(const BString &path, CRegex *regex, BMessage &results)
+{
+	int fd = open(path.String(), O_RDONLY);
+	if (fd < 0)
+		return;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)
+		|| fileStat.st_size == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	size_t length = fileStat.st_size;
+	char *data = (char*)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	bool mapped = data != MAP_FAILED;
+	if (!mapped)
+	{
+		data = (char*)malloc(length);
+		if (data == NULL || read(fd, data, length) != (ssize_t)length)
+		{
+			free(data);
+			close(fd);
+			return;
+		}
+	}
+	close(fd);
+
+	const char *end = data + length;
+	if (memchr(data, '\0', std::min(length, kBinaryCheckSize)) == NULL
+		&& (fLiteral.Length() == 0 || FindLiteral(data, end) != NULL))
+	{
+		if (fIsRegex)
+			MatchRegex(data, length, regex, results);
+		else
+			MatchLiteral(data, length, results);
+	}
+
+	if (mapped)
+		munmap(data, length);
+	else
+		free(data);
+}
+
+
+int32
+FileSearcher::MatchLiteral(const char *data, size_t length, BMessage &results)
+{
+	const char *end = data + length;
+	const char *lineStart = data;
+	int32 line = 1;
+	int32 count = 0;
+
+	const char *position = data;
+	const char *match;
+	while (position < end && (match = FindLiteral(position, end)) != NULL)
+	{
+		if (fMatchWord && !IsWordMatch(data, end, match, fLiteral.Length()))
+		{
+			position = match + 1;
+			continue;
+		}
+
+		AddLine(data, end, match, line, lineStart, results);
+		count++;
+
+		// One result per line is enough
+		const char *lineEnd = (const char*)memchr(match, '\n', end - match);
+		position = lineEnd != NULL ? lineEnd + 1 : end;
+	}
+
+	return count;
+}
+
+
+int32
+FileSearcher::MatchRegex(const char *data, size_t length, CRegex *regex,
+						BMessage &results)
+{
+	const char *end = data + length;
+	const char *lineStart = data;
+	int32 line = 1;
+	int32 count = 0;
+
+	int32 offset = 0;
+	while (offset < (int32)length
+		&& regex->Match(data, length, offset) == B_OK)
+	{
+		const char *match = data + regex->MatchStart();
+		AddLine(data, end, match, line, lineStart, results);
+		count++;
+
+		const char *lineEnd = (const char*)memchr(match, '\n', end - match);
+		if (lineEnd == NULL)
+			break;
+		offset = lineEnd + 1 - data;
+	}
+
+	return count;
+}
+
+
+const char *
+FileSearcher::FindLiteral(const char *data, const char *end) const
+{
+	size_t length = fLiteral.Length();
+	const char *literal = fLiteral.String();
+
+	if (!fIgnoreCase)
+	{
+		// memchr() is vectorized, so let it find the candidates
+		const char *last = end - length;
+		while (data <= last)
+		{
+			data = (const char*)memchr(data, literal[0], last - data + 1);
+			if (data == NULL)
+				return NULL;
+			if (memcmp(data, literal, length) == 0)
+				return data;
+			data++;
+		}
+		return NULL;
+	}
+
+	char lower = tolower((unsigned char)literal[0]);
+	char upper = toupper((unsigned char)literal[0]);
+	const char *last = end - length;
+	const char *nextLower = NULL;
+	const char *nextUpper = lower == upper ? end : NULL;
+	while (data <= last)
+	{
+		// Look for both cases of the first character, keeping whichever
+		// candidate hasn't been used up yet
+		if (nextLower == NULL || nextLower < data)
+		{
+			nextLower = (const char*)memchr(data, lower, last - data + 1);
+			if (nextLower == NULL)
+				nextLower = end;
+		}
+		if (nextUpper == NULL || nextUpper < data)
+		{
+			nextUpper = (const char*)memchr(data, upper, last - data + 1);
+			if (nextUpper == NULL)
+				nextUpper = end;
+		}
+
+		data = std::min(nextLower, nextUpper);
+		if (data > last)
+			return NULL;
+		if (strncasecmp(data, literal, length) == 0)
+			return data;
+		data++;
+	}
+	return NULL;
+}
+
+
+bool
+FileSearcher::IsWordMatch(const char *data, const char *end, const char *match,
+						size_t length) const
+{
+	if (match > data && IsWordChar(match[-1]))
+		return false;
+	if (match + length < end && IsWordChar(match[length]))
+		return false;
+	return true;
+}
+
+
+void
+FileSearcher::AddLine(const char *data, const char *end, const char *match,
+					int32 &line, const char *&lineStart, BMessage &results) const
+{
+	// Count the lines skipped since the last match
+	const char *newline;
+	while ((newline = (const char*)memchr(lineStart, '\n', match - lineStart))
+			!= NULL)
+	{
+		line++;
+		lineStart = newline + 1;
+	}
+
+	const char *lineEnd = (const char*)memchr(match, '\n', end - match);
+	if (lineEnd == NULL)
+		lineEnd = end;
+	if (lineEnd > lineStart && lineEnd[-1] == '\r')
+		lineEnd--;
+
+	results.AddInt32("line", line);
+	results.AddString("text", BString(lineStart, lineEnd - lineStart));
+}
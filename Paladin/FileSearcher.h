@@ -0,0 +1,86 @@
+#ifndef FILESEARCHER_H
+#define FILESEARCHER_H
+
+#include <Message.h>
+#include <Messenger.h>
+#include <String.h>
+
+#include <string>
+#include <vector>
+
+class CRegex;
+
+// Searches files for a literal string or a regular expression with a pool of
+// threads, one file at a time per thread. Files are mapped instead of read,
+// files which don't contain the pattern's literal part are ruled out with a
+// memchr() scan before any line splitting or regex matching is done, and
+// binary files are skipped. The matches of each file are sent to the target
+// as soon as the file is done, in a copy of the result template holding
+// "path", "line" and "text" fields for each matching line.
+class FileSearcher
+{
+public:
+							FileSearcher(const char *pattern, bool isRegex,
+										bool ignoreCase, bool matchWord);
+							~FileSearcher(void);
+
+			status_t		InitCheck(void) const { return fInitStatus; }
+			const BString &	ErrorString(void) const { return fError; }
+
+			// The part every match must contain, empty if there is none
+			const BString &	Literal(void) const { return fLiteral; }
+
+			// Blocks until all files have been searched or cancel becomes
+			// nonzero. Returns the number of matching lines.
+			int32			Search(const std::vector<BString> &files,
+									BMessenger target,
+									const BMessage &resultTemplate,
+									int32 *cancel);
+
+			// Puts data into output with every match replaced. For regular
+			// expressions, \1 to \9 and $1 to $9 in the replacement stand for
+			// the groups of the match. Returns the number of replacements,
+			// which is 0 for binary data. Can be called from any thread.
+			int32			ReplaceMatches(const char *data, size_t length,
+											const char *replacement,
+											std::string &output) const;
+
+	// Adds the regular files under folder, leaving out hidden folders
+	static	void			CollectFiles(const char *folder,
+										std::vector<BString> &files,
+										int32 *cancel);
+
+private:
+	static	int32			WorkerThread(void *data);
+			void			SearchFile(const BString &path, CRegex *regex,
+										BMessage &results);
+			int32			MatchLiteral(const char *data, size_t length,
+										BMessage &results);
+			int32			MatchRegex(const char *data, size_t length,
+										CRegex *regex, BMessage &results);
+			const char *	FindLiteral(const char *data, const char *end) const;
+			bool			IsWordMatch(const char *data, const char *end,
+										const char *match, size_t length) const;
+			void			AddLine(const char *data, const char *end,
+									const char *match, int32 &line,
+									const char *&lineStart,
+									BMessage &results) const;
+
+			BString			fPattern;
+			BString			fLiteral;
+			bool			fIsRegex;
+			bool			fExpandReplacement;
+			bool			fIgnoreCase;
+			bool			fMatchWord;
+			status_t		fInitStatus;
+			BString			fError;
+
+			const std::vector<BString> *	fFiles;
+			BMessenger		fTarget;
+			BMessage		fTemplate;
+			int32 *			fCancel;
+			int32			fNextFile;
+			int32			fMatchCount;
+};
+
+#endif
@@ -4,11 +4,14 @@
 #include <Bitmap.h>
 #include <Catalog.h>
 #include <Directory.h>
+#include <FindDirectory.h>
 #include <Locale.h>
 #include <Mime.h>
 #include <Path.h>
 #include <Roster.h>
 
+#include "DPath.h"
+#include "Globals.h"
 #include "Icons.h"
 #include "Paladin.h"
 #include "Project.h"
@@ -159,3 +162,41 @@ FindProject(entry_ref folder, const char *name)
 		entry.GetRef(&returnRef);
 	return returnRef;
 }
+
+
+void
+GetHeaderFolders(BStringList &folders)
+{
+	BPath sysDevPath;
+	find_directory(B_SYSTEM_DEVELOP_DIRECTORY, &sysDevPath, false);
+	folders.Add(sysDevPath.Path());
+	
+	DPath hPath(B_SYSTEM_HEADERS_DIRECTORY);
+	folders.Add(hPath.GetFullPath());
+	
+	hPath = DPath(B_SYSTEM_NONPACKAGED_HEADERS_DIRECTORY);
+	folders.Add(hPath.GetFullPath());
+	
+	hPath = DPath(B_SYSTEM_NONPACKAGED_DEVELOP_DIRECTORY);
+	folders.Add(hPath.GetFullPath());
+	
+	hPath = DPath(B_USER_HEADERS_DIRECTORY);
+	folders.Add(hPath.GetFullPath());
+	
+	hPath = DPath(B_USER_NONPACKAGED_DEVELOP_DIRECTORY);
+	folders.Add(hPath.GetFullPath());
+	
+	hPath = DPath(B_USER_DEVELOP_DIRECTORY);
+	folders.Add(hPath.GetFullPath());
+	
+	DPath path(B_USER_CONFIG_DIRECTORY);
+	path << "include";
+	folders.Add(path.GetFullPath());
+	
+	if (gPlatform == PLATFORM_HAIKU || gPlatform == PLATFORM_HAIKU_GCC4)
+	{
+		path.SetTo(B_USER_NONPACKAGED_DIRECTORY);
+		path << "include";
+		folders.Add(path.GetFullPath());
+	}
+}
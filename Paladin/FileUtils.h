@@ -3,12 +3,14 @@
 
 #include <Entry.h>
 #include <Message.h>
+#include <StringList.h>
 
 class Project;
 
 void				FindAndOpenFile(BMessage *msg);
 entry_ref			FindFile(entry_ref folder,const char *name);
 entry_ref			FindProject(entry_ref folder,const char *name);
+void				GetHeaderFolders(BStringList &folders);
 
 void				InitFileTypes(void);
 
@@ -1,18 +1,25 @@
 #include "FindOpenFileWindow.h"
 
+#include <Alert.h>
 #include <Application.h>
 #include <Button.h>
 #include <Catalog.h>
 #include <CheckBox.h>
-#include <FindDirectory.h>
+#include <Entry.h>
 #include <LayoutBuilder.h>
+#include <ListView.h>
 #include <Locale.h>
-#include <Path.h>
+#include <ScrollView.h>
 #include <Size.h>
+#include <StringItem.h>
 #include <View.h>
 
+#include <vector>
+
 #include "AutoTextControl.h"
 #include "EscapeCancelFilter.h"
+#include "FileNameIndex.h"
+#include "FileUtils.h"
 #include "MsgDefs.h"
 #include "Globals.h"
 #include "Project.h"
@@ -22,21 +29,72 @@
 #define B_TRANSLATION_CONTEXT "FindOpenFileWindow"
 
 #define	M_FIND_FILE 'fnfl'
+#define M_NAME_CHANGED 'fnnc'
+
+// How many matches are shown while typing
+static const int32 kMaxMatches = 50;
+
+
+// Lets the arrow keys pick a match without leaving the name box
+class MatchKeyFilter : public AutoTextControlFilter {
+public:
+	MatchKeyFilter(AutoTextControl* box, BListView* list)
+		:
+		AutoTextControlFilter(box),
+		fList(list)
+	{
+	}
+
+	virtual filter_result KeyFilter(const int32& key, const int32& mod)
+	{
+		if (key != B_UP_ARROW && key != B_DOWN_ARROW)
+			return AutoTextControlFilter::KeyFilter(key, mod);
+
+		int32 count = fList->CountItems();
+		if (count == 0)
+			return B_SKIP_MESSAGE;
+
+		int32 selection = fList->CurrentSelection();
+		if (key == B_UP_ARROW)
+			selection = selection > 0 ? selection - 1 : 0;
+		else
+			selection = selection < count - 1 ? selection + 1 : count - 1;
+
+		fList->Select(selection);
+		fList->ScrollToSelection();
+		return B_SKIP_MESSAGE;
+	}
+
+private:
+	BListView*	fList;
+};
 
 
 FindOpenFileWindow::FindOpenFileWindow(const char* panelText)
 	:
 	DWindow(BRect(0, 0, 0, 0), B_TRANSLATE("Find and open file"), B_TITLED_WINDOW,
-		B_NOT_RESIZABLE | B_NOT_ZOOMABLE | B_AUTO_UPDATE_SIZE_LIMITS)
+		B_NOT_ZOOMABLE | B_AUTO_UPDATE_SIZE_LIMITS),
+	fAutoSelection(-1)
 {
 	AddCommonFilter(new EscapeCancelFilter());
 
 	fNameTextControl = new AutoTextControl("nameText", B_TRANSLATE("Open: "), "",
-		new BMessage);
+		new BMessage(M_NAME_CHANGED));
 	fNameTextControl->SetExplicitMinSize(
 		BSize(fNameTextControl->StringWidth("M") * 20, B_SIZE_UNSET));
 	fSystemCheckBox = new BCheckBox("systembox", B_TRANSLATE("Search only system folders"),
-		new BMessage);
+		new BMessage(M_NAME_CHANGED));
+
+	fMatchList = new BListView("matches");
+	fMatchList->SetInvocationMessage(new BMessage(M_FIND_FILE));
+	BScrollView* matchScroll = new BScrollView("matchscroll", fMatchList, 0,
+		false, true);
+	matchScroll->SetExplicitMinSize(
+		BSize(fNameTextControl->StringWidth("M") * 40,
+			fNameTextControl->StringWidth("M") * 12));
+
+	fNameTextControl->SetFilter(new MatchKeyFilter(fNameTextControl,
+		fMatchList));
 
 	BButton* cancel = new BButton("cancel", B_TRANSLATE("Cancel"),
 		new BMessage(B_QUIT_REQUESTED));
@@ -49,7 +107,7 @@ FindOpenFileWindow::FindOpenFileWindow(const char* panelText)
 			.Add(fNameTextControl->CreateTextViewLayoutItem(), 1, 0)
 			.Add(fSystemCheckBox, 1, 1)
 			.End()
-		.AddGlue()
+		.Add(matchScroll)
 		.AddGroup(B_HORIZONTAL)
 			.AddGlue()
 			.Add(cancel)
@@ -75,56 +133,41 @@ FindOpenFileWindow::FindOpenFileWindow(const char* panelText)
 
 	fNameTextControl->MakeFocus(true);
 
+	// Catch up on whatever changed since the index was last refreshed, and
+	// show the matches as they come in
+	if (gFileNameIndex != NULL) {
+		BStringList folders;
+		_GetFolders(folders);
+		gFileNameIndex->StartWatching(BMessenger(this));
+		gFileNameIndex->Refresh(folders);
+	}
+	_UpdateMatches();
+
 	CenterOnScreen();
 }
 
 
+FindOpenFileWindow::~FindOpenFileWindow(void)
+{
+	if (gFileNameIndex != NULL)
+		gFileNameIndex->StopWatching(BMessenger(this));
+}
+
+
 void
 FindOpenFileWindow::MessageReceived(BMessage* message)
 {
 	switch (message->what) {
+		case M_NAME_CHANGED:
+		case M_FILE_NAMES_CHANGED:
+		{
+			_UpdateMatches();
+			break;
+		}
+
 		case M_FIND_FILE:
 		{
-			BMessage findmessage(M_FIND_AND_OPEN_FILE);
-			findmessage.AddString("name", fNameTextControl->Text());
-
-			if (fSystemCheckBox->Value() == B_CONTROL_OFF)
-				findmessage.AddString("folder", gCurrentProject->GetPath().GetFolder());
-			
-			BPath sysDevPath;
-			find_directory(B_SYSTEM_DEVELOP_DIRECTORY, &sysDevPath, false);
-			findmessage.AddString("folder", sysDevPath.Path());
-			
-			DPath hPath(B_SYSTEM_HEADERS_DIRECTORY);
-			findmessage.AddString("folder",hPath.GetFullPath());
-			
-			hPath = DPath(B_SYSTEM_NONPACKAGED_HEADERS_DIRECTORY );
-			findmessage.AddString("folder",hPath.GetFullPath());
-			
-			hPath = DPath(B_SYSTEM_NONPACKAGED_DEVELOP_DIRECTORY );
-			findmessage.AddString("folder",hPath.GetFullPath());
-			
-			hPath = DPath(B_USER_HEADERS_DIRECTORY );
-			findmessage.AddString("folder",hPath.GetFullPath());
-			
-			hPath = DPath(B_USER_NONPACKAGED_DEVELOP_DIRECTORY   );
-			findmessage.AddString("folder",hPath.GetFullPath());
-			
-			hPath = DPath(B_USER_DEVELOP_DIRECTORY  );
-			findmessage.AddString("folder",hPath.GetFullPath());
-			
-			DPath path(B_USER_CONFIG_DIRECTORY);
-			path << "include";
-			findmessage.AddString("folder", path.GetFullPath());
-
-			if (gPlatform == PLATFORM_HAIKU || gPlatform == PLATFORM_HAIKU_GCC4) {
-				path.SetTo(B_USER_NONPACKAGED_DIRECTORY);
-				path << "include";
-				findmessage.AddString("folder", path.GetFullPath());
-			}
-
-			be_app->PostMessage(&findmessage);
-			PostMessage(B_QUIT_REQUESTED);
+			_OpenFile();
 			break;
 		}
 
@@ -133,3 +176,102 @@ FindOpenFileWindow::MessageReceived(BMessage* message)
 			break;
 	}
 }
+
+
+void
+FindOpenFileWindow::_GetFolders(BStringList& folders) const
+{
+	if (fSystemCheckBox->Value() == B_CONTROL_OFF && gCurrentProject != NULL) {
+		folders.Add(gCurrentProject->GetPath().GetFolder());
+		for (int32 i = 0; i < gCurrentProject->CountLocalIncludes(); i++)
+			folders.Add(gCurrentProject->LocalIncludeAt(i).Absolute());
+		for (int32 i = 0; i < gCurrentProject->CountSystemIncludes(); i++)
+			folders.Add(gCurrentProject->SystemIncludeAt(i));
+	}
+
+	GetHeaderFolders(folders);
+}
+
+
+void
+FindOpenFileWindow::_UpdateMatches(void)
+{
+	if (gFileNameIndex == NULL)
+		return;
+
+	BStringList folders;
+	_GetFolders(folders);
+
+	std::vector<file_name_match> matches;
+	gFileNameIndex->Find(fNameTextControl->Text(), folders, kMaxMatches,
+		matches);
+
+	// Keep a file the user picked selected if it is still there
+	BString picked;
+	int32 selection = fMatchList->CurrentSelection();
+	BStringItem* item = dynamic_cast<BStringItem*>(
+		fMatchList->ItemAt(selection));
+	if (item != NULL && selection != fAutoSelection)
+		picked = item->Text();
+
+	for (int32 i = fMatchList->CountItems() - 1; i >= 0; i--)
+		delete fMatchList->RemoveItem(i);
+
+	selection = -1;
+	fAutoSelection = -1;
+	for (size_t i = 0; i < matches.size(); i++) {
+		fMatchList->AddItem(new BStringItem(matches[i].path.String()));
+		if (picked.Length() > 0 && matches[i].path == picked)
+			selection = i;
+	}
+
+	// Otherwise only a file whose name is or starts with what was typed is
+	// opened without asking, not one which merely has the same letters
+	if (selection < 0 && !matches.empty()
+		&& matches[0].score >= kPrefixMatchScore) {
+		selection = fAutoSelection = 0;
+	}
+
+	if (selection >= 0) {
+		fMatchList->Select(selection);
+		fMatchList->ScrollToSelection();
+	}
+}
+
+
+void
+FindOpenFileWindow::_OpenFile(void)
+{
+	BStringItem* item = dynamic_cast<BStringItem*>(
+		fMatchList->ItemAt(fMatchList->CurrentSelection()));
+
+	entry_ref ref;
+	if (item != NULL && get_ref_for_path(item->Text(), &ref) == B_OK) {
+		BMessage refMessage(B_REFS_RECEIVED);
+		refMessage.AddRef("refs", &ref);
+		be_app->PostMessage(&refMessage);
+		PostMessage(B_QUIT_REQUESTED);
+		return;
+	}
+
+	if (gFileNameIndex != NULL && !gFileNameIndex->IsScanning()) {
+		BString errorstr = B_TRANSLATE("Couldn't find %file%.");
+		errorstr.ReplaceFirst("%file%", fNameTextControl->Text());
+		BAlert* alert = new BAlert("Paladin", errorstr.String(),
+			B_TRANSLATE("OK"));
+		alert->Go(NULL);
+		return;
+	}
+
+	// The index hasn't got that far yet, so walk the folders instead
+	BMessage findmessage(M_FIND_AND_OPEN_FILE);
+	findmessage.AddString("name", fNameTextControl->Text());
+
+	BStringList folders;
+	_GetFolders(folders);
+	for (int32 i = 0; i < folders.CountStrings(); i++)
+		findmessage.AddString("folder", folders.StringAt(i));
+
+	be_app->PostMessage(&findmessage);
+	PostMessage(B_QUIT_REQUESTED);
+}
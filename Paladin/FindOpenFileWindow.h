@@ -11,20 +11,33 @@
 #define _FIND_OPEN_FILE_WINDOW_H
 
 
+#include <StringList.h>
+
 #include "DWindow.h"
 
 
 class AutoTextControl;
 class BCheckBox;
+class BListView;
 
 class FindOpenFileWindow : public DWindow {
 public:
 								FindOpenFileWindow(const char* panelText);
+	virtual						~FindOpenFileWindow(void);
 			void				MessageReceived(BMessage* message);
 
 private:
+			void				_GetFolders(BStringList& folders) const;
+			void				_UpdateMatches(void);
+			void				_OpenFile(void);
+
 			AutoTextControl*	fNameTextControl;
 			BCheckBox*			fSystemCheckBox;
+			BListView*			fMatchList;
+
+			// The row _UpdateMatches() selected itself. Any other selection
+			// was made by the user.
+			int32				fAutoSelection;
 };
 
 
@@ -2,22 +2,31 @@
 
 #include <Alert.h>
 #include <Catalog.h>
+#include <ctype.h>
+#include <File.h>
 #include <Font.h>
 #include <Locale.h>
 #include <Roster.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <StringView.h>
 
 #include <LayoutBuilder.h>
 
+#include <set>
+
 #include "DListView.h"
 #include "DTextView.h"
+#include "FileSearcher.h"
 #include "Globals.h"
 #include "LaunchHelper.h"
 #include "Paladin.h"
 #include "Project.h"
+#include "ReplaceSet.h"
+#include "SearchIndex.h"
 #include "SourceFile.h"
+#include "SymbolXref.h"
 #include "DebugTools.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -34,22 +43,39 @@ enum
 	M_TOGGLE_MATCH_WORD = 'tgmw',
 	M_FIND_CHANGED = 'fnch',
 	M_REPLACE_CHANGED = 'rpch',
-	M_SET_PROJECT = 'stpj'
+	M_SET_PROJECT = 'stpj',
+	M_SEARCH_RESULTS = 'srrs',
+	M_SEARCH_DONE = 'srdn',
+	M_REPLACE_PREVIEW = 'rppv',
+	M_APPLY_REPLACE = 'aprp',
+	M_REPLACE_DONE = 'rpdn',
+	M_UNDO_REPLACE = 'unrp',
+	M_FIND_SYMBOL = 'fnsy',
+	M_SYMBOL_RESULTS = 'syrs'
 };
 
 enum
 {
 	THREAD_FIND = 0,
-	THREAD_REPLACE,
-	THREAD_REPLACE_ALL
+	THREAD_BUILD_REPLACE,
+	THREAD_APPLY_REPLACE,
+	THREAD_UNDO_REPLACE,
+	THREAD_FIND_SYMBOL
 };
 
+// How many of the files a replace changes are listed in its preview
+static const int32 kPreviewFileCount = 15;
+
+// How many symbols a symbol search lists
+static const int32 kMaxSymbolCount = 100;
+
 class GrepListItem : public RefListItem
 {
 public:
 			GrepListItem(BString fullPath, BString relPath, 
 				entry_ref ref, int32 line, const char *linestr);
 	int32	GetLine(void) const;
+	const BString &	GetPath(void) const { return fFullPath; }
 
 private:
 	BString	fFullPath;
@@ -58,48 +84,6 @@ private:
 	BString	fLineString;
 };
 
-void
-TokenizeToList(const char *string, BObjectList<BString> &stringList)
-{
-	if (!string)
-		return;
-	
-	char *workstr = strdup(string);
-	strtok(workstr, "\n");
-	
-	char *token = strtok(NULL,"\n");
-	char *lasttoken = workstr;
-	
-	if (!token)
-	{
-		free(workstr);
-		stringList.AddItem(new BString(string));
-		return;
-	}
-	
-	int32 length = 0;
-	BString *newword = NULL;
-	
-	while (token)
-	{
-		length = token - lasttoken;
-		
-		newword = new BString(lasttoken, length + 1);
-		lasttoken = token;
-		stringList.AddItem(newword);
-
-		token = strtok(NULL,"\n");
-	}
-	
-	length = strlen(lasttoken);
-	newword = new BString(lasttoken, length + 1);
-	lasttoken = token;
-	stringList.AddItem(newword);
-		
-	free(workstr);
-}
-
-
 FindWindow::FindWindow(BString workingDir)
 	:	DWindow(BRect(100,100,600,500), B_TRANSLATE("Find in project"), B_TITLED_WINDOW,
 				B_CLOSE_ON_ESCAPE),
@@ -111,7 +95,12 @@ FindWindow::FindWindow(BString workingDir)
 		fThreadQuitFlag(0),
 		fFileList(20, true),
 		fWorkingDir(""),
-		fProject(NULL)
+		fProject(NULL),
+		fSearcher(NULL),
+		fSearchIndex(NULL),
+		fSearchID(0),
+		fPendingReplace(NULL),
+		fLastReplace(NULL)
 {
 	SetSizeLimits(650, 30000, 400, 30000);
 	
@@ -167,10 +156,17 @@ FindWindow::FindWindow(BString workingDir)
 	
 	BMenu *menu = new BMenu(B_TRANSLATE("Search"));
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Find"), new BMessage(M_FIND), 'F', B_COMMAND_KEY));
+	menu->AddItem(new BMenuItem(B_TRANSLATE("Find symbol"), new BMessage(M_FIND_SYMBOL),
+								'F', B_COMMAND_KEY | B_SHIFT_KEY));
 	menu->AddSeparatorItem();
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Replace"), new BMessage(M_REPLACE), 'R', B_COMMAND_KEY));
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Replace all"), new BMessage(M_REPLACE_ALL), 'R',
 								B_COMMAND_KEY | B_SHIFT_KEY));
+	menu->AddSeparatorItem();
+	BMenuItem *undoItem = new BMenuItem(B_TRANSLATE("Undo replace"),
+										new BMessage(M_UNDO_REPLACE));
+	undoItem->SetEnabled(false);
+	menu->AddItem(undoItem);
 	fMenuBar->AddItem(menu);
 	
 	menu = new BMenu(B_TRANSLATE("Options"));
@@ -220,6 +216,15 @@ FindWindow::FindWindow(BString workingDir)
 }
 
 
+FindWindow::~FindWindow(void)
+{
+	AbortThread();
+	delete fSearcher;
+	delete fPendingReplace;
+	delete fLastReplace;
+}
+
+
 status_t
 FindWindow::SetWorkingDirectory(BString path)
 {
@@ -237,17 +242,79 @@ FindWindow::MessageReceived(BMessage *msg)
 	{
 		case M_FIND:
 		{
-			SpawnThread(THREAD_FIND);
+			StartSearch();
+			break;
+		}
+		case M_FIND_SYMBOL:
+		{
+			FindSymbol();
+			break;
+		}
+		case M_SYMBOL_RESULTS:
+		{
+			ShowSymbols(msg);
+			break;
+		}
+		case M_SEARCH_RESULTS:
+		{
+			AddResults(msg);
+			break;
+		}
+		case M_SEARCH_DONE:
+		{
+			int32 searchID;
+			if (msg->FindInt32("search", &searchID) != B_OK
+				|| searchID != fSearchID)
+				break;
+			
+			EnableReplace(true);
+			if (fResultList->CountItems() == 0)
+				fResultList->AddItem(new BStringItem(B_TRANSLATE("No matches found")));
 			break;
 		}
 		case M_REPLACE:
 		{
-			SpawnThread(THREAD_REPLACE);
+			StartReplace(true);
 			break;
 		}
 		case M_REPLACE_ALL:
 		{
-			SpawnThread(THREAD_REPLACE_ALL);
+			StartReplace(false);
+			break;
+		}
+		case M_REPLACE_PREVIEW:
+		{
+			ShowReplacePreview(msg);
+			break;
+		}
+		case M_APPLY_REPLACE:
+		{
+			int32 which;
+			if (fPendingReplace != NULL && msg->FindInt32("which", &which) == B_OK
+				&& which == 1)
+				SpawnThread(THREAD_APPLY_REPLACE);
+			else
+			{
+				delete fPendingReplace;
+				fPendingReplace = NULL;
+				EnableReplace(true);
+			}
+			break;
+		}
+		case M_REPLACE_DONE:
+		{
+			FinishReplace(msg);
+			break;
+		}
+		case M_UNDO_REPLACE:
+		{
+			if (fLastReplace == NULL || fPendingReplace != NULL)
+				break;
+			
+			EnableReplace(false);
+			item = fMenuBar->FindItem(B_TRANSLATE("Undo replace"));
+			item->SetEnabled(false);
+			SpawnThread(THREAD_UNDO_REPLACE);
 			break;
 		}
 		case M_SHOW_RESULT:
@@ -310,6 +377,10 @@ FindWindow::MessageReceived(BMessage *msg)
 			if (msg->FindPointer("project", (void**)&proj) != B_OK)
 				break;
 			
+			// A symbol search reads the project it was started for
+			AbortThread();
+			fProject = proj;
+			SetProject(proj);
 			break;
 		}
 		default:
@@ -346,7 +417,10 @@ FindWindow::AbortThread(void)
 		int32 out;
 		wait_for_thread(fThreadID, &out);
 		
-		// fThreadQuitID and fThreadID are reset by the extra thread
+		// The thread doesn't take the window lock on its way out, since we
+		// might be holding it right now
+		fThreadID = -1;
+		atomic_set(&fThreadQuitFlag, 0);
 	}
 }
 
@@ -357,9 +431,8 @@ FindWindow::FinderThread(void *data)
 	FindWindow *win = static_cast<FindWindow*>(data);
 	if (win)
 	{
-		win->Lock();
+		// Set before the thread was resumed, so no locking needed
 		int8 mode = win->fThreadMode;
-		win->Unlock();
 		
 		switch (mode)
 		{
@@ -368,14 +441,24 @@ FindWindow::FinderThread(void *data)
 				win->FindResults();
 				break;
 			}
-			case THREAD_REPLACE:
+			case THREAD_BUILD_REPLACE:
+			{
+				win->BuildReplace();
+				break;
+			}
+			case THREAD_APPLY_REPLACE:
 			{
-				win->Replace();
+				win->ApplyReplace();
 				break;
 			}
-			case THREAD_REPLACE_ALL:
+			case THREAD_UNDO_REPLACE:
 			{
-				win->ReplaceAll();
+				win->UndoReplace();
+				break;
+			}
+			case THREAD_FIND_SYMBOL:
+			{
+				win->FindSymbolResults();
 				break;
 			}
 			default:
@@ -383,231 +466,511 @@ FindWindow::FinderThread(void *data)
 		}
 	}
 	
-	win->Lock();
-	win->fThreadID = -1;
-	win->fThreadQuitFlag = 0;
-	win->Unlock();
-	
 	return 0;
 }
 
 
 void
-FindWindow::FindResults(void)
+FindWindow::StartSearch(void)
 {
-	// This function is called from the FinderThread function, so locking is
-	// required when accessing any member variables.
-	Lock();
-	bool canReplace = fReplaceButton->IsEnabled();
+	AbortThread();
+	
+	// Results of the old search still in the queue are told apart by this
+	fSearchID++;
+	
 	EnableReplace(false);
 	for (int32 i = fResultList->CountItems() - 1; i >= 0; i--)
+		delete fResultList->RemoveItem(i);
+	
+	delete fSearcher;
+	fSearcher = new FileSearcher(fFindBox->Text(), fIsRegEx, fIgnoreCase,
+								fMatchWord);
+	if (fSearcher->InitCheck() != B_OK)
 	{
-		// We don't want to hog the window lock, but we also don't want
-		// tons of context switches, either. Yielding the lock every 5 items
-		// should give us sufficient responsiveness.
-		if (i % 5 == 0)
+		if (fSearcher->ErrorString().Length() > 0)
 		{
-			Unlock();
-			Lock();
+			BString error(B_TRANSLATE("Invalid regular expression: "));
+			error << fSearcher->ErrorString();
+			fResultList->AddItem(new BStringItem(error.String()));
 		}
-		
-		BListItem *item = fResultList->RemoveItem(i);
-		delete item;
+		return;
 	}
-	Unlock();
+	
+	// Search the project's files and their partners, or the whole folder
+	// when there is no project
+	fSearchFiles.clear();
+	std::set<BString> seen;
+	for (int32 i = 0; i < fFileList.CountItems(); i++)
+	{
+		if (seen.insert(*fFileList.ItemAt(i)).second)
+			fSearchFiles.push_back(*fFileList.ItemAt(i));
+	}
+	fSearchIndex = fProject != NULL ? fProject->GetSearchIndex() : NULL;
+	
+	SpawnThread(THREAD_FIND);
+}
 
-	ShellHelper shell;
+
+void
+FindWindow::FindSymbol(void)
+{
+	AbortThread();
+	fSearchID++;
 	
-	shell << "cd ";
-	shell.AddEscapedArg(fWorkingDir);
-	shell << "; pwd; find . -type f ";
-	shell << "|xargs grep -n -H -s --binary-files=without-match ";
-	// TODO check for PCRE invocation and pass in pcre flag to grep if so
-	// TODO Ensure RE escaping also happens (E.g. open/close paran etc.)
-	shell.AddEscapedArg(fFindBox->Text());
+	EnableReplace(false);
+	for (int32 i = fResultList->CountItems() - 1; i >= 0; i--)
+		delete fResultList->RemoveItem(i);
 	
-	if (fThreadQuitFlag)
+	fSymbolText = fFindBox->Text();
+	if (fSymbolText.Length() == 0)
 		return;
 	
-	BString out;
-	shell.RunInPipe(out, false);
+	if (fProject == NULL)
+	{
+		fResultList->AddItem(new BStringItem(
+			B_TRANSLATE("Symbols can only be found in a project")));
+		return;
+	}
 	
-	if (fThreadQuitFlag)
+	SpawnThread(THREAD_FIND_SYMBOL);
+}
+
+
+void
+FindWindow::FindSymbolResults(void)
+{
+	// This function is called from the FinderThread function. Like
+	// FindResults(), it only works on what was set up before it started, and
+	// the list items are handed to the window in a message.
+	
+	// Only objects built since the last look are read again. The symbols
+	// come from the objects, so files which were never built aren't in it.
+	// AbortThread() waits for this thread, so reading them stops as soon as
+	// it asks.
+	fProject->UpdateSymbolXref(&fThreadQuitFlag);
+	if (atomic_get(&fThreadQuitFlag) != 0)
 		return;
 	
-	BObjectList<BString> resultList(20, true);
-	TokenizeToList(out.String(), resultList);
+	std::vector<xref_symbol> symbols;
+	int32 count = fProject->GetSymbolXref()->Find(fSymbolText.String(),
+											kMaxSymbolCount, symbols);
 	
-	Lock();
+	BList *items = new BList;
+	for (size_t i = 0; i < symbols.size()
+			&& atomic_get(&fThreadQuitFlag) == 0; i++)
+	{
+		items->AddItem(new BStringItem(symbols[i].name.String()));
+		AddSymbolFiles(*items, symbols[i].name, symbols[i].definitions,
+						B_TRANSLATE("defines"));
+		AddSymbolFiles(*items, symbols[i].name, symbols[i].references,
+						B_TRANSLATE("uses"));
+	}
 	
-	for (int32 i = 0; i < resultList.CountItems(); i++)
+	if (count > (int32)symbols.size())
 	{
-		// We don't want to hog the window lock, but we also don't want
-		// tons of context switches, either. Yielding the lock every 5 items
-		// should give us sufficient responsiveness.
-		if (i % 5 == 0)
-		{
-			Unlock();
-			Lock();
-		}
-		
-		BString entryString(resultList.ItemAt(i)->String());
-		
-		BString filename(entryString);
-		int32 pos = filename.FindFirst(":");
-		if (pos < 0)
-			continue;
-		filename.Truncate(pos);
-		if (filename.StartsWith("./"))
-			filename.Remove(0,2);
-		STRACE(2,("Truncated file name from grep: %s\n",filename.String()));
-		
-		BString lineString;
-		entryString.CopyInto(lineString, pos + 1, entryString.CountChars() - pos);
-		int32 pos2 = lineString.FindFirst(":");
-		
-		BString locationString;
-		lineString.CopyInto(locationString, pos2 + 1, lineString.CountChars() - pos2);
-		lineString.Truncate(pos2);
-		
-		DPath entryPath(fWorkingDir);
-		entryPath << filename;
-		
-		BString fullPath(fWorkingDir);
-		fullPath << "/" << filename;
-		
-		STRACE(2,("Full path: %s\n",fullPath.String()));
+		BString more(B_TRANSLATE("%count% more symbols not shown"));
+		BString number;
+		number << count - (int32)symbols.size();
+		more.ReplaceFirst("%count%", number.String());
+		items->AddItem(new BStringItem(more.String()));
+	}
+	
+	BMessage msg(M_SYMBOL_RESULTS);
+	msg.AddPointer("items", items);
+	msg.AddInt32("search", fSearchID);
+	if (atomic_get(&fThreadQuitFlag) != 0
+		|| BMessenger(this).SendMessage(&msg) != B_OK)
+	{
+		for (int32 i = 0; i < items->CountItems(); i++)
+			delete (BListItem*)items->ItemAt(i);
+		delete items;
+	}
+}
+
+
+void
+FindWindow::ShowSymbols(BMessage *msg)
+{
+	BList *items;
+	if (msg->FindPointer("items", (void**)&items) != B_OK)
+		return;
+	
+	// A new search has been started since
+	int32 searchID;
+	if (msg->FindInt32("search", &searchID) != B_OK || searchID != fSearchID)
+	{
+		for (int32 i = 0; i < items->CountItems(); i++)
+			delete (BListItem*)items->ItemAt(i);
+		delete items;
+		return;
+	}
+	
+	if (items->IsEmpty())
+		fResultList->AddItem(new BStringItem(B_TRANSLATE("No symbols found")));
+	else
+		fResultList->AddList(items);
+	delete items;
+}
+
+
+void
+FindWindow::AddSymbolFiles(BList &items, const BString &symbol,
+							const BStringList &files, const char *label)
+{
+	for (int32 i = 0; i < files.CountStrings()
+			&& atomic_get(&fThreadQuitFlag) == 0; i++)
+	{
+		BString fullPath(files.StringAt(i));
+		entry_ref ref;
+		BEntry(fullPath.String()).GetRef(&ref);
 		
-		DPath relPath(filename);
+		BString lineText;
+		int32 line = FindSymbolLine(fullPath, symbol, lineText);
+		BString text(label);
+		if (line >= 0)
+			text << ": " << lineText;
 		
-		fResultList->AddItem(new GrepListItem(fullPath,filename,
-			entryPath.GetRef(), atol(lineString.String()),
-			locationString.String()));
+		items.AddItem(new GrepListItem(fullPath, RelativePath(fullPath),
+										ref, line, text.String()));
 	}
-	EnableReplace(true);
+}
+
+
+int32
+FindWindow::FindSymbolLine(const BString &path, const BString &symbol,
+							BString &lineText)
+{
+	// The source only has the unqualified name, without the parameters
+	BString name(symbol);
+	int32 parameters = name.FindFirst("(");
+	if (parameters >= 0)
+		name.Truncate(parameters);
+	int32 scope = name.FindLast("::");
+	if (scope >= 0)
+		name.Remove(0, scope + 2);
+	if (name.Length() == 0)
+		return -1;
 	
-	if (fResultList->CountItems() == 0)
-		fResultList->AddItem(new BStringItem(B_TRANSLATE("No matches found")));
+	BFile file(path.String(), B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK || size <= 0)
+		return -1;
 	
-	Unlock();
+	BString data;
+	char *buffer = data.LockBuffer(size);
+	ssize_t bytesRead = file.Read(buffer, size);
+	data.UnlockBuffer(bytesRead > 0 ? bytesRead : 0);
 	
+	const char *start = data.String();
+	const char *match = start;
+	while ((match = strstr(match, name.String())) != NULL)
+	{
+		// Only whole words count, so that Draw doesn't find DrawString
+		const char *after = match + name.Length();
+		bool wordStart = match == start || !(isalnum(match[-1])
+											|| match[-1] == '_');
+		bool wordEnd = !(isalnum(*after) || *after == '_');
+		if (wordStart && wordEnd)
+			break;
+		match = after;
+	}
+	if (match == NULL)
+		return -1;
+	
+	int32 line = 1;
+	const char *lineStart = start;
+	for (const char *c = start; c < match; c++)
+	{
+		if (*c == '\n')
+		{
+			line++;
+			lineStart = c + 1;
+		}
+	}
+	
+	const char *lineEnd = strchr(match, '\n');
+	if (lineEnd == NULL)
+		lineEnd = match + strlen(match);
+	lineText.SetTo(lineStart, lineEnd - lineStart);
+	lineText.Trim();
+	return line;
 }
 
+
 void
-FindWindow::ReplaceAll(void)
+FindWindow::AddResults(BMessage *msg)
 {
-	// This function is called from the FinderThread function, so locking is
-	// required when accessing any member variables.
+	int32 searchID;
+	BString fullPath;
+	if (msg->FindInt32("search", &searchID) != B_OK || searchID != fSearchID
+		|| msg->FindString("path", &fullPath) != B_OK)
+		return;
 	
+	BString relPath(RelativePath(fullPath));
 	
-	Lock();
-	BString errorLog;
+	entry_ref ref;
+	BEntry(fullPath.String()).GetRef(&ref);
 	
-	BString findText(fFindBox->Text());
-	BString replaceText(fReplaceBox->Text());
-		
-	if (!fIsRegEx)
+	BList items;
+	int32 line;
+	const char *text;
+	for (int32 i = 0; msg->FindInt32("line", i, &line) == B_OK
+			&& msg->FindString("text", i, &text) == B_OK; i++)
+		items.AddItem(new GrepListItem(fullPath, relPath, ref, line, text));
+	
+	fResultList->AddList(&items);
+}
+
+
+void
+FindWindow::FindResults(void)
+{
+	// This function is called from the FinderThread function. Everything it
+	// needs was set up by StartSearch() and the results are sent back as
+	// messages, so it never takes the window lock, which would deadlock with
+	// AbortThread().
+	std::vector<BString> files(fSearchFiles);
+	if (files.empty())
+		FileSearcher::CollectFiles(fWorkingDir.String(), files, &fThreadQuitFlag);
+	else if (fSearchIndex != NULL)
 	{
-		findText.CharacterEscape("^$()%.[]*+-?", '\\');
+		// Only the files holding every trigram of the literal can match
+		std::vector<BString> candidates;
+		if (fSearchIndex->Narrow(fSearcher->Literal().String(), files,
+				candidates))
+			files.swap(candidates);
 	}
-		
-	BString replaceTerms;
-	replaceTerms << "'" << findText << "' '" << replaceText << "'";
-		
-	ShellHelper shell;
-	shell << "pwd; find ";
-	shell.AddEscapedArg(fWorkingDir);
-	BString sStr("'s/");
-	sStr << findText.String() << "/";
-	sStr << replaceText.String() << "/";
-	sStr << "'";
-	shell << " -type f | xargs sed -i " << sStr.String();
-		
-	STRACE(2,("Shell command: %s\n",shell.AsString().String()));
-		
-	Unlock();
-	BString out;
-	shell.RunInPipe(out,false);
-	STRACE(2,("Command output: %s\n",out.String()));
 	
-	if (errorLog.CountChars() > 0)
+	BMessage resultTemplate(M_SEARCH_RESULTS);
+	resultTemplate.AddInt32("search", fSearchID);
+	
+	BMessenger target(this);
+	int32 count = fSearcher->Search(files, target, resultTemplate,
+									&fThreadQuitFlag);
+	
+	if (atomic_get(&fThreadQuitFlag) != 0)
+		return;
+	
+	BMessage done(M_SEARCH_DONE);
+	done.AddInt32("search", fSearchID);
+	done.AddInt32("count", count);
+	target.SendMessage(&done);
+}
+
+void
+FindWindow::StartReplace(bool selectedOnly)
+{
+	if (fSearcher == NULL || fSearcher->InitCheck() != B_OK
+		|| fPendingReplace != NULL)
+		return;
+	
+	// Only the files the search found are touched, and the matches are the
+	// search's, even if the search box has been edited since
+	fReplaceFiles.clear();
+	std::set<BString> seen;
+	for (int32 i = 0; i < fResultList->CountItems(); i++)
 	{
-		BString errorString = B_TRANSLATE("The following files had problems replacing the search terms:\n");
-		errorString << errorLog;
+		GrepListItem *item = dynamic_cast<GrepListItem*>(fResultList->ItemAt(i));
+		if (item == NULL || (selectedOnly && !item->IsSelected()))
+			continue;
 		
-		ShowAlert(errorString.String());
+		if (seen.insert(item->GetPath()).second)
+			fReplaceFiles.push_back(item->GetPath());
 	}
 	
-	PostMessage(M_FIND);
+	if (fReplaceFiles.empty())
+		return;
+	
+	fReplacement = fReplaceBox->Text();
+	EnableReplace(false);
+	SpawnThread(THREAD_BUILD_REPLACE);
 }
 
+
 void
-FindWindow::Replace(void) // Was REPLACEALL
+FindWindow::ShowReplacePreview(BMessage *msg)
 {
-	// This function is called from the FinderThread function, so locking is
-	// required when accessing any member variables.
+	ReplaceSet *set;
+	int32 searchID;
+	if (msg->FindPointer("set", (void**)&set) != B_OK)
+		return;
 	
-	// Just make sure you escape single quotes and underscores before constructing
-	// the sed command
+	// A new search has been started since
+	if (msg->FindInt32("search", &searchID) != B_OK || searchID != fSearchID)
+	{
+		delete set;
+		return;
+	}
 	
-	ShowAlert(B_TRANSLATE("luare based replace all has been removed until it can be migrated from Lua"), 
-		"OK", NULL, NULL, B_STOP_ALERT);
-	return;
+	if (set->CountFiles() == 0)
+	{
+		delete set;
+		EnableReplace(true);
+		return;
+	}
 	
-	Lock();
-	BString errorLog;
+	fPendingReplace = set;
 	
-	for (int32 i = 0; i < fResultList->CountItems(); i++)
+	BString text(B_TRANSLATE("Replace %count% matches in %files% files?"));
+	BString number;
+	number << set->CountReplacements();
+	text.ReplaceFirst("%count%", number.String());
+	number = "";
+	number << set->CountFiles();
+	text.ReplaceFirst("%files%", number.String());
+	text << "\n";
+	
+	int32 listed = MIN(set->CountFiles(), kPreviewFileCount);
+	for (int32 i = 0; i < listed; i++)
 	{
-		BString findText(fFindBox->Text()), replaceText(fReplaceBox->Text());
-		
-		if (!fIsRegEx)
-		{
-			findText.CharacterEscape("^$()%.[]*+-?", '%');
-			replaceText.CharacterEscape("%", '%');
-		}
-		
-		findText.CharacterEscape("'", '\\');
-		replaceText.CharacterEscape("'", '\\');
-		
-		BString replaceTerms;
-		replaceTerms << "'" << findText << "' '" << replaceText << "'";
+		text << "\n" << RelativePath(set->PathAt(i)) << " ("
+			<< set->ReplacementsAt(i) << ")";
+	}
+	if (listed < set->CountFiles())
+	{
+		BString more(B_TRANSLATE("…and %count% more"));
+		number = "";
+		number << set->CountFiles() - listed;
+		more.ReplaceFirst("%count%", number.String());
+		text << "\n" << more;
+	}
+	
+	BAlert *alert = new BAlert(B_TRANSLATE_SYSTEM_NAME("Paladin"), text.String(),
+								B_TRANSLATE("Cancel"), B_TRANSLATE("Replace"));
+	alert->SetShortcut(0, B_ESCAPE);
+	alert->Go(new BInvoker(new BMessage(M_APPLY_REPLACE), this));
+}
+
+
+void
+FindWindow::FinishReplace(BMessage *msg)
+{
+	bool undo = msg->GetBool("undo", false);
+	ReplaceSet *set = undo ? fLastReplace : fPendingReplace;
+	if (set == NULL)
+		return;
+	
+	status_t status;
+	if (msg->FindInt32("status", &status) != B_OK)
+		status = B_ERROR;
+	
+	if (status != B_OK)
+	{
+		BString errorString;
+		if (undo)
+			errorString = B_TRANSLATE("Nothing was undone, because of problems with these files:\n");
+		else
+			errorString = B_TRANSLATE("Nothing was replaced, because of problems with these files:\n");
+		errorString << msg->GetString("errors", "");
 		
-		GrepListItem *gitem = (GrepListItem*)fResultList->ItemAt(i);
-		DPath file(gitem->GetRef());
-
-		ShellHelper shell;
-		shell << "luare" << replaceTerms;
-		shell.AddEscapedArg(file.GetFullPath());
-		shell.AddEscapedArg(file.GetFullPath());
-printf("replace command: %s\n", shell.AsString().String());
-		int32 outvalue = shell.Run();
-		if (outvalue)
-		{
-			// append file name to list of files with error conditions and notify
-			// user of problems at the end so as not to annoy them.
-			errorLog << "\t" << file.GetFileName() << "\n";
-		}
+		BAlert *alert = new BAlert(B_TRANSLATE_SYSTEM_NAME("Paladin"),
+									errorString.String(), B_TRANSLATE("OK"));
+		alert->Go(NULL);
 		
-		// Allow window updates from time to time
-		if (i % 5 == 0)
+		if (!undo)
 		{
-			Unlock();
-			Lock();
+			delete fPendingReplace;
+			fPendingReplace = NULL;
 		}
 	}
-	Unlock();
 	
-	if (errorLog.CountChars() > 0)
+	std::vector<BString> files;
+	for (int32 i = 0; status == B_OK && i < set->CountFiles(); i++)
+		files.push_back(set->PathAt(i));
+	
+	// Only the last replace is kept for undoing, and once it is undone
+	// there is nothing left to undo
+	if (status == B_OK)
 	{
-		BString errorString = B_TRANSLATE("The following files had problems replacing the search terms:\n");
-		errorString << errorLog;
-		
-		BAlert *alert = new BAlert(B_TRANSLATE_SYSTEM_NAME("Paladin"), errorString.String(), B_TRANSLATE("OK"));
-		alert->Go();
+		delete fLastReplace;
+		fLastReplace = undo ? NULL : fPendingReplace;
+		fPendingReplace = NULL;
 	}
 	
-	PostMessage(M_FIND);
+	BMenuItem *item = fMenuBar->FindItem(B_TRANSLATE("Undo replace"));
+	if (item)
+		item->SetEnabled(fLastReplace != NULL);
+	
+	int32 searchID;
+	if (files.empty() || msg->FindInt32("search", &searchID) != B_OK
+		|| searchID != fSearchID)
+		EnableReplace(true);
+	else
+		RefreshResults(files);
+}
+
+
+void
+FindWindow::RefreshResults(const std::vector<BString> &files)
+{
+	AbortThread();
+	
+	std::set<BString> paths(files.begin(), files.end());
+	for (int32 i = fResultList->CountItems() - 1; i >= 0; i--)
+	{
+		GrepListItem *item = dynamic_cast<GrepListItem*>(fResultList->ItemAt(i));
+		if (item == NULL || paths.find(item->GetPath()) != paths.end())
+			delete fResultList->RemoveItem(i);
+	}
+	
+	// Only the files which were just written need to be searched again. The
+	// index might not have heard about them yet, so it is left out.
+	fSearchID++;
+	fSearchFiles = files;
+	fSearchIndex = NULL;
+	SpawnThread(THREAD_FIND);
+}
+
+
+void
+FindWindow::BuildReplace(void)
+{
+	// This function is called from the FinderThread function. Like
+	// FindResults(), it only works on what was set up before it started.
+	ReplaceSet *set = new ReplaceSet;
+	if (set->Build(*fSearcher, fReplacement.String(), fReplaceFiles,
+					&fThreadQuitFlag) != B_OK)
+	{
+		delete set;
+		return;
+	}
+	
+	BMessage msg(M_REPLACE_PREVIEW);
+	msg.AddPointer("set", set);
+	msg.AddInt32("search", fSearchID);
+	if (BMessenger(this).SendMessage(&msg) != B_OK)
+		delete set;
+}
+
+
+void
+FindWindow::ApplyReplace(void)
+{
+	// fPendingReplace isn't touched by the window until we are done
+	BString errors;
+	status_t status = fPendingReplace->Apply(errors);
+	
+	BMessage msg(M_REPLACE_DONE);
+	msg.AddInt32("status", status);
+	msg.AddString("errors", errors);
+	msg.AddBool("undo", false);
+	msg.AddInt32("search", fSearchID);
+	BMessenger(this).SendMessage(&msg);
+}
+
+
+void
+FindWindow::UndoReplace(void)
+{
+	BString errors;
+	status_t status = fLastReplace->Revert(errors);
+	
+	BMessage msg(M_REPLACE_DONE);
+	msg.AddInt32("status", status);
+	msg.AddString("errors", errors);
+	msg.AddBool("undo", true);
+	msg.AddInt32("search", fSearchID);
+	BMessenger(this).SendMessage(&msg);
 }
 
 
@@ -625,6 +988,19 @@ FindWindow::EnableReplace(bool value)
 }
 
 
+BString
+FindWindow::RelativePath(const BString &path) const
+{
+	BString relPath(path);
+	BString folder(fWorkingDir);
+	if (!folder.EndsWith("/"))
+		folder << "/";
+	if (relPath.StartsWith(folder))
+		relPath.Remove(0, folder.Length());
+	return relPath;
+}
+
+
 void
 FindWindow::SetProject(Project *proj)
 {
@@ -663,7 +1039,9 @@ GrepListItem::GrepListItem(BString fullPath,BString relPath,
 	BString text("");
 	
 	text << relPath;
-	text << ":" << line << ": " << linestr; 
+	if (line >= 0)
+		text << ":" << line;
+	text << ": " << linestr; 
 	// colon doesn't require translation, and thus no complex parsing on click
 	SetText(text.String());
 }
@@ -5,28 +5,50 @@
 
 #include <Button.h>
 #include <MenuBar.h>
+#include <StringList.h>
 
 #include "DPath.h"
 #include "ObjectList.h"
 
+#include <vector>
+
 class DTextView;
+class FileSearcher;
 class DListView;
 class Project;
+class ReplaceSet;
+class SearchIndex;
 
 class FindWindow : public DWindow
 {
 public:
 						FindWindow(BString path);
+						~FindWindow(void);
 			void		MessageReceived(BMessage *msg);
 
 private:
+			void		StartSearch(void);
+			void		AddResults(BMessage *msg);
+			void		FindSymbol(void);
+			void		FindSymbolResults(void);
+			void		ShowSymbols(BMessage *msg);
+			void		AddSymbolFiles(BList &items, const BString &symbol,
+							const BStringList &files, const char *label);
+	static	int32		FindSymbolLine(const BString &path,
+							const BString &symbol, BString &lineText);
 			void		SpawnThread(int8 findMode);
 			void		AbortThread(void);
 	static	int32		FinderThread(void *data);
 			void		FindResults(void);
-			void		Replace(void);
-			void		ReplaceAll(void);
+			void		StartReplace(bool selectedOnly);
+			void		ShowReplacePreview(BMessage *msg);
+			void		FinishReplace(BMessage *msg);
+			void		RefreshResults(const std::vector<BString> &files);
+			void		BuildReplace(void);
+			void		ApplyReplace(void);
+			void		UndoReplace(void);
 			void		EnableReplace(bool value);
+			BString		RelativePath(const BString &path) const;
 			void		SetProject(Project *proj);
 			
 			status_t 	SetWorkingDirectory(BString path);
@@ -52,6 +74,20 @@ private:
 	BObjectList<BString>	fFileList;
 	BString					fWorkingDir;
 	Project			*fProject;
+	
+	// What the search thread works on, set up before it is started
+	FileSearcher			*fSearcher;
+	std::vector<BString>	fSearchFiles;
+	SearchIndex				*fSearchIndex;
+	int32					fSearchID;
+	BString					fSymbolText;
+	
+	// The replace waiting to be confirmed and the last one done, which can
+	// still be undone
+	ReplaceSet				*fPendingReplace;
+	ReplaceSet				*fLastReplace;
+	std::vector<BString>	fReplaceFiles;
+	BString					fReplacement;
 };
 
 
@@ -19,6 +19,7 @@
 #include "Settings.h"
 #include "SourceTypeLib.h"
 #include "StatCache.h"
+#include "SymbolIndex.h"
 #include <stdlib.h>
 #include "TextFile.h"
 
@@ -42,6 +43,8 @@ bool gUseCCache = false;
 bool gCCacheAvailable = false;
 bool gUseFastDep = false;
 bool gFastDepAvailable = false;
+bool gUseJSONDiagnostics = false;
+bool gJSONDiagnosticsAvailable = false;
 bool gHgAvailable = false;
 bool gGitAvailable = false;
 bool gSvnAvailable = false;
@@ -58,6 +61,9 @@ uint8 gCPUCount = 1;
 
 StatCache gStatCache;
 bool gUseStatCache = true;
+
+FileNameIndex *gFileNameIndex = NULL;
+SymbolIndex *gSymbolIndex = NULL;
 platform_t gPlatform = PLATFORM_R5;
 
 
@@ -74,12 +80,16 @@ InitGlobals(void)
 	
 	gSettings.Load(settingsPath.GetFullPath());
 	
+	// The same index SymbolFinder keeps
+	gSymbolIndex = new SymbolIndex(SymbolIndex::DefaultPath().String());
+	
 	gDontManageHeaders = gSettings.GetBool("dontmanageheaders",true);
 	gSingleThreadedBuild = gSettings.GetBool("singlethreaded",false);
 	gShowFolderOnOpen = gSettings.GetBool("showfolderonopen",false);
 	gAutoSyncModules = gSettings.GetBool("autosyncmodules",true);
 	gUseCCache = gSettings.GetBool("ccache",false);
 	gUseFastDep = gSettings.GetBool("fastdep",false);
+	gUseJSONDiagnostics = gSettings.GetBool("jsondiagnostics",false);
 	
 	gDefaultSCM = (scm_t)gSettings.GetInt32("defaultSCM", SCM_HG);
 	
@@ -117,6 +127,10 @@ InitGlobals(void)
 	if (system("lua -v > /dev/null 2>&1") == 0)
 		gLuaAvailable = true;
 	
+	// Structured diagnostics showed up in gcc 9, so gcc2 will refuse the flag
+	if (system("gcc -fdiagnostics-format=json -E -x c /dev/null > /dev/null 2>&1") == 0)
+		gJSONDiagnosticsAvailable = true;
+	
 	gProjectPath.SetTo(gSettings.GetString("projectpath",PROJECT_PATH));
 	gLastProjectPath.SetTo(gSettings.GetString("lastprojectpath",PROJECT_PATH));
 	
@@ -12,7 +12,9 @@
 #include "Project.h"
 
 class DPath;
+class FileNameIndex;
 class StatCache;
+class SymbolIndex;
 
 // Define this to enable the code library
 //#define BUILD_CODE_LIBRARY
@@ -61,6 +63,8 @@ extern bool gUseCCache;
 extern bool gCCacheAvailable;
 extern bool gUseFastDep;
 extern bool gFastDepAvailable;
+extern bool gUseJSONDiagnostics;
+extern bool gJSONDiagnosticsAvailable;
 extern bool gHgAvailable;
 extern bool gGitAvailable;
 extern bool gSvnAvailable;
@@ -72,6 +76,9 @@ extern uint8 gCPUCount;
 extern StatCache gStatCache;
 extern bool	gUseStatCache;
 
+extern FileNameIndex *gFileNameIndex;
+extern SymbolIndex *gSymbolIndex;
+
 extern platform_t gPlatform;
 
 #endif
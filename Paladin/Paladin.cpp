@@ -27,9 +27,12 @@
 #include <TranslationUtils.h>
 
 #include "AboutWindow.h"
+#include "AppDebug.h"
+#include "Benchmark.h"
 #include "DebugTools.h"
 #include "DPath.h"
 #include "ErrorParser.h"
+#include "FileNameIndex.h"
 #include "FileUtils.h"
 #include "Globals.h"
 #include "LaunchHelper.h"
@@ -43,6 +46,8 @@
 #include "Settings.h"
 #include "SourceFile.h"
 #include "StartWindow.h"
+#include "SymbolIndex.h"
+#include "SymbolXref.h"
 #include "TemplateWindow.h"
 #include "PaladinFileFilter.h"
 
@@ -102,20 +107,33 @@ void
 PrintUsage(void)
 {
 	#ifdef USE_TRACE_TOOLS
-	printf(B_TRANSLATE("Usage: Paladin [-b] [-m] [-r] [-s] [-d] [-v] [file1 [file2 ...]]\n"
+	printf(B_TRANSLATE("Usage: Paladin [-b] [-m] [-i] [-r] [-s] [-d] [-v] [file1 [file2 ...]]\n"
+			"       Paladin [-y text] [-u] project\n"
+			"       Paladin -p [-s] [option=value ...]\n"
 			"-b, Build the specified project. Only one file can be specified with this switch.\n"
 			"-m, Generate a makefile for the specified project.\n"
+			"-i, Print which headers cause the most recompiling in the specified project.\n"
+			"-y, Print which of the project's files define and use the symbols containing text.\n"
+			"-u, Print the project's symbols which are defined for other files but never used.\n"
 			"-r, Completely rebuild the project.\n"
 			"-s, Use only one thread for building.\n"
+			"-p, Benchmark the build system on a generated project and print JSON results.\n"
 			"-d, Print debugging output.\n"
 			"-v, Make debugging mode verbose.\n"));
 	#else
-	printf(B_TRANSLATE("Usage: Paladin [-b] [-m] [-r] [-s] [file1 [file2 ...]]\n"
+	printf(B_TRANSLATE("Usage: Paladin [-b] [-m] [-i] [-r] [-s] [file1 [file2 ...]]\n"
+			"       Paladin [-y text] [-u] project\n"
+			"       Paladin -p [-s] [option=value ...]\n"
 			"-b, Build the specified project. Only one file can be specified with this switch.\n"
 			"-m, Generate a makefile for the specified project.\n"
+			"-i, Print which headers cause the most recompiling in the specified project.\n"
+			"-y, Print which of the project's files define and use the symbols containing text.\n"
+			"-u, Print the project's symbols which are defined for other files but never used.\n"
 			"-r, Completely rebuild the project.\n"
-			"-s, Use only one thread for building.\n"));
+			"-s, Use only one thread for building.\n"
+			"-p, Benchmark the build system on a generated project and print JSON results.\n"));
 	#endif
+	PrintBenchmarkUsage();
 }
 
 
@@ -123,6 +141,9 @@ App::App(void)
 	:
 	BApplication(APP_SIGNATURE),
 	fBuildCleanMode(false),
+	fImpactMode(false),
+	fSymbolMode(false),
+	fUnusedMode(false),
 	fBuilder(NULL)
 {
 	InitFileTypes();
@@ -140,6 +161,9 @@ App::~App(void)
 {
 	gSettings.Save();
 	
+	if (NULL != gFileNameIndex)
+		gFileNameIndex->Shutdown();
+	delete gSymbolIndex;
 	if (NULL != fBuilder)
 		delete fBuilder;
 	if (NULL != fOpenPanel)
@@ -160,6 +184,7 @@ App::ArgvReceived(int32 argc,char **argv)
 {
 	bool showUsage = false;
 	bool verbose = false;
+	bool benchmark = false;
 	int32 i = 1;
 	for (i = 1; i < argc; i++)
 	{
@@ -184,6 +209,28 @@ App::ArgvReceived(int32 argc,char **argv)
 				gMakeMode = true;
 				break;
 			}
+			case 'i':
+			{
+				fImpactMode = true;
+				break;
+			}
+			case 'y':
+			{
+				if (i + 1 < argc)
+				{
+					fSymbolMode = true;
+					fSymbolQuery = argv[++i];
+				}
+				else
+					showUsage = true;
+				break;
+			}
+			case 'u':
+			{
+				fSymbolMode = true;
+				fUnusedMode = true;
+				break;
+			}
 			case 'r':
 			{
 				gBuildMode = true;
@@ -195,6 +242,11 @@ App::ArgvReceived(int32 argc,char **argv)
 				gSingleThreadedBuild = true;
 				break;
 			}
+			case 'p':
+			{
+				benchmark = true;
+				break;
+			}
 			
 			#ifdef USE_TRACE_TOOLS
 			case 'v':
@@ -240,6 +292,27 @@ App::ArgvReceived(int32 argc,char **argv)
 	if (gSingleThreadedBuild)
 		STRACE(1,("Disabling multithreaded project building\n"));
 
+	if (benchmark)
+	{
+		BenchmarkSettings settings;
+		for (; i < argc; i++)
+		{
+			if (settings.ParseArgument(argv[i]) != B_OK)
+			{
+				printf(B_TRANSLATE("Unknown benchmark option %s\n"), argv[i]);
+				PrintBenchmarkUsage();
+				sReturnCode = -1;
+				break;
+			}
+		}
+		
+		if (i == argc)
+			sReturnCode = RunBenchmarks(settings);
+		
+		sWindowCount++;
+		PostMessage(B_QUIT_REQUESTED);
+		return;
+	}
 		
 	BMessage refmsg;
 	int32 refcount = 0;
@@ -278,7 +351,8 @@ App::ArgvReceived(int32 argc,char **argv)
 		refcount++;
 		optind++;
 		
-		if (refcount == 1 && (gBuildMode || gMakeMode))
+		if (refcount == 1 && (gBuildMode || gMakeMode || fImpactMode
+				|| fSymbolMode))
 			break;
 	}
 	
@@ -286,6 +360,13 @@ App::ArgvReceived(int32 argc,char **argv)
 		RefsReceived(&refmsg);
 	else if (gBuildMode || gMakeMode)
 		Quit();
+	
+	if (fImpactMode || fSymbolMode)
+	{
+		// Nothing to show, so don't let the start window come up either
+		sWindowCount++;
+		PostMessage(B_QUIT_REQUESTED);
+	}
 }
 
 
@@ -302,6 +383,12 @@ App::RefsReceived(BMessage *msg)
 		if (gBuildMode && isPaladin)
 			BuildProject(ref);
 		else
+		if (fImpactMode && isPaladin)
+			ReportRebuildImpact(ref);
+		else
+		if (fSymbolMode && isPaladin)
+			ReportSymbols(ref);
+		else
 		if (gMakeMode && isPaladin)
 			GenerateMakefile(ref);
 		else
@@ -330,6 +417,24 @@ App::ReadyToRun(void)
 		StartWindow *win = new StartWindow();
 		win->Show();
 	}
+	
+	// Get the system headers' names together in the background, so
+	// Find and open file doesn't have to walk their folders
+	if (!gBuildMode)
+	{
+		gFileNameIndex = new FileNameIndex();
+		gFileNameIndex->Run();
+		
+		BStringList folders;
+		GetHeaderFolders(folders);
+		gFileNameIndex->Refresh(folders);
+		
+		// The libraries' symbols, for telling which library a failed link
+		// is missing without reading them at link time
+		BStringList libraryFolders;
+		SymbolIndex::GetLibraryFolders(libraryFolders);
+		gSymbolIndex->RefreshInBackground(libraryFolders);
+	}
 }
 
 
@@ -923,6 +1028,73 @@ App::GenerateMakefile(const entry_ref &ref)
 	}
 }
 
+
+void
+App::ReportRebuildImpact(const entry_ref &ref)
+{
+	BPath path(&ref);
+	Project proj;
+	if (proj.Load(path.Path()) != B_OK)
+	{
+		printf(B_TRANSLATE("Couldn't load project %s\n"), path.Path());
+		sReturnCode = -1;
+		return;
+	}
+	
+	DumpRebuildImpact(&proj);
+}
+
+
+void
+App::ReportSymbols(const entry_ref &ref)
+{
+	BPath path(&ref);
+	Project proj;
+	if (proj.Load(path.Path()) != B_OK)
+	{
+		printf(B_TRANSLATE("Couldn't load project %s\n"), path.Path());
+		sReturnCode = -1;
+		return;
+	}
+	
+	// Objects built since the last build from the window are read here
+	proj.UpdateSymbolXref();
+	SymbolXref *xref = proj.GetSymbolXref();
+	
+	std::vector<xref_symbol> symbols;
+	if (fSymbolQuery.Length() > 0)
+	{
+		xref->Find(fSymbolQuery.String(), INT32_MAX, symbols);
+		if (symbols.empty())
+			printf(B_TRANSLATE("No symbols containing %s\n"),
+				fSymbolQuery.String());
+		
+		for (size_t i = 0; i < symbols.size(); i++)
+		{
+			printf("%s\n", symbols[i].name.String());
+			for (int32 j = 0; j < symbols[i].definitions.CountStrings(); j++)
+				printf(B_TRANSLATE("\tdefined in %s\n"),
+					symbols[i].definitions.StringAt(j).String());
+			for (int32 j = 0; j < symbols[i].references.CountStrings(); j++)
+				printf(B_TRANSLATE("\tused in %s\n"),
+					symbols[i].references.StringAt(j).String());
+		}
+	}
+	
+	if (fUnusedMode)
+	{
+		xref->FindUnreferenced(symbols);
+		printf(B_TRANSLATE("%ld symbols are defined for other files but never "
+			"used:\n"), (long)symbols.size());
+		for (size_t i = 0; i < symbols.size(); i++)
+		{
+			printf("%s (%s)\n", symbols[i].name.String(),
+				symbols[i].definitions.StringAt(0).String());
+		}
+	}
+}
+
+
 void
 App::LoadProject(const entry_ref &givenRef)
 {
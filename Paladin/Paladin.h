@@ -4,6 +4,7 @@
 #include <Application.h>
 #include <Entry.h>
 #include <FilePanel.h>
+#include <String.h>
 
 
 class DelayedMessenger;
@@ -30,12 +31,18 @@ public:
 private:
 	void	BuildProject(const entry_ref &ref);
 	void	GenerateMakefile(const entry_ref &ref);
+	void	ReportRebuildImpact(const entry_ref &ref);
+	void	ReportSymbols(const entry_ref &ref);
 	void	LoadProject(const entry_ref &ref);
 	void	UpdateRecentItems(const entry_ref &ref);
 	void	PostToProjectWindow(BMessage *msg, entry_ref *file);
 	void	CheckCreateOpenPanel(void);
 	
 	bool			fBuildCleanMode;
+	bool			fImpactMode;
+	bool			fSymbolMode;
+	bool			fUnusedMode;
+	BString			fSymbolQuery;
 	ProjectBuilder	*fBuilder;
 	BFilePanel		*fOpenPanel;
 };
@@ -45,6 +45,7 @@ enum
 	M_SET_SLOW_BUILDS = 'ssbl',
 	M_SET_CCACHE = 'scac',
 	M_SET_FASTDEP = 'sfsd',
+	M_SET_JSON_DIAGNOSTICS = 'sjsd',
 	M_SET_AUTOSYNC = 'saus',
 	M_SET_BACKUP_FOLDER = 'sbuf',
 	M_SET_REPO_FOLDER = 'sref'
@@ -61,6 +62,7 @@ PrefsWindow::PrefsWindow(BRect frame)
 	fSlowBuilds(NULL),
 	fCCache(NULL),
 	fFastDep(NULL),
+	fJSONDiagnostics(NULL),
 	fAutoSyncModules(NULL),
 	fBackupFolder(NULL),
 	fSCMChooser(NULL),
@@ -125,11 +127,27 @@ PrefsWindow::PrefsWindow(BRect frame)
 		fFastDep->SetEnabled(false);
 	}
 
+	fJSONDiagnostics = new BCheckBox("jsondiagnostics",
+		B_TRANSLATE("Use structured compiler diagnostics"),
+		new BMessage(M_SET_JSON_DIAGNOSTICS));
+	SetToolTip(fJSONDiagnostics, B_TRANSLATE("Have gcc report errors and warnings "
+		"as JSON, which keeps notes and fix-its together with the error they belong to"));
+	if (gJSONDiagnosticsAvailable) {
+		if (gUseJSONDiagnostics)
+			fJSONDiagnostics->SetValue(B_CONTROL_ON);
+	} else {
+		BString label = fJSONDiagnostics->Label();
+		label << " -- " << B_TRANSLATE("unavailable");
+		fJSONDiagnostics->SetLabel(label.String());
+		fJSONDiagnostics->SetEnabled(false);
+	}
+
 	BBox* buildBox = new BBox(B_FANCY_BORDER,
 		BLayoutBuilder::Group<>(B_VERTICAL, 0)
 			.Add(fSlowBuilds)
 			.Add(fCCache)
 			.Add(fFastDep)
+			.Add(fJSONDiagnostics)
 			.SetInsets(B_USE_DEFAULT_SPACING, B_USE_SMALL_SPACING,
 				B_USE_DEFAULT_SPACING, B_USE_SMALL_SPACING)
 			.View());
@@ -319,6 +337,13 @@ PrefsWindow::MessageReceived(BMessage* message)
 			gSettings.Save();
 			break;
 		}
+		case M_SET_JSON_DIAGNOSTICS:
+		{
+			gUseJSONDiagnostics = (fJSONDiagnostics->Value() == B_CONTROL_ON);
+			gSettings.SetBool("jsondiagnostics", gUseJSONDiagnostics);
+			gSettings.Save();
+			break;
+		}
 		case M_SET_AUTOSYNC:
 		{
 #ifdef BUILD_CODE_LIBRARY
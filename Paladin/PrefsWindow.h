@@ -38,6 +38,7 @@ private:
 			BCheckBox*			fSlowBuilds;
 			BCheckBox*			fCCache;
 			BCheckBox*			fFastDep;
+			BCheckBox*			fJSONDiagnostics;
 
 			BCheckBox*			fAutoSyncModules;
 
@@ -11,8 +11,14 @@
 
 #include "Project.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <fs_attr.h>
 
@@ -35,8 +41,10 @@
 #include "Globals.h"
 #include "LaunchHelper.h"
 #include "SCMManager.h"
+#include "SearchIndex.h"
 #include "SourceFile.h"
-#include "TextFile.h"
+#include "SymbolIndex.h"
+#include "SymbolXref.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "Project"
@@ -69,8 +77,13 @@ Project::Project(const char *name, const char *targetname)
 	fOpSize(false),
 	fOpLevel(0),
 	fTargetType(TARGET_APP),
-	fSCMType(gDefaultSCM)
+	fSCMType(gDefaultSCM),
+	fSavedHash(0),
+	fCompileTimesChanged(false)
 {
+	fSearchIndex = NULL;
+	fSymbolXref = NULL;
+
 	if (name != NULL) {
 		BString filename(name);
 		filename << ".pld";
@@ -95,10 +108,127 @@ Project::Project(const char *name, const char *targetname)
 
 Project::~Project(void)
 {
+	// The index deletes itself when its looper quits
+	if (fSearchIndex != NULL)
+		fSearchIndex->Shutdown();
+
+	SaveCompileTimes();
+
+	delete fSymbolXref;
 	delete fErrorList;
 }
 
 
+// Appends the '|'-separated list of paths with the project folder stripped
+// from the front of each
+static void
+AppendRelative(BString& data, const char* paths, const BString& prefix)
+{
+	while (paths != NULL) {
+		const char* end = strchr(paths, '|');
+		int32 length = end != NULL ? end - paths : strlen(paths);
+
+		if (length >= prefix.Length()
+			&& strncmp(paths, prefix.String(), prefix.Length()) == 0) {
+			paths += prefix.Length();
+			length -= prefix.Length();
+		}
+		data.Append(paths, length);
+
+		if (end == NULL)
+			break;
+
+		data << "|";
+		paths = end + 1;
+	}
+}
+
+
+// 64-bit FNV-1a, which is plenty to tell one version of a project file from
+// the next
+static uint64
+HashData(const char* data, size_t length)
+{
+	uint64 hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (uint8)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+static void
+CopyAttributes(BNode& from, BNode& to)
+{
+	char name[B_ATTR_NAME_LENGTH];
+	while (from.GetNextAttrName(name) == B_OK) {
+		attr_info info;
+		if (from.GetAttrInfo(name, &info) != B_OK)
+			continue;
+
+		char* buffer = new char[info.size];
+		ssize_t size = from.ReadAttr(name, info.type, 0, buffer, info.size);
+		if (size >= 0)
+			to.WriteAttr(name, info.type, 0, buffer, size);
+		delete [] buffer;
+	}
+}
+
+
+// Writes the project to a temporary file next to it and renames it into
+// place, so a crash or a full disk can't leave a truncated project behind.
+// Attributes on the old file, like window positions, are carried over.
+static status_t
+WriteProjectFile(const char* path, const BString& data)
+{
+	// Replace the file a link points to, not the link
+	BEntry entry(path, true);
+	BPath target;
+	if (entry.InitCheck() != B_OK || entry.GetPath(&target) != B_OK)
+		target.SetTo(path);
+
+	BString tempPath(target.Path());
+	tempPath << ".tmp";
+
+	BFile file(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	ssize_t written = file.Write(data.String(), data.Length());
+	if (written != data.Length())
+		status = written < 0 ? written : B_IO_ERROR;
+
+	if (status == B_OK) {
+		BNode oldFile(target.Path());
+		if (oldFile.InitCheck() == B_OK)
+			CopyAttributes(oldFile, file);
+
+		BNodeInfo nodeInfo(&file);
+		nodeInfo.SetType(PROJECT_MIME_TYPE);
+
+		status = file.Sync();
+	}
+	file.Unset();
+
+	if (status == B_OK && rename(tempPath.String(), target.Path()) != 0)
+		status = errno;
+
+	if (status != B_OK)
+		unlink(tempPath.String());
+
+	return status;
+}
+
+
+static inline bool
+KeyIs(const char* key, int32 length, const char* name)
+{
+	return strncmp(key, name, length) == 0 && name[length] == '\0';
+}
+
+
 status_t
 Project::Load(const char* path)
 {
@@ -112,12 +242,51 @@ Project::Load(const char* path)
 
 	fReadOnly = BVolume(ref.device).IsReadOnly();
 
-	TextFile file(ref, B_READ_ONLY);
-	status = file.InitCheck();
-	if (status != B_OK)
+	// Project files can run to tens of thousands of lines, so rather than
+	// reading the file into a buffer and copying each line out of it, we map
+	// it and parse it in place
+	BPath filePath(&ref);
+	int fd = open(filePath.Path(), O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		status = errno;
+		close(fd);
 		return status;
+	}
+
+	size_t dataSize = fileStat.st_size;
+	const char* data = NULL;
+	void* mapping = MAP_FAILED;
+	char* buffer = NULL;
+	if (dataSize > 0) {
+		mapping = mmap(NULL, dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED)
+			data = (const char*)mapping;
+		else {
+			// Not every file system can map files. Fall back to reading it.
+			buffer = new char[dataSize];
+			if (read(fd, buffer, dataSize) != (ssize_t)dataSize) {
+				delete [] buffer;
+				close(fd);
+				return B_IO_ERROR;
+			}
+			data = buffer;
+		}
+	}
+	close(fd);
+
+	bigtime_t startTime = system_time();
 
 	fGroupList.MakeEmpty();
+	fFileIndex.clear();
+	fFileNameIndex.clear();
+	fDirtyFiles.MakeEmpty();
+	fDirtySet.clear();
+	fDependents.clear();
+	fLinkedDependencies.clear();
 
 	fPath = path;
 	fName = fPath.GetBaseName();
@@ -130,122 +299,172 @@ Project::Load(const char* path)
 	// there is no SCM entry in the project
 	fSCMType = SCM_INIT;
 
+	BString projectFolder(fPath.GetFolder());
+	BString sourcePath;
+	int32 lineCount = 0;
+	int32 fileCount = 0;
+
 	SourceGroup *srcgroup = NULL;
 	SourceFile *srcfile = NULL;
-	BString line = file.ReadLine();
-	while (line.CountChars() > 0) {
-		int32 pos = line.FindFirst("=");
-		if (pos < 0) {
-			line = file.ReadLine();
-			continue;
-		}
+	const char* cursor = data;
+	const char* dataEnd = data + dataSize;
+	while (cursor < dataEnd) {
+		const char* lineEnd = (const char*)memchr(cursor, '\n',
+			dataEnd - cursor);
+		if (lineEnd == NULL)
+			lineEnd = dataEnd;
+
+		// The project file ends at the first empty line
+		if (lineEnd == cursor)
+			break;
 
-		BString entry = line;
-		entry.Truncate(pos);
+		const char* key = cursor;
+		cursor = lineEnd + 1;
+		lineCount++;
 
-		BString value = line.String() + pos + 1;
-		
-		STRACE(2, ("Load Project: %s=%s\n" ,entry.String(), value.String()));
+		const char* equals = (const char*)memchr(key, '=', lineEnd - key);
+		if (equals == NULL || equals == lineEnd - 1 || key[0] == '#')
+			continue;
 
-		if (value.CountChars() > 0) {
-			if (entry[0] == '#')
+		int32 keyLength = equals - key;
+		const char* valueStart = equals + 1;
+		int32 valueLength = lineEnd - valueStart;
+
+		STRACE(2, ("Load Project: %.*s=%.*s\n", (int)keyLength, key,
+			(int)valueLength, valueStart));
+
+		// Source files and their dependencies make up nearly all of a
+		// project, so they are handled without building any temporaries
+		if (KeyIs(key, keyLength, "SOURCEFILE")) {
+			if (valueStart[0] != '/') {
+				sourcePath.SetTo(projectFolder);
+				sourcePath << "/";
+				sourcePath.Append(valueStart, valueLength);
+			} else
+				sourcePath.SetTo(valueStart, valueLength);
+
+			srcfile = gFileFactory.CreateSourceFileItem(sourcePath.String());
+			if (srcfile == NULL)
 				continue;
-			else if (entry == "SOURCEFILE") {
-				if (value.String()[0] != '/') {
-					value.Prepend("/");
-					value.Prepend(fPath.GetFolder());
-				}
-				srcfile = gFileFactory.CreateSourceFileItem(value.String());
-				AddFile(srcfile, srcgroup);
-			} else if (entry == "DEPENDENCY") {
-				if (srcfile)
-					srcfile->fDependencies = value;
-			} else if (entry == "LOCALINCLUDE") {
-				if (value.FindFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY") == 0)
-					value.ReplaceFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY",
-						BString("/boot/system/develop/headers"));
-				ProjectPath include(fPath.GetFolder(), value.String());
-				AddLocalInclude(include.Absolute().String());
-			} else if (entry == "SYSTEMINCLUDE") {
-				if (value.FindFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY") == 0)
-					value.ReplaceFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY",
-						BString("/boot/system/develop/headers"));
-				AddSystemInclude(value.String());
-			} else if (entry == "LIBRARY") {
-				if (value.FindFirst("B_FIND_PATH_DEVELOP_LIB_DIRECTORY") == 0) {
-					if (actualPlatform == PLATFORM_HAIKU_GCC4) {
-						value.ReplaceFirst("B_FIND_PATH_DEVELOP_LIB_DIRECTORY",
-							BString("/boot/system/develop/lib"));
-					} else if (actualPlatform == PLATFORM_HAIKU) {
-						value.ReplaceFirst("B_FIND_PATH_DEVELOP_LIB_DIRECTORY",
-							BString("/boot/system/develop/lib/x86"));
-					} else {
-						STRACE(1,("UNKNOWN platform whilst resolving lib path: %s\n",actualPlatform));
-					}
+
+			if (srcgroup == NULL) {
+				delete srcfile;
+				srcfile = NULL;
+				continue;
+			}
+
+			// A freshly made file can't be in the project yet, so skip the
+			// checks AddFile does. The build info is updated once at the end.
+			srcgroup->filelist.AddItem(srcfile);
+			IndexFile(srcfile);
+			fileCount++;
+
+			const char* folder = srcfile->GetPath().GetFolder();
+			if (folder != NULL && projectFolder != folder)
+				AddLocalInclude(folder);
+			continue;
+		} else if (KeyIs(key, keyLength, "DEPENDENCY")) {
+			if (srcfile)
+				srcfile->fDependencies.SetTo(valueStart, valueLength);
+			continue;
+		}
+
+		BString entry(key, keyLength);
+		BString value(valueStart, valueLength);
+
+		if (entry == "LOCALINCLUDE") {
+			if (value.FindFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY") == 0)
+				value.ReplaceFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY",
+					BString("/boot/system/develop/headers"));
+			ProjectPath include(fPath.GetFolder(), value.String());
+			AddLocalInclude(include.Absolute().String());
+		} else if (entry == "SYSTEMINCLUDE") {
+			if (value.FindFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY") == 0)
+				value.ReplaceFirst("B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY",
+					BString("/boot/system/develop/headers"));
+			AddSystemInclude(value.String());
+		} else if (entry == "LIBRARY") {
+			if (value.FindFirst("B_FIND_PATH_DEVELOP_LIB_DIRECTORY") == 0) {
+				if (actualPlatform == PLATFORM_HAIKU_GCC4) {
+					value.ReplaceFirst("B_FIND_PATH_DEVELOP_LIB_DIRECTORY",
+						BString("/boot/system/develop/lib"));
+				} else if (actualPlatform == PLATFORM_HAIKU) {
+					value.ReplaceFirst("B_FIND_PATH_DEVELOP_LIB_DIRECTORY",
+						BString("/boot/system/develop/lib/x86"));
+				} else {
+					STRACE(1,("UNKNOWN platform whilst resolving lib path: %s\n",actualPlatform));
 				}
-				if (value.FindFirst("B_FIND_PATH_LIB_DIRECTORY") == 0) {
-					if (actualPlatform == PLATFORM_HAIKU_GCC4) {
-						value.ReplaceFirst("B_FIND_PATH_LIB_DIRECTORY",
-							BString("/boot/system/lib"));
-					} else if (actualPlatform == PLATFORM_HAIKU) {
-						value.ReplaceFirst("B_FIND_PATH_LIB_DIRECTORY",
-							BString("/boot/system/lib/x86"));
-					} else {
-						STRACE(1,("UNKNOWN platform whilst resolving lib path: %s\n",actualPlatform));
-					}
+			}
+			if (value.FindFirst("B_FIND_PATH_LIB_DIRECTORY") == 0) {
+				if (actualPlatform == PLATFORM_HAIKU_GCC4) {
+					value.ReplaceFirst("B_FIND_PATH_LIB_DIRECTORY",
+						BString("/boot/system/lib"));
+				} else if (actualPlatform == PLATFORM_HAIKU) {
+					value.ReplaceFirst("B_FIND_PATH_LIB_DIRECTORY",
+						BString("/boot/system/lib/x86"));
+				} else {
+					STRACE(1,("UNKNOWN platform whilst resolving lib path: %s\n",actualPlatform));
 				}
-					
-				if (actualPlatform == fPlatform)
-					AddLibrary(value.String());
-				else
-					ImportLibrary(value.String(),actualPlatform);
-			} else if (entry == "GROUP") {
-				srcgroup = AddGroup(value.String());
-			} else if (entry == "EXPANDGROUP") {
-				if (srcgroup)
-					srcgroup->expanded = value == "yes" ? true : false;
-			} else if (entry == "TARGETNAME") {
-				fTargetName = value;
-			} else if (entry == "CCDEBUG") {
-				fDebug = value == "yes" ? true : false;
-			} else if (entry == "CCPROFILE") {
-				fProfile = value == "yes" ? true : false;
-			} else if (entry == "CCOPSIZE") {
-				fOpSize = value == "yes" ? true : false;
-			} else if (entry == "CCOPLEVEL") {
-				fOpLevel = atoi(value.String());
-			} else if (entry == "CCTARGETTYPE") {
-				fTargetType = atoi(value.String());
-			} else if (entry == "CCEXTRA") {
-				fExtraCompilerOptions = value;
-			} else if (entry == "LDEXTRA") {
-				fExtraLinkerOptions = value;
-			} else if (entry == "RUNARGS") {
-				fRunArgs = value;
-			} else if (entry == "SCM") {
-				if (value.ICompare("hg") == 0)
-					fSCMType = SCM_HG;
-				else if (value.ICompare("git") == 0)
-					fSCMType = SCM_GIT;
-				else if (value.ICompare("svn") == 0)
-					fSCMType = SCM_SVN;
-				else
-					fSCMType = SCM_NONE;
-			} else if (entry == "PLATFORM") {
-				if (value.ICompare("Haiku") == 0)
-					fPlatform = PLATFORM_HAIKU;
-				else if (value.ICompare("HaikuGCC4") == 0)
-					fPlatform = PLATFORM_HAIKU_GCC4;
-				else if (value.ICompare("Zeta") == 0)
-					fPlatform = PLATFORM_ZETA;
-				else
-					fPlatform = PLATFORM_R5;
-			}	
+			}
+				
+			if (actualPlatform == fPlatform)
+				AddLibrary(value.String());
+			else
+				ImportLibrary(value.String(),actualPlatform);
+		} else if (entry == "GROUP") {
+			srcgroup = AddGroup(value.String());
+		} else if (entry == "EXPANDGROUP") {
+			if (srcgroup)
+				srcgroup->expanded = value == "yes" ? true : false;
+		} else if (entry == "TARGETNAME") {
+			fTargetName = value;
+		} else if (entry == "CCDEBUG") {
+			fDebug = value == "yes" ? true : false;
+		} else if (entry == "CCPROFILE") {
+			fProfile = value == "yes" ? true : false;
+		} else if (entry == "CCOPSIZE") {
+			fOpSize = value == "yes" ? true : false;
+		} else if (entry == "CCOPLEVEL") {
+			fOpLevel = atoi(value.String());
+		} else if (entry == "CCTARGETTYPE") {
+			fTargetType = atoi(value.String());
+		} else if (entry == "CCEXTRA") {
+			fExtraCompilerOptions = value;
+		} else if (entry == "LDEXTRA") {
+			fExtraLinkerOptions = value;
+		} else if (entry == "RUNARGS") {
+			fRunArgs = value;
+		} else if (entry == "SCM") {
+			if (value.ICompare("hg") == 0)
+				fSCMType = SCM_HG;
+			else if (value.ICompare("git") == 0)
+				fSCMType = SCM_GIT;
+			else if (value.ICompare("svn") == 0)
+				fSCMType = SCM_SVN;
+			else
+				fSCMType = SCM_NONE;
+		} else if (entry == "PLATFORM") {
+			if (value.ICompare("Haiku") == 0)
+				fPlatform = PLATFORM_HAIKU;
+			else if (value.ICompare("HaikuGCC4") == 0)
+				fPlatform = PLATFORM_HAIKU_GCC4;
+			else if (value.ICompare("Zeta") == 0)
+				fPlatform = PLATFORM_ZETA;
+			else
+				fPlatform = PLATFORM_R5;
 		}
-
-		line = file.ReadLine();
 	}
 
+	UpdateDependencyGraph();
+
+	// Saving the project as it was loaded doesn't need to touch the file
+	fSavedHash = HashData(data, dataSize);
+	fSavedPath = path;
+
+	if (mapping != MAP_FAILED)
+		munmap(mapping, dataSize);
+	delete [] buffer;
+
 	// Fix one of my pet peeves when changing platforms: having to add libsupc++.so
 	// whenever I change to Haiku GCC4 or GCC4hybrid from any other platform
 	if (actualPlatform == PLATFORM_HAIKU_GCC4 && actualPlatform != fPlatform) {
@@ -262,6 +481,7 @@ Project::Load(const char* path)
 	fObjectPath.Append(objfolder.String());
 
 	UpdateBuildInfo();
+	LoadCompileTimes();
 
 	// We now set the platform to whatever we're building on. fPlatform is only used
 	// in the project loading code to be able to help cover over issues with changing platforms.
@@ -269,6 +489,9 @@ Project::Load(const char* path)
 	// unforeseen issues that will come to light in the future.
 	fPlatform = actualPlatform;
 
+	STRACE(1, ("Loaded project %s: %ld lines, %ld files in %lld us\n", path,
+		lineCount, fileCount, system_time() - startTime));
+
 	return B_OK;
 }
 
@@ -317,14 +540,15 @@ Project::Save(const char* path)
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
 			SourceFile* file = group->filelist.ItemAt(j);
 
-			BString temppath(file->GetPath().GetFullPath());
-			temppath.ReplaceAll(projectPath, "");
+			data << "SOURCEFILE=";
+			AppendRelative(data, file->GetPath().GetFullPath(), projectPath);
+			data << "\n";
 
-			data << "SOURCEFILE=" << temppath << "\n";
-			if (file->GetDependencies() && strlen(file->GetDependencies()) > 0) {
-				BString deps = file->GetDependencies();
-				deps.ReplaceAll(projectPath, "");
-				data << "DEPENDENCY=" << deps << "\n";
+			const char* deps = file->GetDependencies();
+			if (deps != NULL && deps[0] != '\0') {
+				data << "DEPENDENCY=";
+				AppendRelative(data, deps, projectPath);
+				data << "\n";
 			}
 		}
 	}
@@ -349,32 +573,6 @@ Project::Save(const char* path)
 		data << "SYSTEMINCLUDE=" << include << "\n";
 	}
 
-	char* pathBuffer = new char[255]; // TODO validate this won't overflow, or be too short
-	status_t findStatus = find_path_for_path("/", B_FIND_PATH_DEVELOP_LIB_DIRECTORY, NULL, 
-		pathBuffer,sizeof(pathBuffer));
-	STRACE(2,("Path to B_FIND_PATH_DEVELOP_LIB_DIRECTORY: %s\n",pathBuffer));
-	switch(findStatus) {
-		case B_OK:
-		{
-			STRACE(2,("Entry found\n"));
-			break;
-		}
-		case B_BUFFER_OVERFLOW:
-		{
-			STRACE(2,("Buffer Overflow\n"));
-			break;
-		}
-		case B_ENTRY_NOT_FOUND:
-		{
-			STRACE(2,("Entry not found\n"));
-			break;
-		}
-		default:
-		{
-			STRACE(2,("Unknown find Status: %i\n",findStatus));
-		}
-	}
-		
 	for (int32 i = 0; i < fLibraryList.CountItems(); i++) {
 		SourceFile* file = (SourceFile*)fLibraryList.ItemAt(i);
 		if (file == NULL)
@@ -420,15 +618,27 @@ Project::Save(const char* path)
 	data << "CCEXTRA=" << fExtraCompilerOptions << "\n";
 	data << "LDEXTRA=" << fExtraLinkerOptions << "\n";
 
-	BFile file(path,B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
-	if (file.InitCheck() != B_OK) {
-		STRACE(2,("Couldn't create project file %s. Bailing out\n",path));
-		return;
-	}
+	// Most saves follow a change that doesn't touch the project file at all,
+	// like a build, so only write when the contents differ from the last ones
+	// written or read
+	uint64 hash = HashData(data.String(), data.Length());
+	if (hash == fSavedHash && fSavedPath == path && BEntry(path).Exists()) {
+		STRACE(2,("Project %s is unchanged. Skipping save\n",path));
+	} else {
+		status_t status = WriteProjectFile(path, data);
+		if (status != B_OK) {
+			STRACE(2,("Couldn't save project file %s: %s\n",path,
+				strerror(status)));
+			return;
+		}
+
+		STRACE(2,("Saved Project %s. Data as follows:\n%s\n",path,data.String()));
 
-	STRACE(2,("Saved Project %s. Data as follows:\n%s\n",path,data.String()));
+		fSavedHash = hash;
+		fSavedPath = path;
+	}
 
-	file.Write(data.String(),data.Length());
+	SaveCompileTimes();
 
 	fPath = path;
 	fObjectPath = fPath.GetFolder();
@@ -437,9 +647,6 @@ Project::Save(const char* path)
 	objfolder << GetName() << ")";
 	fObjectPath.Append(objfolder.String());
 
-	BNodeInfo nodeInfo(&file);
-	nodeInfo.SetType(PROJECT_MIME_TYPE);
-
 	UpdateBuildInfo();
 }
 
@@ -487,6 +694,42 @@ Project::MakeAbsolutePath(const char* path)
 }
 
 
+BString
+Project::MakeDependencyPath(const char* path)
+{
+	BString absolute(MakeAbsolutePath(path));
+	if (absolute.FindFirst("/.") < 0)
+		return absolute;
+
+	// Done on the text instead of with BPath so that a header which was
+	// just removed still gets the same key it was added under
+	std::vector<BString> parts;
+	int32 start = 1;
+	while (start <= absolute.Length()) {
+		int32 end = absolute.FindFirst('/', start);
+		if (end < 0)
+			end = absolute.Length();
+
+		BString part;
+		absolute.CopyInto(part, start, end - start);
+		if (part == "..") {
+			if (!parts.empty())
+				parts.pop_back();
+		} else if (part.Length() > 0 && part != ".")
+			parts.push_back(part);
+
+		start = end + 1;
+	}
+
+	BString out;
+	for (size_t i = 0; i < parts.size(); i++)
+		out << "/" << parts[i];
+	if (out.Length() == 0)
+		out = "/";
+	return out;
+}
+
+
 DPath
 Project::GetPathForFile(SourceFile* file)
 {
@@ -526,6 +769,7 @@ Project::AddFile(SourceFile *file, SourceGroup *group, int32 index)
 		group->filelist.AddItem(file);
 	else
 		group->filelist.AddItem(file,index);
+	IndexFile(file);
 
 	BString path = file->GetPath().GetFolder();
 	if (path != fPath.GetFolder()) {
@@ -549,6 +793,11 @@ Project::RemoveFile(SourceFile* file)
 		return;
 	}
 
+	// RemoveGroup takes the file out of its group before calling us, so
+	// this can't depend on finding it below
+	UnindexFile(file);
+	MakeFileClean(file);
+
 	for (int32 i = 0; i < CountGroups(); i++) {
 		SourceGroup* group = GroupAt(i);
 		
@@ -568,17 +817,7 @@ Project::HasFile(const char* path)
 	if (path == NULL)
 		return false;
 
-	for (int32 i = 0; i < CountGroups(); i++) {
-		SourceGroup* group = GroupAt(i);
-
-		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* source = group->filelist.ItemAt(j);
-			if (source != NULL && strcmp(source->GetPath().GetFullPath(), path) == 0)
-				return true;
-		}
-	}
-
-	return false;
+	return fFileIndex.find(path) != fFileIndex.end();
 }
 
 
@@ -589,19 +828,10 @@ Project::HasFileName(const char* name)
 		return false;
 
 	DPath newfile(name);
-	for (int32 i = 0; i < CountGroups(); i++) {
-		SourceGroup* group = GroupAt(i);
-
-		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* source = group->filelist.ItemAt(j);
-			if (source != NULL && strcmp(source->GetPath().GetFileName(),
-					newfile.GetFileName()) == 0) {
-				return true;
-			}
-		}
-	}
+	if (newfile.GetFileName() == NULL)
+		return false;
 
-	return false;
+	return fFileNameIndex.find(newfile.GetFileName()) != fFileNameIndex.end();
 }
 
 bool
@@ -636,16 +866,417 @@ Project::FindFile(const char* path)
 	if (path == NULL)
 		return NULL;
 
+	file_index::iterator i = fFileIndex.find(path);
+	return i != fFileIndex.end() ? i->second : NULL;
+}
+
+
+size_t
+Project::path_hash::operator()(const BString& path) const
+{
+	// djb2, which is plenty for paths
+	size_t hash = 5381;
+	for (const char* c = path.String(); *c != '\0'; c++)
+		hash = hash * 33 + (uint8)*c;
+	return hash;
+}
+
+
+void
+Project::IndexFile(SourceFile* file)
+{
+	// The first file added for a path wins, just as the old linear
+	// search found it first
+	if (!fFileIndex.insert(std::make_pair(BString(file->GetPath().GetFullPath()),
+			file)).second)
+		return;
+
+	fFileNameIndex.insert(std::make_pair(BString(file->GetPath().GetFileName()),
+		file));
+
+	UpdateDependencyGraph(file);
+}
+
+
+void
+Project::UnindexFile(SourceFile* file)
+{
+	UnlinkDependencies(file);
+
+	file_index::iterator i = fFileIndex.find(file->GetPath().GetFullPath());
+	if (i == fFileIndex.end() || i->second != file)
+		return;
+	fFileIndex.erase(i);
+
+	typedef file_name_index::iterator name_iterator;
+	std::pair<name_iterator, name_iterator> range
+		= fFileNameIndex.equal_range(file->GetPath().GetFileName());
+	for (name_iterator j = range.first; j != range.second; j++) {
+		if (j->second == file) {
+			fFileNameIndex.erase(j);
+			break;
+		}
+	}
+}
+
+
+void
+Project::UpdateDependencyGraph(void)
+{
+	for (int32 i = 0; i < CountGroups(); i++) {
+		SourceGroup* group = GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+			UpdateDependencyGraph(group->filelist.ItemAt(j));
+	}
+}
+
+
+void
+Project::UpdateDependencyGraph(SourceFile* file)
+{
+	if (file == NULL)
+		return;
+
+	std::map<SourceFile*, BString>::iterator linked
+		= fLinkedDependencies.find(file);
+	if (linked != fLinkedDependencies.end()
+		&& linked->second == file->GetDependencies()) {
+		return;
+	}
+
+	UnlinkDependencies(file);
+
+	std::vector<BString> keys;
+	DependencyKeys(file->GetDependencies(), keys);
+	for (size_t i = 0; i < keys.size(); i++)
+		fDependents[keys[i]].insert(file);
+
+	fLinkedDependencies[file] = file->GetDependencies();
+}
+
+
+void
+Project::GetDependents(const char* header, BObjectList<SourceFile>& list)
+{
+	if (header == NULL)
+		return;
+
+	std::map<BString, std::set<SourceFile*> >::iterator i
+		= fDependents.find(MakeDependencyPath(header));
+	if (i == fDependents.end())
+		return;
+
+	for (std::set<SourceFile*>::iterator j = i->second.begin();
+			j != i->second.end(); j++) {
+		list.AddItem(*j);
+	}
+}
+
+
+void
+Project::MakeDependentsDirty(const char* header, BObjectList<SourceFile>& list)
+{
+	if (header == NULL)
+		return;
+
+	std::map<BString, std::set<SourceFile*> >::iterator i
+		= fDependents.find(MakeDependencyPath(header));
+	if (i == fDependents.end())
+		return;
+
+	for (std::set<SourceFile*>::iterator j = i->second.begin();
+			j != i->second.end(); j++) {
+		if (!(*j)->UsesBuild())
+			continue;
+
+		(*j)->SetBuildFlag(BUILD_YES);
+		MakeFileDirty(*j);
+		list.AddItem(*j);
+	}
+}
+
+
+void
+Project::GetHeaders(BStringList& list)
+{
+	for (std::map<BString, std::set<SourceFile*> >::iterator i
+			= fDependents.begin(); i != fDependents.end(); i++) {
+		list.Add(i->first);
+	}
+}
+
+
+void
+Project::UpdateSearchIndex(void)
+{
+	if (fSearchIndex == NULL) {
+		DPath indexPath(fObjectPath);
+		indexPath << "search.index";
+		fSearchIndex = new SearchIndex(indexPath.GetFullPath());
+		fSearchIndex->Run();
+	}
+
+	// The same files FindWindow searches: the project's own and their
+	// partners
+	std::vector<BString> files;
 	for (int32 i = 0; i < CountGroups(); i++) {
 		SourceGroup* group = GroupAt(i);
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* source = group->filelist.ItemAt(j);
-			if (source && strcmp(source->GetPath().GetFullPath(), path) == 0)
-				return source;
+			const DPath& path = group->filelist.ItemAt(j)->GetPath();
+			files.push_back(BString(path.GetFullPath()));
+
+			entry_ref partnerRef = GetPartnerRef(path.GetRef());
+			if (partnerRef.name)
+				files.push_back(BString(DPath(partnerRef).GetFullPath()));
 		}
 	}
 
-	return NULL;
+	fSearchIndex->SetFiles(files);
+}
+
+
+void
+Project::UpdateSymbolXref(int32 *cancel)
+{
+	// A build holds the project locked for as long as it runs
+	while (LockWithTimeout(100000) != B_OK) {
+		if (cancel != NULL && atomic_get(cancel) != 0)
+			return;
+	}
+
+	if (fSymbolXref == NULL) {
+		DPath indexPath(fObjectPath);
+		indexPath << "symbols.index";
+		fSymbolXref = new SymbolXref(indexPath.GetFullPath());
+	}
+
+	std::vector<object_file> objects;
+	for (int32 i = 0; i < CountGroups(); i++) {
+		SourceGroup* group = GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
+			SourceFile* file = group->filelist.ItemAt(j);
+			DPath objectPath(file->GetObjectPath(fBuildInfo));
+			if (!objectPath.GetFullPath())
+				continue;
+
+			object_file object;
+			object.object = objectPath.GetFullPath();
+			object.source = file->GetPath().GetFullPath();
+			object.library = false;
+			objects.push_back(object);
+		}
+	}
+
+	// Shared libraries are left to the runtime loader
+	for (int32 i = 0; i < CountLibraries(); i++) {
+		SourceFile* file = LibraryAt(i);
+		if (file == NULL)
+			continue;
+
+		object_file object;
+		object.object = file->GetPath().GetFullPath();
+		if (!object.object.EndsWith(".a"))
+			continue;
+
+		object.source = object.object;
+		object.library = true;
+		objects.push_back(object);
+	}
+
+	SymbolXref* xref = fSymbolXref;
+	Unlock();
+
+	// The xref has a lock of its own, so the project isn't held up while the
+	// objects are read
+	xref->Update(objects, cancel);
+}
+
+
+void
+Project::AddSymbolConflicts(ErrorList& list)
+{
+	if (fSymbolXref == NULL)
+		return;
+
+	std::vector<symbol_conflict> conflicts;
+	fSymbolXref->FindConflicts(conflicts);
+
+	for (size_t i = 0; i < conflicts.size(); i++) {
+		const symbol_conflict& conflict = conflicts[i];
+
+		BString text;
+		if (conflict.mismatch) {
+			text = B_TRANSLATE("The definitions of %symbol% differ, but the "
+				"linker keeps only one of them");
+		} else
+			text = B_TRANSLATE("%symbol% is defined more than once");
+		text.ReplaceFirst("%symbol%", conflict.name);
+
+		error_msg* warning = new error_msg;
+		warning->type = ERROR_WARNING;
+		warning->error = text;
+		warning->rawdata << "warning: " << text;
+		list.msglist.AddItem(warning);
+
+		for (size_t j = 0; j < conflict.definitions.size(); j++) {
+			const symbol_definition& definition = conflict.definitions[j];
+			BString where(DPath(definition.source).GetFileName());
+			if (definition.member.Length() > 0)
+				where << "(" << definition.member << ")";
+
+			BString size;
+			size << definition.size;
+			text = B_TRANSLATE("Defined in %file%, %size% bytes");
+			text.ReplaceFirst("%file%", where);
+			text.ReplaceFirst("%size%", size);
+
+			error_msg* note = new error_msg;
+			note->type = ERROR_NOTE;
+			note->parent = j + 1;
+			note->error = text;
+			note->rawdata << "note: " << text;
+
+			// Archive members can't be opened on their own
+			if (definition.member.Length() == 0)
+				note->path = definition.source;
+			list.msglist.AddItem(note);
+		}
+	}
+}
+
+
+void
+Project::UnlinkDependencies(SourceFile* file)
+{
+	std::map<SourceFile*, BString>::iterator linked
+		= fLinkedDependencies.find(file);
+	if (linked == fLinkedDependencies.end())
+		return;
+
+	std::vector<BString> keys;
+	DependencyKeys(linked->second.String(), keys);
+	for (size_t i = 0; i < keys.size(); i++) {
+		std::map<BString, std::set<SourceFile*> >::iterator header
+			= fDependents.find(keys[i]);
+		if (header == fDependents.end())
+			continue;
+
+		header->second.erase(file);
+		if (header->second.empty())
+			fDependents.erase(header);
+	}
+
+	fLinkedDependencies.erase(linked);
+}
+
+
+void
+Project::DependencyKeys(const char* dependencies, std::vector<BString>& keys)
+{
+	if (dependencies == NULL)
+		return;
+
+	while (*dependencies != '\0') {
+		const char* end = strchr(dependencies, '|');
+		int32 length = end != NULL ? end - dependencies : strlen(dependencies);
+
+		if (length > 0) {
+			BString dependency(dependencies, length);
+			keys.push_back(MakeDependencyPath(dependency.String()));
+		}
+
+		if (end == NULL)
+			break;
+		dependencies = end + 1;
+	}
+}
+
+
+void
+Project::LoadCompileTimes(void)
+{
+	DPath timesPath(fObjectPath);
+	timesPath << "compile.times";
+
+	BFile file(timesPath.GetFullPath(), B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK || size <= 0)
+		return;
+
+	BString data;
+	char* buffer = data.LockBuffer(size);
+	ssize_t bytesRead = file.Read(buffer, size);
+	data.UnlockBuffer(bytesRead > 0 ? bytesRead : 0);
+
+	// Each line is the time in microseconds and the full path of the source
+	const char* line = data.String();
+	while (*line != '\0') {
+		const char* end = strchr(line, '\n');
+		if (end == NULL)
+			end = line + strlen(line);
+
+		char* path;
+		bigtime_t compileTime = strtoll(line, &path, 10);
+		if (*path == ' ') {
+			BString pathString(path + 1, end - path - 1);
+			SourceFile* sourceFile = FindFile(pathString.String());
+			if (sourceFile != NULL && compileTime > 0)
+				sourceFile->SetCompileTime(compileTime);
+		}
+
+		line = *end != '\0' ? end + 1 : end;
+	}
+
+	fCompileTimesChanged = false;
+}
+
+
+void
+Project::SaveCompileTimes(void)
+{
+	if (!fCompileTimesChanged)
+		return;
+
+	BString data;
+	for (int32 i = 0; i < CountGroups(); i++) {
+		SourceGroup* group = GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
+			SourceFile* file = group->filelist.ItemAt(j);
+			if (file->CompileTime() > 0) {
+				data << file->CompileTime() << " "
+					<< file->GetPath().GetFullPath() << "\n";
+			}
+		}
+	}
+
+	// Written next to the old file and moved over it, like the indexes
+	DPath timesPath(fObjectPath);
+	timesPath << "compile.times";
+	BString tempPath(timesPath.GetFullPath());
+	tempPath << ".tmp";
+
+	BFile file(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status == B_OK) {
+		ssize_t written = file.Write(data.String(), data.Length());
+		if (written != data.Length())
+			status = written < 0 ? written : B_IO_ERROR;
+	}
+	file.Unset();
+
+	if (status == B_OK
+		&& rename(tempPath.String(), timesPath.GetFullPath()) != 0) {
+		status = errno;
+	}
+
+	if (status != B_OK) {
+		unlink(tempPath.String());
+		STRACE(2,("Couldn't save compile times %s: %s\n",
+			timesPath.GetFullPath(), strerror(status)));
+		return;
+	}
+
+	fCompileTimesChanged = false;
 }
 
 
@@ -663,7 +1294,7 @@ Project::CountFiles(void)
 bool
 Project::IsFileDirty(SourceFile* file)
 {
-	return fDirtyFiles.HasItem(file);
+	return fDirtySet.find(file) != fDirtySet.end();
 }
 
 
@@ -673,7 +1304,7 @@ Project::MakeFileDirty(SourceFile* file)
 	if  (file == NULL || !HasFile(GetPathForFile(file).GetFullPath()))
 		return;
 
-	if (!fDirtyFiles.HasItem(file))
+	if (fDirtySet.insert(file).second)
 		fDirtyFiles.AddItem(file);
 }
 
@@ -681,8 +1312,10 @@ Project::MakeFileDirty(SourceFile* file)
 void
 Project::MakeFileClean(SourceFile* file)
 {
-	int32 index = fDirtyFiles.IndexOf(file);
-	fDirtyFiles.RemoveItemAt(index);
+	// The builder always cleans the file at the front of the list, so the
+	// search here is short in practice
+	if (fDirtySet.erase(file) > 0)
+		fDirtyFiles.RemoveItem(file);
 }
 
 
@@ -703,14 +1336,17 @@ Project::CountDirtyFiles(void) const
 void
 Project::SortDirtyList(void)
 {
+	// Put the dirty files in project order in one pass
+	if (fDirtyFiles.CountItems() < 2)
+		return;
+
+	fDirtyFiles.MakeEmpty();
 	for (int32 i = 0; i < CountGroups(); i++) {
 		SourceGroup* group = GroupAt(i);
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
 			SourceFile* file = group->filelist.ItemAt(j);
-			if (IsFileDirty(file)) {
-				MakeFileClean(file);
-				MakeFileDirty(file);
-			}
+			if (IsFileDirty(file))
+				fDirtyFiles.AddItem(file);
 		}
 	}
 }
@@ -750,7 +1386,7 @@ Project::UpdateBuildInfo(void)
 		fBuildInfo.includeString << " -I '" << newItem->Absolute() << "'";
 	}
 
-	fBuildInfo.errorList.msglist.MakeEmpty();
+	fBuildInfo.errorList.MakeEmpty();
 }
 
 
@@ -807,7 +1443,15 @@ Project::CompileFile(SourceFile* file)
 	}
 
 	DPath projfolder(GetPath().GetFolder());
+	bigtime_t startTime = system_time();
 	file->Compile(fBuildInfo,compileString.String());
+
+	// A compile which stops at the first error says little about how long
+	// the file takes
+	if (fBuildInfo.errorList.CountErrors() == 0) {
+		file->SetCompileTime(system_time() - startTime);
+		fCompileTimesChanged = true;
+	}
 }
 
 
@@ -833,8 +1477,9 @@ Project::Link(void)
 			for (int32 j = 0; j < group->filelist.CountItems(); j++)
 			{
 				SourceFile *file = group->filelist.ItemAt(j);
-				if (file->GetObjectPath(fBuildInfo).GetFullPath())
-					linkString << "'" << file->GetObjectPath(fBuildInfo).GetFullPath() << "' ";
+				DPath objectPath(file->GetObjectPath(fBuildInfo));
+				if (objectPath.GetFullPath())
+					linkString << "'" << objectPath.GetFullPath() << "' ";
 			}
 		}
 	} else {
@@ -848,8 +1493,9 @@ Project::Link(void)
 			for (int32 j = 0; j < group->filelist.CountItems(); j++)
 			{
 				SourceFile *file = group->filelist.ItemAt(j);
-				if (file->GetObjectPath(fBuildInfo).GetFullPath())
-					linkString << "'" << file->GetObjectPath(fBuildInfo).GetFullPath() << "' ";
+				DPath objectPath(file->GetObjectPath(fBuildInfo));
+				if (objectPath.GetFullPath())
+					linkString << "'" << objectPath.GetFullPath() << "' ";
 			}
 		}
 
@@ -858,10 +1504,9 @@ Project::Link(void)
 			
 			for (int32 j = 0; j < group->filelist.CountItems(); j++) {
 				SourceFile* file = group->filelist.ItemAt(j);
-				if (file->GetLibraryPath(fBuildInfo).GetFullPath()) {
-					linkString << "'" << file->GetLibraryPath(fBuildInfo).GetFullPath()
-						<< "' ";
-				}
+				DPath libraryPath(file->GetLibraryPath(fBuildInfo));
+				if (libraryPath.GetFullPath())
+					linkString << "'" << libraryPath.GetFullPath() << "' ";
 			}
 		}
 
@@ -937,6 +1582,92 @@ Project::Link(void)
 }
 
 
+void
+Project::AddLibraryNotes(ErrorList &list)
+{
+	// The linker reports each missing symbol once for every function using
+	// it, so only the first report of each gets the notes
+	std::set<BString> names;
+	std::vector<BString> symbols(list.msglist.CountItems());
+	for (int32 i = 0; i < list.msglist.CountItems(); i++)
+	{
+		BString symbol;
+		if (ParseUndefinedReference(list.msglist.ItemAt(i)->error.String(),
+				symbol) && names.insert(symbol).second)
+			symbols[i] = symbol;
+	}
+	
+	if (names.empty() || gSymbolIndex == NULL)
+		return;
+	
+	// The index is brought up to date in the background from the start, so
+	// whatever it has is used rather than reading the libraries now
+	gSymbolIndex->LoadIfNeeded();
+	std::map<BString, BStringList> providers;
+	gSymbolIndex->FindProviders(names, providers);
+	
+	// A function made static in one file and used from another is a common
+	// cause, and no library will help with it
+	std::map<BString, BStringList> localDefinitions;
+	if (fSymbolXref != NULL)
+		fSymbolXref->FindLocalDefinitions(names, localDefinitions);
+	
+	ErrorList notedList;
+	for (int32 i = 0; i < list.msglist.CountItems(); i++)
+	{
+		notedList.msglist.AddItem(new error_msg(*list.msglist.ItemAt(i)));
+		if (symbols[i].Length() == 0)
+			continue;
+		
+		int32 noteCount = 0;
+		const BStringList &libraries = providers[symbols[i]];
+		std::set<BString> fileNames;
+		for (int32 j = 0; j < libraries.CountStrings(); j++)
+		{
+			// The same library can be in more than one of the folders
+			DPath libraryPath(libraries.StringAt(j));
+			if (!fileNames.insert(libraryPath.GetFileName()).second)
+				continue;
+			
+			BString text = B_TRANSLATE("%library% defines %symbol%. "
+				"Double-click to add it to the project.");
+			text.ReplaceFirst("%library%", libraryPath.GetFileName());
+			text.ReplaceFirst("%symbol%", symbols[i]);
+			
+			error_msg *note = new error_msg;
+			note->type = ERROR_NOTE;
+			note->parent = ++noteCount;
+			note->error = text;
+			note->rawdata << "note: " << libraryPath.GetFullPath()
+				<< " defines " << symbols[i];
+			note->library = libraryPath.GetFullPath();
+			notedList.msglist.AddItem(note);
+		}
+		
+		const BStringList &sources = localDefinitions[symbols[i]];
+		for (int32 j = 0; j < sources.CountStrings(); j++)
+		{
+			DPath sourcePath(sources.StringAt(j));
+			BString text = B_TRANSLATE("%source% defines %symbol%, but only "
+				"for its own use, as static.");
+			text.ReplaceFirst("%source%", sourcePath.GetFileName());
+			text.ReplaceFirst("%symbol%", symbols[i]);
+			
+			error_msg *note = new error_msg;
+			note->type = ERROR_NOTE;
+			note->parent = ++noteCount;
+			note->error = text;
+			note->rawdata << "note: " << sourcePath.GetFileName()
+				<< " defines " << symbols[i] << " as static";
+			note->path = sourcePath.GetFullPath();
+			notedList.msglist.AddItem(note);
+		}
+	}
+	
+	list = notedList;
+}
+
+
 void
 Project::UpdateResources(void)
 {
@@ -949,9 +1680,9 @@ Project::UpdateResources(void)
 		SourceGroup* group = GroupAt(i);
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
 			SourceFile* file = group->filelist.ItemAt(j);
-			if (file->GetResourcePath(fBuildInfo).GetFullPath()) {
-				resFileString << "'" << file->GetResourcePath(fBuildInfo).GetFullPath()
-					<< "' ";
+			DPath resourcePath(file->GetResourcePath(fBuildInfo));
+			if (resourcePath.GetFullPath()) {
+				resFileString << "'" << resourcePath.GetFullPath() << "' ";
 				resCount++;
 			}
 		}
@@ -17,6 +17,13 @@
 #include <time.h>
 #include <List.h>
 #include <Resources.h>
+#include <StringList.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "BuildInfo.h"
 #include "DPath.h"
@@ -25,6 +32,8 @@
 #include "ProjectPath.h"
 
 
+class SearchIndex;
+class SymbolXref;
 class SourceFile;
 class SourceGroup;
 class OutStream;
@@ -89,8 +98,12 @@ public:
 			const char *GetTargetName(void) const { return fTargetName.String(); }
 			
 			BString		MakeAbsolutePath(const char *path);
-			DPath		GetPath(void) const { return fPath; }
-			DPath		GetObjectPath(void) const { return fObjectPath; }
+			// The absolute path with "." and ".." taken out, which is how
+			// headers are known in the dependency graph. gcc keeps the
+			// spelling of the #include, so one header can come in many ways.
+			BString		MakeDependencyPath(const char *path);
+			const DPath &GetPath(void) const { return fPath; }
+			const DPath &GetObjectPath(void) const { return fObjectPath; }
 			DPath		GetPathForFile(SourceFile *file);
 			bool		LocateFile(const char *name, BPath& outPath);
 
@@ -108,6 +121,45 @@ public:
 			int32		CountDirtyFiles(void) const;
 			void		SortDirtyList(void);
 			
+			// The graph of which sources include which headers, made from
+			// each file's dependency list. Call these after the lists change.
+			void		UpdateDependencyGraph(void);
+			void		UpdateDependencyGraph(SourceFile *file);
+			void		GetDependents(const char *header,
+									BObjectList<SourceFile> &list);
+			// Marks the sources which include header as needing a build and
+			// adds them to list
+			void		MakeDependentsDirty(const char *header,
+									BObjectList<SourceFile> &list);
+			void		GetHeaders(BStringList &list);
+			
+			// The index which narrows down text searches in the project's
+			// files. It is only kept while the project is open in a window,
+			// so this is NULL until UpdateSearchIndex() starts it.
+			SearchIndex *GetSearchIndex(void) const { return fSearchIndex; }
+			void		UpdateSearchIndex(void);
+			
+			// Which of the project's objects and static libraries define and
+			// use each symbol. It is NULL until UpdateSymbolXref() reads the
+			// objects, which the build does once it is done. Call
+			// UpdateSymbolXref() without the project locked: it only locks it
+			// to list the objects, not while reading them. Reading stops when
+			// cancel becomes non-zero.
+			SymbolXref *GetSymbolXref(void) const { return fSymbolXref; }
+			void		UpdateSymbolXref(int32 *cancel = NULL);
+			
+			// Adds a warning to list for each symbol the objects and static
+			// libraries define more than once in a way the link lets through.
+			// Call after UpdateSymbolXref().
+			void		AddSymbolConflicts(ErrorList &list);
+			
+			// Adds notes to the undefined references in list from the link
+			// about which libraries define the symbols and which sources
+			// define them as static. It reads nothing from disk but the
+			// symbol index, so call it without the project locked, after
+			// UpdateSymbolXref().
+			void		AddLibraryNotes(ErrorList &list);
+			
 			bool		CheckNeedsBuild(SourceFile *file, bool check_deps = true);
 			void		UpdateBuildInfo(void);
 			BuildInfo *	GetBuildInfo(void) { return &fBuildInfo; }
@@ -192,6 +244,17 @@ public:
 private:
 			void		ImportLibrary(const char *path, const platform_t &platform);
 			BString		FindLibrary(const char *name);
+			
+			void		IndexFile(SourceFile *file);
+			void		UnindexFile(SourceFile *file);
+			void		UnlinkDependencies(SourceFile *file);
+			void		DependencyKeys(const char *dependencies,
+									std::vector<BString> &keys);
+			
+			// The compile times change with every build, so they are kept
+			// in the objects folder rather than in the project file
+			void		LoadCompileTimes(void);
+			void		SaveCompileTimes(void);
 	
 	BString						fName,
 								fTargetName,
@@ -200,7 +263,25 @@ private:
 	DPath						fPath,
 								fObjectPath;
 	
+	struct path_hash {
+		size_t operator()(const BString &path) const;
+	};
+	typedef std::unordered_map<BString, SourceFile*, path_hash> file_index;
+	typedef std::unordered_multimap<BString, SourceFile*, path_hash>
+		file_name_index;
+	
 	BObjectList<SourceFile>		fDirtyFiles;
+	std::unordered_set<SourceFile*>	fDirtySet;
+	
+	// Every file in every group, by full path and by file name. Only ever
+	// looked up, never walked in order, so they are hashed.
+	file_index					fFileIndex;
+	file_name_index				fFileNameIndex;
+	
+	// Headers by absolute path to the sources including them, and the
+	// dependency list each source's edges were made from
+	std::map<BString, std::set<SourceFile*> >	fDependents;
+	std::map<SourceFile*, BString>		fLinkedDependencies;
 	BObjectList<SourceFile>		fLibraryList;
 	
 	BObjectList<ProjectPath>	fLocalIncludeList;
@@ -209,6 +290,8 @@ private:
 	
 	BObjectList<SourceGroup>	fGroupList;
 	ErrorList					*fErrorList;
+	SearchIndex					*fSearchIndex;
+	SymbolXref					*fSymbolXref;
 	
 	BuildInfo					fBuildInfo;
 	
@@ -223,6 +306,12 @@ private:
 	
 	BString		fExtraCompilerOptions;
 	BString		fExtraLinkerOptions;
+	
+	// What the project file held when it was last read or written
+	uint64		fSavedHash;
+	BString		fSavedPath;
+	
+	bool		fCompileTimesChanged;
 };
 
 int			PipeCommand(const char *command, BString &data);
@@ -13,6 +13,8 @@
 
 #include "ProjectList.h"
 
+#include <algorithm>
+
 #include <Bitmap.h>
 #include <Catalog.h>
 #include <Locale.h>
@@ -38,6 +40,13 @@
 static const rgb_color white = (rgb_color){ 255, 255, 255, 255 };
 static const rgb_color black = (rgb_color){ 0, 0, 0, 255 };
 
+// The status scanner checks this many files between sending updates
+static const int32 kScanBatchSize = 32;
+
+enum {
+	M_FILE_STATES = 'flst'
+};
+
 static int
 compare_bstringitems(BStringItem* one, BStringItem* two);
 
@@ -46,7 +55,11 @@ ProjectList::ProjectList(Project* project, const BRect& frame, const char* name,
 	const int32& resizingMode, const int32 flags)
 	:
 	BOutlineListView(frame, name, B_MULTIPLE_SELECTION_LIST, resizingMode, flags),
-	fProject(project)
+	fProject(project),
+	fScanThread(-1),
+	fScanCancelled(0),
+	fScanGeneration(0),
+	fScanPending(false)
 {
 }
 
@@ -54,7 +67,11 @@ ProjectList::ProjectList(Project* project, const BRect& frame, const char* name,
 ProjectList::ProjectList(Project* project, const char* name, const int32 flags)
 	:
 	BOutlineListView(name, B_MULTIPLE_SELECTION_LIST, flags),
-	fProject(project)
+	fProject(project),
+	fScanThread(-1),
+	fScanCancelled(0),
+	fScanGeneration(0),
+	fScanPending(false)
 {
 	STRACE(2,("ProjectList constructor\n"));
 }
@@ -62,12 +79,36 @@ ProjectList::ProjectList(Project* project, const char* name, const int32 flags)
 
 ProjectList::~ProjectList(void)
 {
+	StopScan();
+}
+
+
+void
+ProjectList::AttachedToWindow(void)
+{
+	BOutlineListView::AttachedToWindow();
+
+	if (fScanPending)
+		ScanFiles();
+}
+
+
+void
+ProjectList::DetachedFromWindow(void)
+{
+	StopScan();
+	BOutlineListView::DetachedFromWindow();
 }
 
 
 void
 ProjectList::MessageReceived(BMessage* message)
 {
+	if (message->what == M_FILE_STATES) {
+		ApplyFileStates(message);
+		return;
+	}
+
 	if (message->WasDropped() && Window() != NULL) {
 		entry_ref refs;
 		if (message->FindRef("refs", &refs) == B_OK)
@@ -268,34 +309,162 @@ ProjectList::RefreshList(void)
 		AddItem(groupitem);
 		groupitem->SetExpanded(group->expanded);
 
-		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* file = group->filelist.ItemAt(j);
-			SourceFileItem* fileItem = new SourceFileItem(file,1);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+			AddItem(new SourceFileItem(group->filelist.ItemAt(j), 1));
+	}
 
-			AddItem(fileItem);
-			
-			BString abspath = file->GetPath().GetFullPath();
-			if (abspath[0] != '/') {
-				abspath.Prepend("/");
-				abspath.Prepend(fProject->GetPath().GetFolder());
-			}
+	if (Window() != NULL)
+		Window()->EnableUpdates();
 
-			BEntry entry(abspath.String());
-			if (entry.Exists()) {
-				if (fProject->CheckNeedsBuild(file, false)) {
-					fileItem->SetDisplayState(SFITEM_NEEDS_BUILD);
-					InvalidateItem(IndexOf(fileItem));
-				} else
-					file->SetBuildFlag(BUILD_NO);
-			} else {
-				fileItem->SetDisplayState(SFITEM_MISSING);
-				InvalidateItem(IndexOf(fileItem));
-			}
+	ScanFiles();
+}
+
+
+void
+ProjectList::ScanFiles(void)
+{
+	StopScan();
+
+	if (Looper() == NULL) {
+		fScanPending = true;
+		return;
+	}
+	fScanPending = false;
+
+	// Only the project's own files are checked, not the dependency items the
+	// project window lists under them
+	fScanPaths.clear();
+	fScanIndices.clear();
+	for (int32 i = 0; i < FullListCountItems(); i++) {
+		SourceFileItem* item = dynamic_cast<SourceFileItem*>(FullListItemAt(i));
+		if (item == NULL || item->GetData() == NULL)
+			continue;
+
+		const char* path = item->GetData()->GetPath().GetFullPath();
+		if (path == NULL || fProject->FindFile(path) != item->GetData())
+			continue;
+
+		fScanPaths.push_back(BString(path));
+		fScanIndices.push_back(i);
+	}
+
+	if (fScanPaths.empty())
+		return;
+
+	fScanTarget = BMessenger(this);
+	fScanCancelled = 0;
+	fScanGeneration++;
+	fScanThread = spawn_thread(ScanThread, "file status scanner",
+		B_LOW_PRIORITY, this);
+	if (fScanThread >= 0)
+		resume_thread(fScanThread);
+}
+
+
+void
+ProjectList::StopScan(void)
+{
+	if (fScanThread < 0)
+		return;
+
+	atomic_set(&fScanCancelled, 1);
+
+	status_t result;
+	wait_for_thread(fScanThread, &result);
+	fScanThread = -1;
+}
+
+
+void
+ProjectList::ApplyFileStates(BMessage* message)
+{
+	int32 generation;
+	if (message->FindInt32("generation", &generation) != B_OK
+		|| generation != fScanGeneration) {
+		return;
+	}
+
+	int32 index;
+	const char* path;
+	int8 state;
+	for (int32 i = 0; message->FindInt32("index", i, &index) == B_OK
+			&& message->FindString("path", i, &path) == B_OK
+			&& message->FindInt8("state", i, &state) == B_OK; i++) {
+		// The list may have changed since the scan started, so make sure the
+		// item is still the one for this file
+		SourceFileItem* item = dynamic_cast<SourceFileItem*>(
+			FullListItemAt(index));
+		if (item == NULL || item->GetData() == NULL
+			|| strcmp(item->GetData()->GetPath().GetFullPath(), path) != 0) {
+			item = ItemForFile(fProject->FindFile(path));
+			if (item == NULL)
+				continue;
+		}
+
+		// A build in progress knows better
+		if (item->GetDisplayState() == state
+			|| item->GetDisplayState() == SFITEM_BUILDING) {
+			continue;
 		}
+
+		item->SetDisplayState(state);
+		InvalidateItem(IndexOf(item));
 	}
+}
 
-	if (Window() != NULL)
-		Window()->EnableUpdates();
+
+int32
+ProjectList::ScanThread(void* data)
+{
+	ProjectList* list = (ProjectList*)data;
+	Project* project = list->fProject;
+	int32* cancelled = &list->fScanCancelled;
+	int32 count = list->fScanPaths.size();
+
+	for (int32 start = 0; start < count; start += kScanBatchSize) {
+		BMessage message(M_FILE_STATES);
+		message.AddInt32("generation", list->fScanGeneration);
+
+		// Don't sit on the project lock while the window might need it
+		while (project->LockWithTimeout(100000) != B_OK) {
+			if (atomic_get(cancelled) != 0)
+				return B_CANCELED;
+		}
+
+		int32 end = std::min(start + kScanBatchSize, count);
+		for (int32 i = start; i < end && atomic_get(cancelled) == 0; i++) {
+			const BString& path = list->fScanPaths[i];
+			SourceFile* file = project->FindFile(path.String());
+			if (file == NULL)
+				continue;
+
+			uint8 state = SFITEM_NORMAL;
+			BString absolutePath(project->MakeAbsolutePath(path.String()));
+			if (!BEntry(absolutePath.String()).Exists())
+				state = SFITEM_MISSING;
+			else if (project->CheckNeedsBuild(file, false))
+				state = SFITEM_NEEDS_BUILD;
+			else
+				file->SetBuildFlag(BUILD_NO);
+
+			message.AddInt32("index", list->fScanIndices[i]);
+			message.AddString("path", path);
+			message.AddInt8("state", state);
+		}
+		project->Unlock();
+
+		// The window may be busy, so keep an eye out for being cancelled
+		// rather than blocking on a full port
+		while (atomic_get(cancelled) == 0
+			&& list->fScanTarget.SendMessage(&message, (BHandler*)NULL, 100000)
+				== B_TIMED_OUT) {
+		}
+
+		if (atomic_get(cancelled) != 0)
+			return B_CANCELED;
+	}
+
+	return B_OK;
 }
 
 
@@ -448,7 +617,7 @@ ProjectList::HandleDragAndDrop(BPoint dropPoint, const BMessage* message)
 					// We'll accomplish this by converting the path for the
 					// SourceItem's file into a ref and posting a message to the
 					// Window so that each file is properly added to the project.
-					DPath itemPath = srcFileItem->GetData()->GetPath();
+					const DPath &itemPath = srcFileItem->GetData()->GetPath();
 					BMessage message(B_SIMPLE_DATA);
 					entry_ref ref = itemPath.GetRef();
 					message.AddRef("refs", &ref);
@@ -14,6 +14,11 @@
 #include <OutlineListView.h>
 #include <Entry.h>
 #include <ListItem.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include <vector>
 
 
 enum
@@ -74,6 +79,8 @@ public:
 												| B_NAVIGABLE);
 		virtual				~ProjectList(void);
 
+		virtual	void		AttachedToWindow(void);
+		virtual	void		DetachedFromWindow(void);
 		virtual	void		MessageReceived(BMessage* message);
 		virtual	void		MouseDown(BPoint where);
 		virtual	void		KeyDown(const char* bytes, int32 numbytes);
@@ -88,6 +95,7 @@ public:
 
 				void		Clear(void);
 				void		RefreshList(void);
+				void		ScanFiles(void);
 
 private:
 				void		ShowContextMenu(BPoint where);
@@ -96,7 +104,22 @@ private:
 				bool		IsFilenameChar(char c);
 				int			charncmp(char c1, char c2);
 
+				void		StopScan(void);
+				void		ApplyFileStates(BMessage* message);
+		static	int32		ScanThread(void* data);
+
 				Project*	fProject;
+
+				// Whether files are missing or need building is found out by
+				// a thread so that slow disks don't hold up the window. It
+				// works on a copy of the paths of the files in the list.
+				thread_id	fScanThread;
+				int32		fScanCancelled;
+				int32		fScanGeneration;
+				bool		fScanPending;
+				BMessenger	fScanTarget;
+				std::vector<BString>	fScanPaths;
+				std::vector<int32>		fScanIndices;
 };
 
 
@@ -22,19 +22,20 @@ ProjectPath::operator=(const ProjectPath &from)
 {
 	fBase = from.fBase;
 	fPath = from.fPath;
+	fAbsolute = from.fAbsolute;
 	return *this;
 }
 
 
 bool
-ProjectPath::operator==(const ProjectPath &from)
+ProjectPath::operator==(const ProjectPath &from) const
 {
-	return (fBase.Compare(from.fBase) == 0 && fPath.Compare(from.fPath) == 0);
+	return fBase == from.fBase && fPath == from.fPath;
 }
 
 
 bool
-ProjectPath::operator!=(const ProjectPath &path)
+ProjectPath::operator!=(const ProjectPath &path) const
 {
 	return !(*this == path);
 }
@@ -51,56 +52,68 @@ ProjectPath::Set(const char *base, const char *path)
 void
 ProjectPath::SetBase(const char *base)
 {
-	fBase = base;
-	if (fBase.CountChars() > 0 && fBase.ByteAt(fBase.CountChars() - 1) != '/')
-		fBase << "/";
+	BString newBase(base);
+	if (newBase.CountChars() > 0 && newBase.ByteAt(newBase.CountChars() - 1) != '/')
+		newBase << "/";
+	fBase = newBase;
+	UpdateAbsolute();
 }
 
 
-BString
+const BString &
 ProjectPath::GetBase(void) const
 {
-	return fBase;
+	return fBase.String();
 }
 
 
 void
 ProjectPath::SetPath(const char *path)
 {
-	fPath = path;
+	BString newPath(path);
+	const BString &base = fBase.String();
 
 	// Check if path is subpath of fBase
-	if (fPath.FindFirst(fBase) == 0)
+	if (newPath.FindFirst(base) == 0)
 	{
 		// Remove fBase from fPath...
-		fPath.RemoveFirst(fBase);
+		newPath.RemoveFirst(base);
 
 		// and make sure path does not start with "/" now
-		if (fPath.FindFirst("/") == 0)
-			fPath.RemoveFirst("/");
+		if (newPath.FindFirst("/") == 0)
+			newPath.RemoveFirst("/");
 	}
+	fPath = newPath;
+	UpdateAbsolute();
 }
 
 
-BString
+const BString &
 ProjectPath::GetPath(void) const
 {
-	return fPath;
+	return fPath.String();
 }
 
 
-BString
+const BString &
 ProjectPath::Absolute(void) const
 {
-	BString out(fBase);
-	out << fPath;
-	return out;
+	return fAbsolute.String();
 }
 
 
-BString
+const BString &
 ProjectPath::Relative(void) const
 {
-	return fPath;
+	return fPath.String();
+}
+
+
+void
+ProjectPath::UpdateAbsolute(void)
+{
+	BString out(fBase.String());
+	out << fPath.String();
+	fAbsolute = out;
 }
 
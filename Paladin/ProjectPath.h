@@ -4,6 +4,8 @@
 #include <Entry.h>
 #include <String.h>
 
+#include "InternedPath.h"
+
 class ProjectPath
 {
 public:
@@ -11,23 +13,28 @@ public:
 					ProjectPath(const ProjectPath &from);
 					ProjectPath(void);
 	ProjectPath &	operator=(const ProjectPath &path);
-	bool			operator==(const ProjectPath &path);
-	bool			operator!=(const ProjectPath &path);
+	bool			operator==(const ProjectPath &path) const;
+	bool			operator!=(const ProjectPath &path) const;
 				
 	void			Set(const char *base, const char *path);
 	
 	void			SetBase(const char *base);
-	BString			GetBase(void) const;
+	const BString &	GetBase(void) const;
 	
 	void			SetPath(const char *path);
-	BString			GetPath(void) const;
+	const BString &	GetPath(void) const;
 				
-	BString			Absolute(void) const;
-	BString			Relative(void) const;
+	const BString &	Absolute(void) const;
+	const BString &	Relative(void) const;
 	
 private:
-	BString		fBase,
-				fPath;
+	void			UpdateAbsolute(void);
+	
+	// The include paths are looked at for every dependency of every file,
+	// so the absolute form is built once here rather than on each call
+	InternedPath	fBase,
+					fPath,
+					fAbsolute;
 };
 
 #endif
@@ -0,0 +1,358 @@
+#include "ProjectWatcher.h"
+
+#include <Autolock.h>
+#include <Entry.h>
+#include <NodeMonitor.h>
+#include <Path.h>
+
+#include "BuildInfo.h"
+#include "DebugTools.h"
+#include "Project.h"
+#include "ProjectBuilder.h"
+#include "SearchIndex.h"
+#include "SourceFile.h"
+
+
+ProjectWatcher::ProjectWatcher(Project* project, BMessenger target)
+	:
+	BHandler("project watcher"),
+	fProject(project),
+	fTarget(target)
+{
+}
+
+
+ProjectWatcher::~ProjectWatcher(void)
+{
+	Stop();
+}
+
+
+void
+ProjectWatcher::MessageReceived(BMessage* message)
+{
+	if (message->what == B_NODE_MONITOR)
+		HandleNodeMonitor(message);
+	else
+		BHandler::MessageReceived(message);
+}
+
+
+void
+ProjectWatcher::Rebuild(void)
+{
+	if (fProject == NULL || Looper() == NULL) {
+		Stop();
+		return;
+	}
+
+	std::set<BString> paths;
+	std::set<BString> directories;
+	BString objectFolder;
+	fObjects.clear();
+	{
+		BAutolock lock(fProject);
+
+		for (int32 i = 0; i < fProject->CountGroups(); i++) {
+			SourceGroup* group = fProject->GroupAt(i);
+			for (int32 j = 0; j < group->filelist.CountItems(); j++) {
+				SourceFile* file = group->filelist.ItemAt(j);
+				const char* fullPath = file->GetPath().GetFullPath();
+				if (fullPath == NULL)
+					continue;
+
+				BString path(fullPath);
+				paths.insert(path);
+
+				// Editors often save by writing a new file and moving it
+				// over the old one, which only shows up in the folder
+				if (file->GetPath().GetFolder() != NULL)
+					directories.insert(file->GetPath().GetFolder());
+
+				if (!file->UsesBuild())
+					continue;
+
+				BString objectName(file->GetPath().GetBaseName());
+				objectName << ".o";
+				fObjects.insert(std::make_pair(objectName, path));
+
+				BString dependencies(file->GetDependencies());
+				int32 start = 0;
+				while (start < dependencies.Length()) {
+					int32 end = dependencies.FindFirst('|', start);
+					if (end < 0)
+						end = dependencies.Length();
+
+					BString dependency;
+					dependencies.CopyInto(dependency, start, end - start);
+					if (dependency.Length() > 0) {
+						paths.insert(
+							fProject->MakeDependencyPath(dependency.String()));
+					}
+
+					start = end + 1;
+				}
+			}
+		}
+
+		BuildInfo* info = fProject->GetBuildInfo();
+		for (int32 i = 0; i < info->includeList.CountItems(); i++)
+			directories.insert(info->includeList.ItemAt(i)->Absolute());
+
+		objectFolder = fProject->GetObjectPath().GetFullPath();
+	}
+
+	// Only what was added or removed since the last time is looked up, so
+	// saving the project doesn't go through every file again
+	for (std::map<BString, node_ref>::iterator it = fPaths.begin();
+			it != fPaths.end();) {
+		if (paths.find(it->first) == paths.end()) {
+			StopWatchingFile(it->second);
+			fPaths.erase(it++);
+		} else
+			it++;
+	}
+	for (std::set<BString>::iterator it = paths.begin(); it != paths.end();
+			it++) {
+		if (fPaths.find(*it) == fPaths.end())
+			WatchFile(*it);
+	}
+
+	for (std::map<node_ref, BString>::iterator it = fDirectories.begin();
+			it != fDirectories.end();) {
+		if (directories.erase(it->second) == 0) {
+			if (it->first != fObjectFolder)
+				watch_node(&it->first, B_STOP_WATCHING, this);
+			fDirectories.erase(it++);
+		} else
+			it++;
+	}
+	for (std::set<BString>::iterator it = directories.begin();
+			it != directories.end(); it++) {
+		WatchDirectory(it->String());
+	}
+
+	// It doesn't exist until the first build, so it is looked for until then
+	if (objectFolder != fObjectFolderPath || fObjectFolder == node_ref()) {
+		if (fObjectFolder != node_ref()
+			&& fDirectories.find(fObjectFolder) == fDirectories.end()) {
+			watch_node(&fObjectFolder, B_STOP_WATCHING, this);
+		}
+		fObjectFolder = node_ref();
+		fObjectFolderPath = objectFolder;
+
+		BEntry entry(objectFolder.String());
+		if (entry.GetNodeRef(&fObjectFolder) == B_OK)
+			watch_node(&fObjectFolder, B_WATCH_DIRECTORY, this);
+	}
+
+	STRACE(1, ("Watching %ld files and %ld folders for %s\n",
+		(long)fFiles.size(), (long)fDirectories.size(), fProject->GetName()));
+}
+
+
+void
+ProjectWatcher::Stop(void)
+{
+	stop_watching(this);
+
+	fFiles.clear();
+	fDirectories.clear();
+	fPaths.clear();
+	fObjects.clear();
+	fObjectFolder = node_ref();
+	fObjectFolderPath = "";
+}
+
+
+void
+ProjectWatcher::WatchFile(const BString& path)
+{
+	// The path might have been replaced by a new node
+	node_ref& watched = fPaths[path];
+	StopWatchingFile(watched);
+	watched = node_ref();
+
+	node_ref node;
+	if (BEntry(path.String()).GetNodeRef(&node) != B_OK)
+		return;
+
+	status_t status = watch_node(&node, B_WATCH_STAT, this);
+	if (status != B_OK) {
+		// Most likely the node monitor limit. Whatever isn't watched is
+		// still caught by the checks done before each build.
+		STRACE(1, ("Couldn't watch %s: %s\n", path.String(), strerror(status)));
+		return;
+	}
+
+	watched = node;
+	fFiles[node] = path;
+}
+
+
+void
+ProjectWatcher::StopWatchingFile(const node_ref& node)
+{
+	std::map<node_ref, BString>::iterator it = fFiles.find(node);
+	if (it == fFiles.end())
+		return;
+
+	watch_node(&node, B_STOP_WATCHING, this);
+	fFiles.erase(it);
+}
+
+
+void
+ProjectWatcher::WatchDirectory(const char* path)
+{
+	if (path == NULL)
+		return;
+
+	node_ref node;
+	if (BEntry(path).GetNodeRef(&node) != B_OK
+		|| fDirectories.find(node) != fDirectories.end()) {
+		return;
+	}
+
+	if (watch_node(&node, B_WATCH_DIRECTORY, this) == B_OK)
+		fDirectories[node] = path;
+}
+
+
+void
+ProjectWatcher::HandleNodeMonitor(BMessage* message)
+{
+	int32 opcode;
+	if (message->FindInt32("opcode", &opcode) != B_OK)
+		return;
+
+	node_ref node;
+	const char* name;
+	switch (opcode) {
+		case B_STAT_CHANGED:
+		{
+			int32 fields;
+			if (message->FindInt32("fields", &fields) == B_OK
+				&& (fields & (B_STAT_MODIFICATION_TIME | B_STAT_SIZE)) == 0) {
+				break;
+			}
+
+			if (message->FindInt32("device", &node.device) != B_OK
+				|| message->FindInt64("node", &node.node) != B_OK) {
+				break;
+			}
+
+			std::map<node_ref, BString>::iterator it = fFiles.find(node);
+			if (it != fFiles.end())
+				FileChanged(it->second);
+			break;
+		}
+
+		case B_ENTRY_CREATED:
+		{
+			if (message->FindInt32("device", &node.device) == B_OK
+				&& message->FindInt64("directory", &node.node) == B_OK
+				&& message->FindString("name", &name) == B_OK) {
+				EntryAppeared(node, name);
+			}
+			break;
+		}
+
+		case B_ENTRY_MOVED:
+		{
+			if (message->FindInt32("device", &node.device) == B_OK
+				&& message->FindInt64("to directory", &node.node) == B_OK
+				&& message->FindString("name", &name) == B_OK) {
+				EntryAppeared(node, name);
+			}
+			break;
+		}
+
+		case B_ENTRY_REMOVED:
+		{
+			// Deleting an object file is the usual way to force a rebuild
+			// from outside
+			if (message->FindInt32("device", &node.device) != B_OK
+				|| message->FindInt64("directory", &node.node) != B_OK
+				|| node != fObjectFolder
+				|| message->FindString("name", &name) != B_OK) {
+				break;
+			}
+
+			std::pair<std::multimap<BString, BString>::iterator,
+				std::multimap<BString, BString>::iterator> range
+					= fObjects.equal_range(BString(name));
+			BAutolock lock(fProject);
+			for (std::multimap<BString, BString>::iterator it = range.first;
+					it != range.second; it++) {
+				MarkDirty(fProject->FindFile(it->second.String()));
+			}
+			break;
+		}
+	}
+}
+
+
+void
+ProjectWatcher::EntryAppeared(const node_ref& directory, const char* name)
+{
+	std::map<node_ref, BString>::iterator it = fDirectories.find(directory);
+	if (it == fDirectories.end())
+		return;
+
+	BString path(it->second);
+	path << "/" << name;
+	if (fPaths.find(path) == fPaths.end())
+		return;
+
+	// A file we care about was replaced, so watch the new node instead
+	WatchFile(path);
+	FileChanged(path);
+}
+
+
+void
+ProjectWatcher::FileChanged(const BString& path)
+{
+	STRACE(2, ("%s changed\n", path.String()));
+
+	SearchIndex* index = fProject->GetSearchIndex();
+	if (index != NULL)
+		index->FileChanged(path.String());
+
+	BAutolock lock(fProject);
+
+	// The modification time is cached and would hide the edit from
+	// CheckNeedsBuild otherwise
+	SourceFile* file = fProject->FindFile(path.String());
+	if (file != NULL) {
+		file->UpdateModTime();
+		MarkDirty(file);
+	}
+
+	BObjectList<SourceFile> dependents(20, false);
+	fProject->MakeDependentsDirty(path.String(), dependents);
+	for (int32 i = 0; i < dependents.CountItems(); i++)
+		NeedsBuild(dependents.ItemAt(i));
+}
+
+
+void
+ProjectWatcher::MarkDirty(SourceFile* file)
+{
+	if (file == NULL || !file->UsesBuild())
+		return;
+
+	file->SetBuildFlag(BUILD_YES);
+	fProject->MakeFileDirty(file);
+	NeedsBuild(file);
+}
+
+
+void
+ProjectWatcher::NeedsBuild(SourceFile* file)
+{
+	BMessage message(M_FILE_NEEDS_BUILD);
+	message.AddPointer("file", file);
+	fTarget.SendMessage(&message);
+}
@@ -0,0 +1,67 @@
+#ifndef PROJECT_WATCHER_H
+#define PROJECT_WATCHER_H
+
+
+#include <Handler.h>
+#include <Messenger.h>
+#include <Node.h>
+#include <String.h>
+
+#include <map>
+#include <set>
+
+
+class Project;
+class SourceFile;
+
+// Watches a project's source files, the headers they depend on, the include
+// folders and the object folder with the node monitor. When a source or one
+// of its headers changes, or its object file goes away, the source is marked
+// as needing a build right away and the target is sent M_FILE_NEEDS_BUILD,
+// instead of waiting for the next build to find out by statting everything.
+class ProjectWatcher : public BHandler {
+public:
+								ProjectWatcher(Project* project,
+									BMessenger target);
+	virtual						~ProjectWatcher(void);
+
+	virtual	void				MessageReceived(BMessage* message);
+
+			// Catches up with the project's current files and dependencies
+			void				Rebuild(void);
+			void				Stop(void);
+
+private:
+			void				WatchFile(const BString& path);
+			void				StopWatchingFile(const node_ref& node);
+			void				WatchDirectory(const char* path);
+
+			void				HandleNodeMonitor(BMessage* message);
+			void				EntryAppeared(const node_ref& directory,
+									const char* name);
+			void				FileChanged(const BString& path);
+			void				MarkDirty(SourceFile* file);
+			void				NeedsBuild(SourceFile* file);
+
+			Project*			fProject;
+			BMessenger			fTarget;
+
+			// Watched files and folders by node, so events can be turned
+			// back into paths
+			std::map<node_ref, BString>	fFiles;
+			std::map<node_ref, BString>	fDirectories;
+			node_ref			fObjectFolder;
+			BString				fObjectFolderPath;
+
+			// The sources and headers being watched with their nodes, which
+			// are unset for those which couldn't be watched, and the sources
+			// by object file name. Which sources a header affects comes from
+			// the project's dependency graph. Paths are kept instead of
+			// SourceFile pointers so files removed from the project can't be
+			// left dangling.
+			std::map<BString, node_ref>	fPaths;
+			std::multimap<BString, BString>	fObjects;
+};
+
+
+#endif	// PROJECT_WATCHER_H
@@ -28,6 +28,7 @@
 #include <LayoutBuilder.h>
 #include <Locale.h>
 #include <MenuItem.h>
+#include <MessageRunner.h>
 #include <Node.h>
 #include <OS.h>
 #include <Roster.h>
@@ -67,6 +68,7 @@
 #include "ProjectSettingsWindow.h"
 #include "Project.h"
 #include "ProjectStatus.h"
+#include "ProjectWatcher.h"
 #include "RunArgsWindow.h"
 #include "SCMManager.h"
 #include "SCMOutputWindow.h"
@@ -110,11 +112,18 @@ enum {
 	M_TOGGLE_DEBUG_MENU			= 'sdbm',
 	M_DEBUG_DUMP_DEPENDENCIES	= 'dbdd',
 	M_DEBUG_DUMP_INCLUDES		= 'dbdi',
+	M_DEBUG_DUMP_REBUILD_IMPACT	= 'dbri',
+	M_DEBUG_DUMP_UNUSED_INCLUDES	= 'dbui',
 	
+	M_SAVE_PROJECT				= 'svpj',
 	M_SET_STATUS				= 'stat'
 };
 
 
+// How long the project waits for things to settle before saving
+static const bigtime_t kSaveDelay = 500000;
+
+
 static int
 compare_source_file_items(const BListItem* item1, const BListItem* item2);
 
@@ -131,7 +140,9 @@ ProjectWindow::ProjectWindow(BRect frame, Project* project)
 	fShowingLibs(false),
 	fMenusLocked(false),
 	fBuilder(BMessenger(this)),
-	fPrefsWindow(NULL)
+	fPrefsWindow(NULL),
+	fSaveRunner(NULL),
+	fWatcher(NULL)
 {
 	SetSizeLimits(200, 30000, 200, 30000);
 	MoveTo(100,100);
@@ -203,6 +214,9 @@ ProjectWindow::ProjectWindow(BRect frame, Project* project)
 		title << fProject->GetName();
 		SetTitle(title.String());
 
+		fWatcher = new ProjectWatcher(fProject, BMessenger(this));
+		AddHandler(fWatcher);
+
 		UpdateProjectList();
 	}
 	
@@ -274,6 +288,13 @@ ProjectWindow::~ProjectWindow()
 	BNode node(fProject->GetPath().GetFullPath());
 	BRect frame(Frame());
 	node.WriteAttr("project_frame", B_RECT_TYPE, 0, &frame, sizeof(BRect));
+
+	delete fSaveRunner;
+
+	if (fWatcher != NULL) {
+		RemoveHandler(fWatcher);
+		delete fWatcher;
+	}
 }
 
 void
@@ -291,23 +312,6 @@ ProjectWindow::UpdateProjectList(void) {
 				SourceFileItem* fileitem = new SourceFileItem(file,1);
 
 				fProjectList->AddItem(fileitem);
-
-				BString abspath = file->GetPath().GetFullPath();
-				if (abspath[0] != '/') {
-					abspath.Prepend("/");
-					abspath.Prepend(fProject->GetPath().GetFolder());
-				}
-				BEntry entry(abspath.String());
-				if (entry.Exists()) {
-					if (fProject->CheckNeedsBuild(file,false)) {
-						fileitem->SetDisplayState(SFITEM_NEEDS_BUILD);
-						fProjectList->InvalidateItem(fProjectList->IndexOf(fileitem));
-					} else
-						file->SetBuildFlag(BUILD_NO);
-				} else {
-					fileitem->SetDisplayState(SFITEM_MISSING);
-					fProjectList->InvalidateItem(fProjectList->IndexOf(fileitem));
-				}
 			}
 
 			// Now add header files
@@ -357,6 +361,15 @@ ProjectWindow::UpdateProjectList(void) {
 				}
 			}
 		}
+
+	// Missing files and ones needing a build are marked as the scan finds them
+	fProjectList->ScanFiles();
+
+	// Dependencies may have changed, so the headers to watch have too
+	if (fWatcher != NULL)
+		fWatcher->Rebuild();
+
+	fProject->UpdateSearchIndex();
 }
 
 void
@@ -382,6 +395,9 @@ ProjectWindow::QuitRequested()
 		}
 	}
 
+	// Don't leave a pending save behind
+	delete fSaveRunner;
+	fSaveRunner = NULL;
 	fProject->Save();
 
 	if (fErrorWindow != NULL) {
@@ -417,6 +433,19 @@ ProjectWindow::MessageReceived(BMessage* message)
 	}
 
 	switch (message->what) {
+		case M_SAVE_PROJECT:
+		{
+			delete fSaveRunner;
+			fSaveRunner = NULL;
+			fProject->Save();
+
+			// Whatever was edited may have added or removed files too
+			if (fWatcher != NULL)
+				fWatcher->Rebuild();
+			fProject->UpdateSearchIndex();
+			break;
+		}
+
 		case M_IMPORT_REFS:
 		{
 			fImportStruct.refMessage = *message;
@@ -752,7 +781,7 @@ ProjectWindow::MessageReceived(BMessage* message)
 			groupItem->SetText(newName.String());
 			fProjectList->InvalidateItem(fProjectList->IndexOf(groupItem));
 
-			fProject->Save();
+			ScheduleSave();
 			break;
 		}
 
@@ -760,7 +789,7 @@ ProjectWindow::MessageReceived(BMessage* message)
 		{
 			int32 selection = fProjectList->FullListCurrentSelection();
 			SortGroup(selection);
-			fProject->Save();
+			ScheduleSave();
 
 			break;
 		}
@@ -1001,7 +1030,7 @@ ProjectWindow::MessageReceived(BMessage* message)
 			// Leaving here for documentation
 			// CullEmptyGroups();
 			if (save)
-				fProject->Save();
+				ScheduleSave();
 
 			break;
 		}
@@ -1191,9 +1220,11 @@ ProjectWindow::MessageReceived(BMessage* message)
 			}
 			SetStatus(B_TRANSLATE("Build had errors or warnings."));
 
-			// Should this be an Unflatten or an Append?
-			ErrorList* errorList = fProject->GetErrorList();
-			errorList->Unflatten(*message);
+			// Each message holds one file's diagnostics, so merge them into
+			// what the build has reported so far
+			ErrorList fileErrors;
+			fileErrors.Unflatten(*message);
+			fProject->GetErrorList()->Merge(fileErrors);
 			fErrorWindow->PostMessage(message);
 			break;
 		}
@@ -1212,6 +1243,26 @@ ProjectWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case M_ADD_ERROR_LIBRARY:
+		{
+			BString path;
+			if (message->FindString("path", &path) != B_OK)
+				break;
+
+			if (fProject->HasLibrary(path.String())) {
+				SetStatus(B_TRANSLATE("The library is already in the project."));
+				break;
+			}
+
+			fProject->AddLibrary(path.String());
+			ScheduleSave();
+
+			BString status = B_TRANSLATE("Added %library% to the project.");
+			status.ReplaceFirst("%library%", DPath(path).GetFileName());
+			SetStatus(status.String());
+			break;
+		}
+
 		case M_SYNC_MODULES:
 		{
 #ifdef BUILD_CODE_LIBRARY
@@ -1240,6 +1291,18 @@ ProjectWindow::MessageReceived(BMessage* message)
 			DumpIncludes(fProject);
 			break;
 		}
+
+		case M_DEBUG_DUMP_REBUILD_IMPACT:
+		{
+			DumpRebuildImpact(fProject);
+			break;
+		}
+
+		case M_DEBUG_DUMP_UNUSED_INCLUDES:
+		{
+			DumpUnusedIncludes(fProject);
+			break;
+		}
 		
 		case M_SET_STATUS:
 		{
@@ -1375,7 +1438,7 @@ ProjectWindow::AddFile(const entry_ref& ref, BPoint* where)
 			}
 		}
 	}
-	fProject->Save();
+	ScheduleSave();
 
 	if (file->UsesBuild())
 		item->SetDisplayState(SFITEM_NEEDS_BUILD);
@@ -1766,7 +1829,7 @@ ProjectWindow::MakeGroup(int32 selection)
 	}
 
 	fProjectList->Expand(newGroupItem);
-	fProject->Save();
+	ScheduleSave();
 }
 
 
@@ -1814,6 +1877,17 @@ ProjectWindow::ShowErrorWindow(ErrorList* list)
 }
 
 
+void
+ProjectWindow::ScheduleSave(void)
+{
+	// Adding a folder of files or dragging groups around asks for a save after
+	// every step. Restarting the timer each time turns the burst into one save.
+	BMessage message(M_SAVE_PROJECT);
+	delete fSaveRunner;
+	fSaveRunner = new BMessageRunner(BMessenger(this), &message, kSaveDelay, 1);
+}
+
+
 void
 ProjectWindow::CullEmptyGroups(void)
 {
@@ -1827,7 +1901,7 @@ ProjectWindow::CullEmptyGroups(void)
 		}
 	}
 
-	fProject->Save();
+	ScheduleSave();
 }
 
 
@@ -1849,6 +1923,7 @@ ProjectWindow::UpdateDependencies(void)
 		if (item != NULL)
 			item->GetData()->UpdateDependencies(*fProject->GetBuildInfo());
 	}
+	fProject->UpdateDependencyGraph();
 	SetMenuLock(false);
 
 	if (toggleHack)
@@ -1870,6 +1945,10 @@ ProjectWindow::ToggleDebugMenu(void)
 			new BMessage(M_DEBUG_DUMP_DEPENDENCIES)));
 		debug->AddItem(new BMenuItem("Dump includes",
 			new BMessage(M_DEBUG_DUMP_INCLUDES)));
+		debug->AddItem(new BMenuItem("Dump rebuild impact",
+			new BMessage(M_DEBUG_DUMP_REBUILD_IMPACT)));
+		debug->AddItem(new BMenuItem("Dump unused includes",
+			new BMessage(M_DEBUG_DUMP_UNUSED_INCLUDES)));
 		fMenuBar->AddItem(debug);
 	}
 }
@@ -1881,7 +1960,7 @@ ProjectWindow::DoBuild(int32 postbuild)
 	if (fErrorWindow != NULL)
 		fErrorWindow->PostMessage(M_CLEAR_ERROR_LIST);
 
-	fProject->GetErrorList()->msglist.MakeEmpty();
+	fProject->GetErrorList()->MakeEmpty();
 
 	// Missing file check
 	for (int32 i = 0; i < fProjectList->CountItems(); i++) {
@@ -1973,7 +2052,7 @@ ProjectWindow::AddFileThread(void* data)
 
 	addFileStruct->parent->Lock();
 	//addFileStruct->parent->CullEmptyGroups(); // may create groups first, then populate
-	addFileStruct->parent->fProject->Save();
+	addFileStruct->parent->ScheduleSave();
 	addFileStruct->parent->Unlock();
 
 	return 0;
@@ -2104,7 +2183,7 @@ ProjectWindow::ImportFileThread(void* data)
 
 	addFileStruct->parent->Lock();
 	addFileStruct->parent->CullEmptyGroups();
-	addFileStruct->parent->fProject->Save();
+	addFileStruct->parent->ScheduleSave();
 	addFileStruct->parent->Unlock();
 
 	return 0;
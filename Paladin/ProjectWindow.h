@@ -23,11 +23,13 @@
 #include "ProjectStatus.h"
 #include "ProjectSettingsWindow.h"
 
+class BMessageRunner;
 class ErrorWindow;
 class ProjectList;
 class Project;
 class ProjectWindow;
 class ProjectStatus;
+class ProjectWatcher;
 class SourceControl;
 class SourceFile;
 class PrefsWindow;
@@ -62,6 +64,7 @@ private:
 			void				MakeGroup(int32 selection);
 			void				ToggleErrorWindow(ErrorList* list);
 			void				ShowErrorWindow(ErrorList* list);
+			void				ScheduleSave(void);
 			void				CullEmptyGroups(void);
 			void				SortGroup(int32 selection);
 			void				UpdateProjectList(void);
@@ -105,6 +108,8 @@ private:
 			int32				fBuildingFile;
 			
 			PrefsWindow*		fPrefsWindow;
+			BMessageRunner*		fSaveRunner;
+			ProjectWatcher*		fWatcher;
 };
 
 
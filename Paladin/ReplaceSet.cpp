@@ -0,0 +1,429 @@
+#include "ReplaceSet.h"
+
+#include <Catalog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <Locale.h>
+#include <Node.h>
+#include <OS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "DebugTools.h"
+#include "DPath.h"
+#include "FileSearcher.h"
+#include "Globals.h"
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "ReplaceSet"
+
+enum
+{
+	JOB_READ = 0,
+	JOB_WRITE_NEW,
+	JOB_WRITE_OLD
+};
+
+// What a file that no longer holds what a job expects is reported with
+static const status_t kFileChanged = B_BUSY;
+
+
+static status_t
+ReadFile(const char *path, std::string &data, mode_t *mode)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+	{
+		close(fd);
+		return B_BAD_VALUE;
+	}
+
+	if (mode != NULL)
+		*mode = fileStat.st_mode & 07777;
+
+	data.resize(fileStat.st_size);
+	size_t done = 0;
+	while (done < data.size())
+	{
+		ssize_t bytes = read(fd, &data[done], data.size() - done);
+		if (bytes <= 0)
+		{
+			status_t status = bytes < 0 ? errno : B_IO_ERROR;
+			close(fd);
+			return status;
+		}
+		done += bytes;
+	}
+
+	close(fd);
+	return B_OK;
+}
+
+
+// A new file made to replace an old one has to carry over the type and
+// whatever else editors keep in attributes
+static void
+CopyAttributes(const char *from, const char *to)
+{
+	BNode source(from);
+	BNode target(to);
+	if (source.InitCheck() != B_OK || target.InitCheck() != B_OK)
+		return;
+
+	char name[B_ATTR_NAME_LENGTH];
+	std::vector<char> buffer;
+	while (source.GetNextAttrName(name) == B_OK)
+	{
+		attr_info info;
+		if (source.GetAttrInfo(name, &info) != B_OK)
+			continue;
+
+		buffer.resize(info.size + 1);
+		ssize_t size = source.ReadAttr(name, info.type, 0, &buffer[0],
+										info.size);
+		if (size >= 0)
+			target.WriteAttr(name, info.type, 0, &buffer[0], size);
+	}
+}
+
+
+static BString
+ErrorText(status_t status)
+{
+	if (status == kFileChanged)
+		return BString(B_TRANSLATE("changed since it was searched"));
+	return BString(strerror(status));
+}
+
+
+ReplaceSet::ReplaceSet(void)
+	:	fApplied(false),
+		fSearcher(NULL),
+		fJob(JOB_READ),
+		fNextEdit(0),
+		fCancel(NULL)
+{
+}
+
+
+ReplaceSet::~ReplaceSet(void)
+{
+	for (size_t i = 0; i < fEdits.size(); i++)
+		delete fEdits[i];
+}
+
+
+status_t
+ReplaceSet::Build(const FileSearcher &searcher, const char *replacement,
+				const std::vector<BString> &files, int32 *cancel)
+{
+	if (searcher.InitCheck() != B_OK)
+		return searcher.InitCheck();
+
+	for (size_t i = 0; i < fEdits.size(); i++)
+		delete fEdits[i];
+	fEdits.clear();
+	fApplied = false;
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		file_edit *edit = new file_edit;
+		edit->path = files[i];
+		edit->count = 0;
+		edit->mode = 0644;
+		edit->status = B_OK;
+		fEdits.push_back(edit);
+	}
+
+	bigtime_t startTime = system_time();
+
+	fSearcher = &searcher;
+	fReplacement = replacement;
+	fCancel = cancel;
+	RunJob(JOB_READ);
+	fCancel = NULL;
+
+	if (cancel != NULL && atomic_get(cancel) != 0)
+		return B_CANCELED;
+
+	// Files which didn't match after all are none of our business
+	std::vector<file_edit*> edits;
+	for (size_t i = 0; i < fEdits.size(); i++)
+	{
+		if (fEdits[i]->status == B_OK && fEdits[i]->count > 0)
+			edits.push_back(fEdits[i]);
+		else
+			delete fEdits[i];
+	}
+	fEdits.swap(edits);
+
+	STRACE(1,("Worked out %ld replacements in %ld of %ld files in %lld us\n",
+			(long)CountReplacements(), (long)fEdits.size(), (long)files.size(),
+			system_time() - startTime));
+
+	return B_OK;
+}
+
+
+status_t
+ReplaceSet::Apply(BString &errors)
+{
+	if (fApplied)
+		return B_NOT_ALLOWED;
+
+	status_t status = Commit(JOB_WRITE_NEW, errors);
+	if (status == B_OK)
+		fApplied = true;
+	return status;
+}
+
+
+status_t
+ReplaceSet::Revert(BString &errors)
+{
+	if (!fApplied)
+		return B_NOT_ALLOWED;
+
+	status_t status = Commit(JOB_WRITE_OLD, errors);
+	if (status == B_OK)
+		fApplied = false;
+	return status;
+}
+
+
+int32
+ReplaceSet::CountReplacements(void) const
+{
+	int32 count = 0;
+	for (size_t i = 0; i < fEdits.size(); i++)
+		count += fEdits[i]->count;
+	return count;
+}
+
+
+const BString &
+ReplaceSet::PathAt(int32 index) const
+{
+	return fEdits[index]->path;
+}
+
+
+int32
+ReplaceSet::ReplacementsAt(int32 index) const
+{
+	return fEdits[index]->count;
+}
+
+
+int32
+ReplaceSet::WorkerThread(void *data)
+{
+	ReplaceSet *set = static_cast<ReplaceSet*>(data);
+
+	int32 editCount = set->fEdits.size();
+	while (set->fCancel == NULL || atomic_get(set->fCancel) == 0)
+	{
+		int32 index = atomic_add(&set->fNextEdit, 1);
+		if (index >= editCount)
+			break;
+
+		file_edit &edit = *set->fEdits[index];
+		switch (set->fJob)
+		{
+			case JOB_READ:
+				edit.status = set->ReadEdit(edit);
+				break;
+			case JOB_WRITE_NEW:
+				edit.status = set->WriteTemp(edit, &edit.oldData, edit.newData);
+				break;
+			case JOB_WRITE_OLD:
+				edit.status = set->WriteTemp(edit, &edit.newData, edit.oldData);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return 0;
+}
+
+
+void
+ReplaceSet::RunJob(int32 job)
+{
+	fJob = job;
+	fNextEdit = 0;
+
+	int32 threadCount = std::max(1, std::min((int)gCPUCount, (int)fEdits.size()));
+	std::vector<thread_id> threads;
+	for (int32 i = 0; i < threadCount; i++)
+	{
+		thread_id thread = spawn_thread(WorkerThread, "replace worker",
+										B_NORMAL_PRIORITY, this);
+		if (thread < 0)
+			break;
+
+		threads.push_back(thread);
+		resume_thread(thread);
+	}
+
+	if (threads.empty())
+		WorkerThread(this);
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+}
+
+
+status_t
+ReplaceSet::Commit(int32 job, BString &errors)
+{
+	RunJob(job);
+
+	status_t status = B_OK;
+	for (size_t i = 0; i < fEdits.size(); i++)
+	{
+		if (fEdits[i]->status != B_OK)
+		{
+			if (status == B_OK)
+				status = fEdits[i]->status;
+			errors << "\t" << fEdits[i]->path << ": "
+				<< ErrorText(fEdits[i]->status) << "\n";
+		}
+	}
+
+	// Everything is in place, so only the renames can still go wrong
+	size_t renamed = 0;
+	for (; status == B_OK && renamed < fEdits.size(); renamed++)
+	{
+		file_edit &edit = *fEdits[renamed];
+		if (rename(edit.tempPath.String(), edit.path.String()) != 0)
+		{
+			status = errno;
+			errors << "\t" << edit.path << ": " << ErrorText(status) << "\n";
+			break;
+		}
+		edit.tempPath = "";
+	}
+
+	if (status == B_OK)
+		return B_OK;
+
+	for (size_t i = 0; i < fEdits.size(); i++)
+	{
+		file_edit &edit = *fEdits[i];
+		if (edit.tempPath.Length() > 0)
+		{
+			unlink(edit.tempPath.String());
+			edit.tempPath = "";
+		}
+
+		if (i >= renamed)
+			continue;
+
+		// Put back what this file held before
+		const std::string &data = job == JOB_WRITE_NEW ? edit.oldData
+														: edit.newData;
+		if (WriteTemp(edit, NULL, data) != B_OK
+			|| rename(edit.tempPath.String(), edit.path.String()) != 0)
+		{
+			errors << "\t" << edit.path << ": "
+				<< B_TRANSLATE("couldn't be put back") << "\n";
+			if (edit.tempPath.Length() > 0)
+				unlink(edit.tempPath.String());
+		}
+		edit.tempPath = "";
+	}
+
+	return status;
+}
+
+
+status_t
+ReplaceSet::ReadEdit(file_edit &edit)
+{
+	status_t status = ReadFile(edit.path.String(), edit.oldData, &edit.mode);
+	if (status != B_OK)
+		return status;
+
+	edit.count = fSearcher->ReplaceMatches(edit.oldData.data(),
+				edit.oldData.size(), fReplacement.String(), edit.newData);
+
+	// Nothing to change means nothing to keep
+	if (edit.count == 0)
+	{
+		std::string().swap(edit.oldData);
+		std::string().swap(edit.newData);
+	}
+	return B_OK;
+}
+
+
+status_t
+ReplaceSet::WriteTemp(file_edit &edit, const std::string *expected,
+					const std::string &data)
+{
+	edit.tempPath = "";
+
+	// Someone might have edited the file since, and their changes win
+	if (expected != NULL)
+	{
+		std::string current;
+		status_t status = ReadFile(edit.path.String(), current, NULL);
+		if (status != B_OK)
+			return status;
+		if (current != *expected)
+			return kFileChanged;
+	}
+
+	// Made in the same folder, so that renaming it over the file is atomic
+	DPath path(edit.path);
+	BString tempPath(path.GetFolder());
+	tempPath << "/." << path.GetFileName() << ".XXXXXX";
+
+	char *buffer = tempPath.LockBuffer(0);
+	int fd = mkstemp(buffer);
+	tempPath.UnlockBuffer();
+	if (fd < 0)
+		return errno;
+
+	status_t status = B_OK;
+	size_t done = 0;
+	while (done < data.size())
+	{
+		ssize_t bytes = write(fd, data.data() + done, data.size() - done);
+		if (bytes < 0)
+		{
+			status = errno;
+			break;
+		}
+		done += bytes;
+	}
+
+	if (status == B_OK && fchmod(fd, edit.mode) != 0)
+		status = errno;
+	if (close(fd) != 0 && status == B_OK)
+		status = errno;
+
+	if (status != B_OK)
+	{
+		unlink(tempPath.String());
+		return status;
+	}
+
+	CopyAttributes(edit.path.String(), tempPath.String());
+	edit.tempPath = tempPath;
+	return B_OK;
+}
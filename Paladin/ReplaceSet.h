@@ -0,0 +1,76 @@
+#ifndef REPLACESET_H
+#define REPLACESET_H
+
+#include <String.h>
+
+#include <string>
+#include <vector>
+
+class FileSearcher;
+
+// The changes a replace makes to a set of files. They are worked out in full
+// before anything is written, so they can be previewed, and kept afterwards,
+// so they can be undone. Files are read and written by a pool of threads.
+// Writing is all or nothing: each file's new contents go into a temporary
+// file next to it, which is renamed over the file only once every file has
+// been written, and the files renamed already are put back if a later rename
+// fails.
+class ReplaceSet
+{
+public:
+							ReplaceSet(void);
+							~ReplaceSet(void);
+
+			// Works out the new contents of the files with every match of the
+			// searcher replaced. Files without matches are left out.
+			status_t		Build(const FileSearcher &searcher,
+								const char *replacement,
+								const std::vector<BString> &files,
+								int32 *cancel);
+
+			// Writes the new contents. Nothing is written if any of the files
+			// can't be or has been changed since Build().
+			status_t		Apply(BString &errors);
+
+			// Puts back the old contents, on the same terms as Apply()
+			status_t		Revert(BString &errors);
+
+			bool			IsApplied(void) const { return fApplied; }
+			int32			CountFiles(void) const { return fEdits.size(); }
+			int32			CountReplacements(void) const;
+			const BString &	PathAt(int32 index) const;
+			int32			ReplacementsAt(int32 index) const;
+
+private:
+	struct file_edit
+	{
+		BString			path;
+		std::string		oldData;
+		std::string		newData;
+		int32			count;
+		mode_t			mode;
+		BString			tempPath;
+		status_t		status;
+	};
+
+	static	int32			WorkerThread(void *data);
+			void			RunJob(int32 job);
+			status_t		Commit(int32 job, BString &errors);
+
+			status_t		ReadEdit(file_edit &edit);
+			status_t		WriteTemp(file_edit &edit,
+									const std::string *expected,
+									const std::string &data);
+
+			std::vector<file_edit*>	fEdits;
+			bool			fApplied;
+
+			// What the worker threads work on
+			const FileSearcher *	fSearcher;
+			BString			fReplacement;
+			int32			fJob;
+			int32			fNextEdit;
+			int32 *			fCancel;
+};
+
+#endif
@@ -0,0 +1,646 @@
+#include "SearchIndex.h"
+
+#include <Autolock.h>
+#include <File.h>
+#include <MessageQueue.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+#include "DebugTools.h"
+#include "DPath.h"
+
+
+enum {
+	M_SET_INDEX_FILES	= 'sifl',
+	M_INDEX_FILE		= 'sifc'
+};
+
+static const char kIndexMagic[8] = { 'P', 'L', 'D', 'T', 'R', 'I', 'G', '1' };
+
+// Like FileSearcher, only the start of a file is checked for NUL bytes
+static const size_t kBinaryCheckSize = 4096;
+
+// One bit for every possible trigram
+static const size_t kSeenSize = (1 << 24) / 8;
+
+
+static inline uint8
+Fold(uint8 c)
+{
+	return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+
+template<typename T>
+static void
+Append(std::vector<uint8>& buffer, T value)
+{
+	const uint8* bytes = (const uint8*)&value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+
+template<typename T>
+static bool
+Take(const uint8*& data, const uint8* end, T& value)
+{
+	if ((size_t)(end - data) < sizeof(T))
+		return false;
+
+	memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+
+SearchIndex::SearchIndex(const char* indexPath)
+	:
+	BLooper("search index", B_LOW_PRIORITY),
+	fIndexPath(indexPath),
+	fLoaded(false),
+	fDirty(false),
+	fCancelled(0),
+	fDataLock("search index data")
+{
+}
+
+
+SearchIndex::~SearchIndex(void)
+{
+	for (size_t i = 0; i < fEntries.size(); i++)
+		delete fEntries[i];
+}
+
+
+void
+SearchIndex::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_SET_INDEX_FILES:
+		{
+			// A newer list makes this one moot
+			if (MessageQueue()->FindMessage(M_SET_INDEX_FILES, 0) == NULL)
+				UpdateFiles(message);
+			break;
+		}
+
+		case M_INDEX_FILE:
+		{
+			// Files the index doesn't know yet wait for the next SetFiles(),
+			// which decides what belongs in it
+			BString path;
+			if (message->FindString("path", &path) != B_OK)
+				break;
+
+			fDataLock.Lock();
+			bool known = fIDs.find(path) != fIDs.end();
+			fDataLock.Unlock();
+
+			if (known)
+				IndexFile(path);
+			break;
+		}
+
+		default:
+			BLooper::MessageReceived(message);
+	}
+}
+
+
+bool
+SearchIndex::QuitRequested(void)
+{
+	if (fDirty)
+		Save();
+	return true;
+}
+
+
+void
+SearchIndex::SetFiles(const std::vector<BString>& files)
+{
+	BMessage message(M_SET_INDEX_FILES);
+	for (size_t i = 0; i < files.size(); i++)
+		message.AddString("file", files[i]);
+	PostMessage(&message);
+}
+
+
+void
+SearchIndex::FileChanged(const char* path)
+{
+	// Don't let searches trust what the index says about the old contents
+	// while the new ones wait their turn
+	MarkStale(path);
+
+	BMessage message(M_INDEX_FILE);
+	message.AddString("path", path);
+	PostMessage(&message);
+}
+
+
+void
+SearchIndex::Shutdown(void)
+{
+	atomic_set(&fCancelled, 1);
+
+	thread_id thread = Thread();
+	PostMessage(B_QUIT_REQUESTED);
+
+	status_t result;
+	wait_for_thread(thread, &result);
+}
+
+
+bool
+SearchIndex::Narrow(const char* literal, const std::vector<BString>& files,
+	std::vector<BString>& candidates)
+{
+	size_t length = strlen(literal);
+	if (length < 3)
+		return false;
+
+	std::vector<uint32> trigrams;
+	for (size_t i = 2; i < length; i++) {
+		trigrams.push_back((Fold(literal[i - 2]) << 16)
+			| (Fold(literal[i - 1]) << 8) | Fold(literal[i]));
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+		trigrams.end());
+
+	bigtime_t startTime = system_time();
+
+	// What the index knows about each of the files it rules out
+	struct excluded_file {
+		bool			excluded;
+		time_t			modified;
+		off_t			size;
+	};
+	std::vector<excluded_file> excluded(files.size());
+
+	BAutolock lock(fDataLock);
+
+	// Intersect the shortest lists first, so there is less to go through
+	std::vector<const std::vector<int32>*> lists;
+	for (size_t i = 0; i < trigrams.size(); i++) {
+		std::map<uint32, std::vector<int32> >::const_iterator postings
+			= fPostings.find(trigrams[i]);
+		if (postings == fPostings.end()) {
+			lists.clear();
+			break;
+		}
+		lists.push_back(&postings->second);
+	}
+
+	std::vector<int32> matches;
+	if (!lists.empty()) {
+		std::sort(lists.begin(), lists.end(), SmallerList);
+		matches = *lists[0];
+		for (size_t i = 1; i < lists.size() && !matches.empty(); i++) {
+			std::vector<int32> common;
+			std::set_intersection(matches.begin(), matches.end(),
+				lists[i]->begin(), lists[i]->end(), std::back_inserter(common));
+			matches.swap(common);
+		}
+	}
+
+	for (size_t i = 0; i < files.size(); i++) {
+		std::map<BString, int32>::const_iterator id = fIDs.find(files[i]);
+		excluded[i].excluded = id != fIDs.end()
+			&& !fEntries[id->second]->stale
+			&& !std::binary_search(matches.begin(), matches.end(), id->second);
+		if (excluded[i].excluded) {
+			excluded[i].modified = fEntries[id->second]->modified;
+			excluded[i].size = fEntries[id->second]->size;
+		}
+	}
+
+	lock.Unlock();
+
+	// Not every file searched is watched, so one could have changed without
+	// the index hearing about it. Those are searched and indexed again.
+	for (size_t i = 0; i < files.size(); i++) {
+		if (excluded[i].excluded) {
+			struct stat fileStat;
+			if (stat(files[i].String(), &fileStat) != 0
+				|| (fileStat.st_mtime == excluded[i].modified
+					&& fileStat.st_size == excluded[i].size)) {
+				continue;
+			}
+			FileChanged(files[i].String());
+		}
+		candidates.push_back(files[i]);
+	}
+
+	STRACE(1, ("Search index narrowed %ld files to %ld for \"%s\" in %lld us\n",
+		(long)files.size(), (long)candidates.size(), literal,
+		system_time() - startTime));
+	return true;
+}
+
+
+bool
+SearchIndex::SmallerList(const std::vector<int32>* a,
+	const std::vector<int32>* b)
+{
+	return a->size() < b->size();
+}
+
+
+void
+SearchIndex::UpdateFiles(BMessage* message)
+{
+	bigtime_t startTime = system_time();
+
+	if (!fLoaded) {
+		Load();
+		fLoaded = true;
+	}
+
+	std::set<BString> wanted;
+	BString path;
+	for (int32 i = 0; message->FindString("file", i, &path) == B_OK; i++)
+		wanted.insert(path);
+
+	// Stat before locking, so searches aren't held up by it
+	std::map<BString, struct stat> stats;
+	for (std::set<BString>::iterator i = wanted.begin(); i != wanted.end(); i++) {
+		struct stat fileStat;
+		if (stat(i->String(), &fileStat) == 0)
+			stats[*i] = fileStat;
+	}
+
+	std::vector<BString> changed;
+	{
+		BAutolock lock(fDataLock);
+
+		std::vector<int32> removed;
+		for (std::map<BString, int32>::iterator i = fIDs.begin();
+				i != fIDs.end(); i++) {
+			if (wanted.find(i->first) == wanted.end())
+				removed.push_back(i->second);
+		}
+		for (size_t i = 0; i < removed.size(); i++)
+			RemoveEntry(removed[i]);
+		if (!removed.empty())
+			fDirty = true;
+
+		for (std::map<BString, struct stat>::iterator i = stats.begin();
+				i != stats.end(); i++) {
+			std::map<BString, int32>::iterator id = fIDs.find(i->first);
+			if (id != fIDs.end()) {
+				file_entry* entry = fEntries[id->second];
+				if ((!entry->stale || entry->unchecked)
+					&& entry->modified == i->second.st_mtime
+					&& entry->size == i->second.st_size) {
+					entry->stale = false;
+					entry->unchecked = false;
+					continue;
+				}
+				entry->stale = true;
+				entry->unchecked = false;
+			}
+			changed.push_back(i->first);
+		}
+	}
+
+	for (size_t i = 0; i < changed.size(); i++) {
+		if (atomic_get(&fCancelled) != 0)
+			return;
+		IndexFile(changed[i]);
+	}
+
+	STRACE(1, ("Search index %s: %ld files, %ld reindexed in %lld us\n",
+		fIndexPath.String(), (long)wanted.size(), (long)changed.size(),
+		system_time() - startTime));
+
+	if (fDirty)
+		Save();
+}
+
+
+void
+SearchIndex::IndexFile(const BString& path)
+{
+	file_entry* entry = new file_entry;
+	entry->path = path;
+	entry->stale = false;
+	entry->unchecked = false;
+	bool readable = ReadTrigrams(path, *entry);
+
+	BAutolock lock(fDataLock);
+
+	std::map<BString, int32>::iterator old = fIDs.find(path);
+	if (old != fIDs.end())
+		RemoveEntry(old->second);
+	fDirty = true;
+
+	// Files which went away are simply forgotten
+	if (!readable) {
+		delete entry;
+		return;
+	}
+
+	int32 id;
+	if (!fFreeIDs.empty()) {
+		id = fFreeIDs.back();
+		fFreeIDs.pop_back();
+		fEntries[id] = entry;
+	} else {
+		id = fEntries.size();
+		fEntries.push_back(entry);
+	}
+
+	fIDs[path] = id;
+	AddEntry(id);
+}
+
+
+bool
+SearchIndex::ReadTrigrams(const BString& path, file_entry& entry)
+{
+	int fd = open(path.String(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+		close(fd);
+		return false;
+	}
+
+	entry.modified = fileStat.st_mtime;
+	entry.size = fileStat.st_size;
+	if (fileStat.st_size == 0) {
+		close(fd);
+		return true;
+	}
+
+	size_t length = fileStat.st_size;
+	uint8* data = (uint8*)mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	bool mapped = data != MAP_FAILED;
+	if (!mapped) {
+		data = (uint8*)malloc(length);
+		if (data == NULL || read(fd, data, length) != (ssize_t)length) {
+			free(data);
+			close(fd);
+			return false;
+		}
+	}
+	close(fd);
+
+	// Binary files get no trigrams, since searches skip them anyway
+	if (memchr(data, '\0', std::min(length, kBinaryCheckSize)) == NULL) {
+		if (fSeen.empty())
+			fSeen.resize(kSeenSize, 0);
+
+		uint32 trigram = 0;
+		for (size_t i = 0; i < length; i++) {
+			trigram = ((trigram << 8) | Fold(data[i])) & 0xffffff;
+			if (i < 2)
+				continue;
+
+			uint8& bits = fSeen[trigram >> 3];
+			uint8 bit = 1 << (trigram & 7);
+			if ((bits & bit) == 0) {
+				bits |= bit;
+				entry.trigrams.push_back(trigram);
+			}
+		}
+
+		for (size_t i = 0; i < entry.trigrams.size(); i++)
+			fSeen[entry.trigrams[i] >> 3] = 0;
+		std::sort(entry.trigrams.begin(), entry.trigrams.end());
+	}
+
+	if (mapped)
+		munmap(data, length);
+	else
+		free(data);
+
+	return true;
+}
+
+
+void
+SearchIndex::AddEntry(int32 id)
+{
+	const std::vector<uint32>& trigrams = fEntries[id]->trigrams;
+	for (size_t i = 0; i < trigrams.size(); i++) {
+		// Reused IDs can be lower than ones already in the list
+		std::vector<int32>& postings = fPostings[trigrams[i]];
+		postings.insert(std::lower_bound(postings.begin(), postings.end(), id),
+			id);
+	}
+}
+
+
+void
+SearchIndex::RemoveEntry(int32 id)
+{
+	file_entry* entry = fEntries[id];
+	for (size_t i = 0; i < entry->trigrams.size(); i++) {
+		std::map<uint32, std::vector<int32> >::iterator postings
+			= fPostings.find(entry->trigrams[i]);
+		if (postings == fPostings.end())
+			continue;
+
+		std::vector<int32>& ids = postings->second;
+		std::vector<int32>::iterator position = std::lower_bound(ids.begin(),
+			ids.end(), id);
+		if (position != ids.end() && *position == id)
+			ids.erase(position);
+		if (ids.empty())
+			fPostings.erase(postings);
+	}
+
+	fIDs.erase(entry->path);
+	delete entry;
+	fEntries[id] = NULL;
+	fFreeIDs.push_back(id);
+}
+
+
+void
+SearchIndex::MarkStale(const BString& path)
+{
+	BAutolock lock(fDataLock);
+
+	std::map<BString, int32>::iterator id = fIDs.find(path);
+	if (id != fIDs.end()) {
+		fEntries[id->second]->stale = true;
+		fEntries[id->second]->unchecked = false;
+	}
+}
+
+
+status_t
+SearchIndex::Load(void)
+{
+	int fd = open(fIndexPath.String(), O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size < 8) {
+		close(fd);
+		return B_BAD_DATA;
+	}
+
+	size_t length = fileStat.st_size;
+	uint8* data = (uint8*)malloc(length);
+	if (data == NULL || read(fd, data, length) != (ssize_t)length) {
+		free(data);
+		close(fd);
+		return B_IO_ERROR;
+	}
+	close(fd);
+
+	const uint8* position = data;
+	const uint8* end = data + length;
+	uint32 count = 0;
+	status_t status = B_OK;
+	if (memcmp(position, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+		status = B_BAD_DATA;
+	} else {
+		position += sizeof(kIndexMagic);
+		if (!Take(position, end, count))
+			status = B_BAD_DATA;
+	}
+
+	BAutolock lock(fDataLock);
+	for (uint32 i = 0; i < count && status == B_OK; i++) {
+		uint32 pathLength;
+		int64 modified;
+		int64 size;
+		uint32 trigramCount;
+		if (!Take(position, end, pathLength)
+			|| (size_t)(end - position) < pathLength) {
+			status = B_BAD_DATA;
+			break;
+		}
+
+		file_entry* entry = new file_entry;
+		entry->path.SetTo((const char*)position, pathLength);
+		position += pathLength;
+
+		// Not to be trusted until UpdateFiles() has seen the file is the
+		// same as when it was indexed
+		entry->stale = true;
+		entry->unchecked = true;
+
+		if (!Take(position, end, modified) || !Take(position, end, size)
+			|| !Take(position, end, trigramCount)
+			|| (size_t)(end - position) / sizeof(uint32) < trigramCount) {
+			delete entry;
+			status = B_BAD_DATA;
+			break;
+		}
+
+		entry->modified = modified;
+		entry->size = size;
+		entry->trigrams.resize(trigramCount);
+		if (trigramCount > 0)
+			memcpy(&entry->trigrams[0], position, trigramCount * sizeof(uint32));
+		position += trigramCount * sizeof(uint32);
+
+		int32 id = fEntries.size();
+		fEntries.push_back(entry);
+		fIDs[entry->path] = id;
+		AddEntry(id);
+	}
+
+	free(data);
+
+	if (status != B_OK) {
+		// Start over rather than trust half of it
+		for (size_t i = 0; i < fEntries.size(); i++)
+			delete fEntries[i];
+		fEntries.clear();
+		fIDs.clear();
+		fPostings.clear();
+		fFreeIDs.clear();
+	}
+
+	STRACE(1, ("Loaded search index %s: %ld files\n", fIndexPath.String(),
+		(long)fEntries.size()));
+	return status;
+}
+
+
+status_t
+SearchIndex::Save(void)
+{
+	std::vector<uint8> buffer;
+	buffer.insert(buffer.end(), kIndexMagic, kIndexMagic + sizeof(kIndexMagic));
+	{
+		BAutolock lock(fDataLock);
+
+		uint32 count = 0;
+		for (size_t i = 0; i < fEntries.size(); i++) {
+			if (fEntries[i] != NULL && !fEntries[i]->stale)
+				count++;
+		}
+		Append(buffer, count);
+
+		// Stale entries are left out, so they get indexed again next time
+		for (size_t i = 0; i < fEntries.size(); i++) {
+			file_entry* entry = fEntries[i];
+			if (entry == NULL || entry->stale)
+				continue;
+
+			Append(buffer, (uint32)entry->path.Length());
+			buffer.insert(buffer.end(), entry->path.String(),
+				entry->path.String() + entry->path.Length());
+			Append(buffer, (int64)entry->modified);
+			Append(buffer, (int64)entry->size);
+			Append(buffer, (uint32)entry->trigrams.size());
+			if (!entry->trigrams.empty()) {
+				const uint8* trigrams = (const uint8*)&entry->trigrams[0];
+				buffer.insert(buffer.end(), trigrams,
+					trigrams + entry->trigrams.size() * sizeof(uint32));
+			}
+		}
+	}
+
+	DPath folder(DPath(fIndexPath).GetFolder());
+	create_directory(folder.GetFullPath(), 0777);
+
+	// Write a copy and move it over the old one, so the index is never left
+	// half written
+	BString tempPath(fIndexPath);
+	tempPath << ".tmp";
+	BFile file(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status == B_OK) {
+		ssize_t written = file.Write(&buffer[0], buffer.size());
+		if (written != (ssize_t)buffer.size())
+			status = written < 0 ? written : B_IO_ERROR;
+		else
+			file.Sync();
+	}
+	file.Unset();
+
+	if (status == B_OK && rename(tempPath.String(), fIndexPath.String()) != 0)
+		status = errno;
+	if (status != B_OK) {
+		unlink(tempPath.String());
+		STRACE(1, ("Couldn't save search index %s: %s\n", fIndexPath.String(),
+			strerror(status)));
+		return status;
+	}
+
+	fDirty = false;
+	return B_OK;
+}
@@ -0,0 +1,92 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+
+#include <Locker.h>
+#include <Looper.h>
+#include <String.h>
+
+#include <map>
+#include <vector>
+
+
+// A trigram index of a project's files, so a search only has to look at the
+// files which contain every three-byte sequence of its literal part. ASCII
+// letters are folded to lower case, so the same index serves searches with
+// and without Ignore case.
+//
+// The index is kept in a file and checked against the files' modification
+// times and sizes when the project is opened; until then, the files are
+// all candidates. Files the index rules out are checked the same way on
+// every search, since not all of them are watched for changes. Building
+// and updating it happens on the looper's own thread, driven by SetFiles()
+// and FileChanged(), while Narrow() can be called from any thread at any
+// time. Files which have changed but haven't been indexed again, or which
+// it doesn't know, are always returned as candidates, so results are never
+// missed because the index is behind.
+class SearchIndex : public BLooper {
+public:
+								SearchIndex(const char* indexPath);
+	virtual						~SearchIndex(void);
+
+	virtual	void				MessageReceived(BMessage* message);
+	virtual	bool				QuitRequested(void);
+
+			// Indexes these files and forgets about all others
+			void				SetFiles(const std::vector<BString>& files);
+			void				FileChanged(const char* path);
+
+			// Stops any indexing in progress and quits the looper
+			void				Shutdown(void);
+
+			// Puts the files which might contain literal into candidates.
+			// Returns false if the index can't help, as with literals shorter
+			// than three bytes.
+			bool				Narrow(const char* literal,
+									const std::vector<BString>& files,
+									std::vector<BString>& candidates);
+
+private:
+	struct file_entry {
+		BString					path;
+		time_t					modified;
+		off_t					size;
+		bool					stale;
+		// Loaded from the index file, but not compared with the file yet
+		bool					unchecked;
+		std::vector<uint32>		trigrams;
+	};
+
+	static	bool				SmallerList(const std::vector<int32>* a,
+									const std::vector<int32>* b);
+
+			void				UpdateFiles(BMessage* message);
+			void				IndexFile(const BString& path);
+			bool				ReadTrigrams(const BString& path,
+									file_entry& entry);
+			void				AddEntry(int32 id);
+			void				RemoveEntry(int32 id);
+			void				MarkStale(const BString& path);
+
+			status_t			Load(void);
+			status_t			Save(void);
+
+			BString				fIndexPath;
+			bool				fLoaded;
+			bool				fDirty;
+			int32				fCancelled;
+
+			// Guards everything below, which Narrow() reads from other
+			// threads. It is only held briefly, never while reading files.
+			BLocker				fDataLock;
+			std::vector<file_entry*>	fEntries;
+			std::vector<int32>	fFreeIDs;
+			std::map<BString, int32>	fIDs;
+			std::map<uint32, std::vector<int32> >	fPostings;
+
+			// Which trigrams the file being indexed has, one bit each
+			std::vector<uint8>	fSeen;
+};
+
+
+#endif	// SEARCH_INDEX_H
@@ -0,0 +1,772 @@
+#include "SymbolIndex.h"
+
+#include <Autolock.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <OS.h>
+#include <Path.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "ElfSymbols.h"
+
+
+static const char kIndexMagic[8] = { 'S', 'F', 'S', 'Y', 'M', 'S', '0', '1' };
+
+// How often what has been read so far is made searchable during an update
+static const bigtime_t kPublishInterval = 300000;
+
+
+template<typename T>
+static void
+Append(std::vector<uint8>& buffer, T value)
+{
+	const uint8* bytes = (const uint8*)&value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+
+static void
+AppendString(std::vector<uint8>& buffer, const BString& string)
+{
+	Append(buffer, (uint32)string.Length());
+	buffer.insert(buffer.end(), string.String(),
+		string.String() + string.Length());
+}
+
+
+template<typename T>
+static bool
+Take(const uint8*& data, const uint8* end, T& value)
+{
+	if ((size_t)(end - data) < sizeof(T))
+		return false;
+
+	memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+
+static bool
+TakeString(const uint8*& data, const uint8* end, BString& string)
+{
+	uint32 length;
+	if (!Take(data, end, length) || (size_t)(end - data) < length)
+		return false;
+
+	string.SetTo((const char*)data, length);
+	data += length;
+	return true;
+}
+
+
+static bool
+IsLibrary(const char* name)
+{
+	const char* extension = strrchr(name, '.');
+	if (extension == NULL)
+		return false;
+
+	return strcmp(extension, ".so") == 0 || strcmp(extension, ".o") == 0
+		|| strcmp(extension, ".a") == 0 || strstr(name, ".so.") != NULL;
+}
+
+
+// Runtime names like libpng16.so.16 can't be linked with -l, unlike the
+// libpng16.so links to them which the develop folder has
+static bool
+IsVersioned(const char* path)
+{
+	const char* name = strrchr(path, '/');
+	return strstr(name != NULL ? name : path, ".so.") != NULL;
+}
+
+
+// Compares a name from the lookup block, which ends with a newline, with
+// text, counting names which start with text as equal
+static int
+CompareStart(const char* name, const char* text)
+{
+	for (; *text != '\0'; name++, text++) {
+		char c = *name == '\n' ? '\0' : *name;
+		if (c != *text)
+			return (uint8)c < (uint8)*text ? -1 : 1;
+	}
+	return 0;
+}
+
+
+SymbolIndex::SymbolIndex(const char* indexPath)
+	:
+	fIndexPath(indexPath),
+	fUpdateLock("symbol index update"),
+	fLoaded(false),
+	fRefreshThread(-1),
+	fCancelRefresh(0),
+	fLock("symbol index")
+{
+}
+
+
+SymbolIndex::~SymbolIndex()
+{
+	if (fRefreshThread >= 0) {
+		atomic_set(&fCancelRefresh, 1);
+		status_t result;
+		wait_for_thread(fRefreshThread, &result);
+	}
+
+	for (size_t i = 0; i < fLibraries.size(); i++)
+		delete fLibraries[i];
+}
+
+
+status_t
+SymbolIndex::Load()
+{
+	fLoaded = true;
+
+	BFile file(fIndexPath.String(), B_READ_ONLY);
+	off_t fileSize;
+	status_t status = file.InitCheck();
+	if (status == B_OK)
+		status = file.GetSize(&fileSize);
+	if (status != B_OK)
+		return status;
+
+	std::vector<uint8> buffer(fileSize);
+	if (fileSize < (off_t)sizeof(kIndexMagic)
+		|| file.Read(&buffer[0], fileSize) != fileSize
+		|| memcmp(&buffer[0], kIndexMagic, sizeof(kIndexMagic)) != 0) {
+		return B_BAD_DATA;
+	}
+
+	const uint8* position = &buffer[0] + sizeof(kIndexMagic);
+	const uint8* end = &buffer[0] + buffer.size();
+	uint32 libraryCount = 0;
+	if (!Take(position, end, libraryCount))
+		return B_BAD_DATA;
+
+	std::vector<library_entry*> libraries;
+	for (uint32 i = 0; i < libraryCount && status == B_OK; i++) {
+		library_entry* library = new library_entry;
+		libraries.push_back(library);
+
+		uint32 memberCount;
+		if (!TakeString(position, end, library->path)
+			|| !Take(position, end, library->modified)
+			|| !Take(position, end, library->size)
+			|| !Take(position, end, memberCount)) {
+			status = B_BAD_DATA;
+			break;
+		}
+
+		for (uint32 j = 0; j < memberCount && status == B_OK; j++) {
+			BString member;
+			if (!TakeString(position, end, member))
+				status = B_BAD_DATA;
+			library->members.push_back(member);
+		}
+
+		uint32 symbolCount;
+		if (status != B_OK || !Take(position, end, symbolCount)) {
+			status = B_BAD_DATA;
+			break;
+		}
+
+		library->symbols.resize(std::min(symbolCount,
+			(uint32)(end - position) / 9));
+		for (uint32 j = 0; j < symbolCount && status == B_OK; j++) {
+			if (j >= library->symbols.size()) {
+				status = B_BAD_DATA;
+				break;
+			}
+
+			symbol_entry& symbol = library->symbols[j];
+			if (!TakeString(position, end, symbol.name)
+				|| !Take(position, end, symbol.member)
+				|| !Take(position, end, symbol.type)) {
+				status = B_BAD_DATA;
+			}
+		}
+	}
+
+	if (status != B_OK) {
+		// Start over rather than trust half of it
+		for (size_t i = 0; i < libraries.size(); i++)
+			delete libraries[i];
+		return status;
+	}
+
+	lookup newLookup;
+	BuildLookup(libraries, newLookup);
+
+	BAutolock lock(fLock);
+	fLibraries.swap(libraries);
+	std::swap(fLookup, newLookup);
+	for (size_t i = 0; i < libraries.size(); i++)
+		delete libraries[i];
+
+	return B_OK;
+}
+
+
+status_t
+SymbolIndex::Save()
+{
+	std::vector<uint8> buffer;
+	buffer.insert(buffer.end(), kIndexMagic, kIndexMagic + sizeof(kIndexMagic));
+	{
+		BAutolock lock(fLock);
+
+		Append(buffer, (uint32)fLibraries.size());
+		for (size_t i = 0; i < fLibraries.size(); i++) {
+			const library_entry* library = fLibraries[i];
+			AppendString(buffer, library->path);
+			Append(buffer, library->modified);
+			Append(buffer, library->size);
+
+			Append(buffer, (uint32)library->members.size());
+			for (size_t j = 0; j < library->members.size(); j++)
+				AppendString(buffer, library->members[j]);
+
+			Append(buffer, (uint32)library->symbols.size());
+			for (size_t j = 0; j < library->symbols.size(); j++) {
+				const symbol_entry& symbol = library->symbols[j];
+				AppendString(buffer, symbol.name);
+				Append(buffer, symbol.member);
+				Append(buffer, symbol.type);
+			}
+		}
+	}
+
+	// Write a copy and move it over the old one, so the index is never left
+	// half written. Both Paladin and SymbolFinder write it.
+	BString tempPath(fIndexPath);
+	tempPath << "." << (int32)getpid() << ".tmp";
+	BFile file(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status == B_OK) {
+		ssize_t written = file.Write(&buffer[0], buffer.size());
+		if (written != (ssize_t)buffer.size())
+			status = written < 0 ? written : B_IO_ERROR;
+	}
+	file.Unset();
+
+	if (status == B_OK && rename(tempPath.String(), fIndexPath.String()) != 0)
+		status = errno;
+	if (status != B_OK)
+		unlink(tempPath.String());
+
+	return status;
+}
+
+
+status_t
+SymbolIndex::Refresh(const BStringList& folders, int32* cancel)
+{
+	BAutolock updateLock(fUpdateLock);
+	if (!fLoaded)
+		Load();
+
+	int32 dontCancel = 0;
+	int32 readCount = Update(folders, cancel != NULL ? cancel : &dontCancel,
+		BMessenger());
+	if (readCount < 0)
+		return readCount;
+
+	return readCount > 0 ? Save() : B_OK;
+}
+
+
+void
+SymbolIndex::RefreshInBackground(const BStringList& folders)
+{
+	if (fRefreshThread >= 0)
+		return;
+
+	fRefreshFolders = folders;
+	fRefreshThread = spawn_thread(RefreshThread, "symbol index refresh",
+		B_LOW_PRIORITY, this);
+	if (fRefreshThread >= 0)
+		resume_thread(fRefreshThread);
+}
+
+
+status_t
+SymbolIndex::LoadIfNeeded()
+{
+	if (fUpdateLock.LockWithTimeout(0) != B_OK)
+		return B_OK;
+
+	status_t status = fLoaded ? B_OK : Load();
+	fUpdateLock.Unlock();
+	return status;
+}
+
+
+int32
+SymbolIndex::Update(const BStringList& folders, int32* cancel,
+	BMessenger target)
+{
+	BAutolock updateLock(fUpdateLock);
+
+	read_job job;
+	job.next = 0;
+	job.cancel = cancel;
+	job.readCount = 0;
+
+	// Links are followed, since the develop folder only has links to the
+	// libraries. Each file is only read once, under the name it is linked
+	// with when there is one.
+	std::map<std::pair<dev_t, ino_t>, size_t> seen;
+	for (int32 i = 0; i < folders.CountStrings(); i++) {
+		BDirectory directory(folders.StringAt(i).String());
+		BEntry entry;
+		while (directory.GetNextEntry(&entry, false) == B_OK) {
+			char name[B_FILE_NAME_LENGTH];
+			if (entry.GetName(name) != B_OK || !IsLibrary(name))
+				continue;
+
+			BString path(folders.StringAt(i));
+			path << "/" << name;
+
+			struct stat fileStat;
+			if (stat(path.String(), &fileStat) != 0
+				|| !S_ISREG(fileStat.st_mode)) {
+				continue;
+			}
+
+			std::pair<dev_t, ino_t> node(fileStat.st_dev, fileStat.st_ino);
+			std::map<std::pair<dev_t, ino_t>, size_t>::iterator found
+				= seen.find(node);
+			if (found == seen.end()) {
+				seen[node] = job.paths.size();
+				job.paths.push_back(path);
+				job.stats.push_back(fileStat);
+			} else if (IsVersioned(job.paths[found->second].String())
+				&& !IsVersioned(name)) {
+				job.paths[found->second] = path;
+			}
+		}
+	}
+
+	// Only this thread changes the list, so it can be read without the lock.
+	// Until a library has been read again, its old symbols are kept.
+	std::vector<library_entry*> old(fLibraries);
+	std::map<BString, library_entry*> known;
+	for (size_t i = 0; i < old.size(); i++)
+		known[old[i]->path] = old[i];
+
+	job.entries.resize(job.paths.size(), NULL);
+	for (size_t i = 0; i < job.paths.size(); i++) {
+		std::map<BString, library_entry*>::iterator it
+			= known.find(job.paths[i]);
+		if (it != known.end())
+			job.entries[i] = it->second;
+
+		if (it == known.end() || it->second->modified != job.stats[i].st_mtime
+			|| it->second->size != job.stats[i].st_size) {
+			job.pending.push_back(i);
+		}
+	}
+
+	if (job.pending.empty() && job.paths.size() == old.size())
+		return 0;
+
+	job.finished = create_sem(0, "symbol readers");
+	if (job.finished < B_OK)
+		return job.finished;
+
+	system_info info;
+	get_system_info(&info);
+	int32 threadCount = std::max((int32)1,
+		std::min(info.cpu_count, (int32)job.pending.size()));
+
+	std::vector<thread_id> threads;
+	for (int32 i = 0; i < threadCount; i++) {
+		thread_id thread = spawn_thread(ReadThread, "symbol reader",
+			B_LOW_PRIORITY, &job);
+		if (thread < 0)
+			break;
+
+		threads.push_back(thread);
+		resume_thread(thread);
+	}
+
+	if (threads.empty()) {
+		threadCount = 1;
+		ReadThread(&job);
+	} else
+		threadCount = threads.size();
+
+	// Show what has been read so far now and then, which matters most when
+	// there is no index yet
+	int32 finishedCount = 0;
+	int32 publishedCount = 0;
+	while (finishedCount < threadCount) {
+		status_t status = acquire_sem_etc(job.finished, 1, B_RELATIVE_TIMEOUT,
+			kPublishInterval);
+		if (status == B_OK) {
+			finishedCount++;
+			continue;
+		}
+		if (status != B_TIMED_OUT)
+			continue;
+
+		job.lock.Lock();
+		int32 readCount = job.readCount;
+		std::vector<library_entry*> libraries;
+		if (readCount != publishedCount)
+			Collect(job.entries, libraries);
+		job.lock.Unlock();
+
+		if (readCount == publishedCount)
+			continue;
+
+		Publish(libraries);
+		publishedCount = readCount;
+
+		BMessage message(M_SYMBOLS_CHANGED);
+		message.AddInt32("done", readCount);
+		message.AddInt32("total", job.pending.size());
+		target.SendMessage(&message);
+	}
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+	delete_sem(job.finished);
+
+	// Whatever was read before a cancel is worth keeping too
+	std::vector<library_entry*> libraries;
+	Collect(job.entries, libraries);
+	Publish(libraries);
+
+	std::set<library_entry*> current(libraries.begin(), libraries.end());
+	for (size_t i = 0; i < old.size(); i++) {
+		if (current.find(old[i]) == current.end())
+			delete old[i];
+	}
+
+	if (atomic_get(cancel) != 0)
+		return B_CANCELED;
+
+	return job.readCount;
+}
+
+
+int32
+SymbolIndex::CountLibraries()
+{
+	BAutolock lock(fLock);
+	return fLibraries.size();
+}
+
+
+int32
+SymbolIndex::CountSymbols()
+{
+	BAutolock lock(fLock);
+	return fLookup.starts.size();
+}
+
+
+int32
+SymbolIndex::Find(const char* text, int32 maxCount,
+	std::vector<symbol_match>& matches)
+{
+	matches.clear();
+
+	// A newline would match across names
+	BString query(text);
+	query.RemoveAll("\n");
+	if (query.Length() == 0)
+		return 0;
+
+	BAutolock lock(fLock);
+	const lookup& data = fLookup;
+	const char* names = data.names.c_str();
+
+	// The sorted block has all the names starting with the text together
+	int32 first = 0;
+	int32 last = data.starts.size();
+	while (first < last) {
+		int32 middle = (first + last) / 2;
+		if (CompareStart(names + data.starts[middle], query.String()) < 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	int32 prefixStart = first;
+	int32 prefixEnd = first;
+	while (prefixEnd < (int32)data.starts.size()
+		&& CompareStart(names + data.starts[prefixEnd], query.String()) == 0) {
+		if ((int32)matches.size() < maxCount)
+			AddMatch(prefixEnd, matches);
+		prefixEnd++;
+	}
+
+	int32 count = prefixEnd - prefixStart;
+	const char* position = names;
+	const char* hit;
+	while ((hit = strstr(position, query.String())) != NULL) {
+		int32 index = std::upper_bound(data.starts.begin(), data.starts.end(),
+			(uint32)(hit - names)) - data.starts.begin() - 1;
+
+		if (index < prefixStart || index >= prefixEnd) {
+			if ((int32)matches.size() < maxCount)
+				AddMatch(index, matches);
+			count++;
+		}
+
+		// One match per name is enough
+		if (index + 1 >= (int32)data.starts.size())
+			break;
+		position = names + data.starts[index + 1];
+	}
+
+	return count;
+}
+
+
+void
+SymbolIndex::FindProviders(const std::set<BString>& names,
+	std::map<BString, BStringList>& providers)
+{
+	providers.clear();
+
+	BAutolock lock(fLock);
+	const lookup& data = fLookup;
+	const char* allNames = data.names.c_str();
+
+	for (std::set<BString>::const_iterator it = names.begin();
+			it != names.end(); it++) {
+		BString name(*it);
+		name.RemoveAll("\n");
+		if (name.Length() == 0)
+			continue;
+
+		int32 first = 0;
+		int32 last = data.starts.size();
+		while (first < last) {
+			int32 middle = (first + last) / 2;
+			if (CompareStart(allNames + data.starts[middle], name.String()) < 0)
+				first = middle + 1;
+			else
+				last = middle;
+		}
+
+		// The names starting with it are together, and the ones which are
+		// it come first
+		for (int32 i = first; i < (int32)data.starts.size(); i++) {
+			const char* candidate = allNames + data.starts[i];
+			if (strncmp(candidate, name.String(), name.Length()) != 0
+				|| candidate[name.Length()] != '\n') {
+				break;
+			}
+
+			// Only libraries which can be linked with are any use
+			const BString& path = fLibraries[data.owners[i].library]->path;
+			if ((path.EndsWith(".so") || path.EndsWith(".a"))
+				&& !IsVersioned(path.String())
+				&& !providers[*it].HasString(path)) {
+				providers[*it].Add(path);
+			}
+		}
+	}
+}
+
+
+void
+SymbolIndex::GetLibraryFolders(BStringList& folders)
+{
+	static const directory_which kLibraryFolders[] = {
+		B_BEOS_LIB_DIRECTORY,
+		B_SYSTEM_LIB_DIRECTORY,
+		B_SYSTEM_NONPACKAGED_LIB_DIRECTORY,
+		B_USER_LIB_DIRECTORY,
+		B_USER_NONPACKAGED_LIB_DIRECTORY
+	};
+
+	BPath path;
+	for (size_t i = 0; i < sizeof(kLibraryFolders) / sizeof(kLibraryFolders[0]);
+			i++) {
+		if (find_directory(kLibraryFolders[i], &path) == B_OK
+			&& BEntry(path.Path()).Exists() && !folders.HasString(path.Path())) {
+			folders.Add(path.Path());
+		}
+	}
+
+	// Static libraries are only found with the headers
+	if (find_directory(B_SYSTEM_DEVELOP_DIRECTORY, &path) == B_OK
+		&& path.Append("lib") == B_OK && BEntry(path.Path()).Exists()
+		&& !folders.HasString(path.Path())) {
+		folders.Add(path.Path());
+	}
+}
+
+
+BString
+SymbolIndex::DefaultPath()
+{
+	BPath path;
+	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) != B_OK
+		|| path.Append("SymbolFinder_index") != B_OK) {
+		return BString();
+	}
+	return BString(path.Path());
+}
+
+
+int32
+SymbolIndex::RefreshThread(void* data)
+{
+	SymbolIndex* index = static_cast<SymbolIndex*>(data);
+	return index->Refresh(index->fRefreshFolders, &index->fCancelRefresh);
+}
+
+
+int32
+SymbolIndex::ReadThread(void* data)
+{
+	read_job* job = static_cast<read_job*>(data);
+
+	while (atomic_get(job->cancel) == 0) {
+		int32 next = atomic_add(&job->next, 1);
+		if (next >= (int32)job->pending.size())
+			break;
+
+		int32 index = job->pending[next];
+		library_entry* library = ReadLibrary(job->paths[index],
+			job->stats[index]);
+
+		BAutolock lock(job->lock);
+		job->entries[index] = library;
+		job->readCount++;
+	}
+
+	release_sem(job->finished);
+	return 0;
+}
+
+
+void
+SymbolIndex::Collect(const std::vector<library_entry*>& entries,
+	std::vector<library_entry*>& libraries)
+{
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i] != NULL)
+			libraries.push_back(entries[i]);
+	}
+}
+
+
+void
+SymbolIndex::Publish(const std::vector<library_entry*>& libraries)
+{
+	lookup newLookup;
+	BuildLookup(libraries, newLookup);
+
+	std::vector<library_entry*> copy(libraries);
+	BAutolock lock(fLock);
+	fLibraries.swap(copy);
+	std::swap(fLookup, newLookup);
+}
+
+
+SymbolIndex::library_entry*
+SymbolIndex::ReadLibrary(const BString& path, const struct stat& fileStat)
+{
+	library_entry* library = new library_entry;
+	library->path = path;
+	library->modified = fileStat.st_mtime;
+	library->size = fileStat.st_size;
+
+	// Files which turn out not to be libraries are kept too, with nothing
+	// in them, so they aren't read again every time
+	std::vector<elf_symbol> symbols;
+	ReadElfSymbols(path.String(), symbols, library->members);
+
+	for (size_t i = 0; i < symbols.size(); i++) {
+		if (!symbols[i].defined || !symbols[i].global)
+			continue;
+
+		symbol_entry symbol;
+		symbol.name = DemangleSymbol(symbols[i].name.String());
+		symbol.member = symbols[i].member;
+		symbol.type = symbols[i].type;
+		library->symbols.push_back(symbol);
+	}
+
+	return library;
+}
+
+
+void
+SymbolIndex::BuildLookup(const std::vector<library_entry*>& libraries,
+	lookup& result)
+{
+	std::vector<std::pair<const char*, symbol_owner> > order;
+	size_t length = 0;
+	for (size_t i = 0; i < libraries.size(); i++) {
+		for (size_t j = 0; j < libraries[i]->symbols.size(); j++) {
+			symbol_owner owner = { (int32)i, (int32)j };
+			const BString& name = libraries[i]->symbols[j].name;
+			order.push_back(std::make_pair(name.String(), owner));
+			length += name.Length() + 1;
+		}
+	}
+
+	struct {
+		bool operator()(const std::pair<const char*, symbol_owner>& a,
+			const std::pair<const char*, symbol_owner>& b) const
+		{
+			return strcmp(a.first, b.first) < 0;
+		}
+	} byName;
+	std::sort(order.begin(), order.end(), byName);
+
+	result.names.clear();
+	result.names.reserve(length);
+	result.starts.clear();
+	result.starts.reserve(order.size());
+	result.owners.clear();
+	result.owners.reserve(order.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		result.starts.push_back(result.names.size());
+		result.names.append(order[i].first);
+		result.names.push_back('\n');
+		result.owners.push_back(order[i].second);
+	}
+}
+
+
+void
+SymbolIndex::AddMatch(int32 index, std::vector<symbol_match>& matches) const
+{
+	const symbol_owner& owner = fLookup.owners[index];
+	const library_entry* library = fLibraries[owner.library];
+	const symbol_entry& symbol = library->symbols[owner.symbol];
+
+	symbol_match match;
+	match.name = symbol.name;
+	match.library = library->path;
+	if (symbol.member >= 0 && symbol.member < (int32)library->members.size())
+		match.member = library->members[symbol.member];
+	match.type = symbol.type;
+	matches.push_back(match);
+}
@@ -0,0 +1,167 @@
+#ifndef _SYMBOL_INDEX_H
+#define _SYMBOL_INDEX_H
+
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <String.h>
+#include <StringList.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+
+enum {
+	M_SYMBOLS_CHANGED = 'sych'
+};
+
+
+struct symbol_match {
+	BString		name;
+	BString		library;
+	BString		member;
+	char		type;
+};
+
+
+// The symbols the libraries in a set of folders define, demangled, kept in
+// a file between runs. Update() only reads the libraries which are new or
+// have changed since they were indexed. Lookups go through one sorted block
+// of names, so they take milliseconds, and they can be done from any
+// thread while an update is running. SymbolFinder and Paladin share both the
+// code and the file.
+class SymbolIndex {
+public:
+								SymbolIndex(const char* indexPath);
+								~SymbolIndex();
+
+			status_t			Load();
+			status_t			Save();
+
+			// Loads the index the first time, then updates it and saves it
+			// if any library had to be read, for lookups which can't do
+			// with what was found last time
+			status_t			Refresh(const BStringList& folders,
+									int32* cancel = NULL);
+
+			// Does Refresh() on a thread of its own, so that the index is
+			// up to date by the time it is needed. Only the first call
+			// starts one. The destructor stops it.
+			void				RefreshInBackground(
+									const BStringList& folders);
+
+			// Loads the index unless it has been already. An update which
+			// is running has, so this doesn't wait for it to finish.
+			status_t			LoadIfNeeded();
+
+			// Returns the number of libraries which had to be read, or
+			// B_CANCELED if cancel was set before the update was done.
+			// Libraries are read by a thread per CPU. While they are, what
+			// has been found so far can be searched, and target is sent
+			// M_SYMBOLS_CHANGED with "done" and "total" counts every so often.
+			int32				Update(const BStringList& folders,
+									int32* cancel, BMessenger target);
+
+			int32				CountLibraries();
+			int32				CountSymbols();
+
+			// Puts up to maxCount symbols whose names start with text into
+			// matches, followed by the ones which just contain it. Returns
+			// how many there are in all.
+			int32				Find(const char* text, int32 maxCount,
+									std::vector<symbol_match>& matches);
+
+			// Fills providers with the paths of the libraries which define
+			// each of names exactly and can be linked with, so versioned
+			// names like libfoo.so.1 are left out, as are names no library
+			// defines.
+			void				FindProviders(const std::set<BString>& names,
+									std::map<BString, BStringList>& providers);
+
+	static	void				GetLibraryFolders(BStringList& folders);
+
+			// Where the index of the library folders is kept
+	static	BString				DefaultPath();
+
+private:
+	struct symbol_entry {
+		BString					name;
+		int32					member;
+		char					type;
+	};
+
+	struct library_entry {
+		BString					path;
+		int64					modified;
+		int64					size;
+		std::vector<BString>	members;
+		std::vector<symbol_entry>	symbols;
+	};
+
+	struct symbol_owner {
+		int32					library;
+		int32					symbol;
+	};
+
+	struct lookup {
+		// Every name followed by a newline, sorted, so that both prefix
+		// and substring searches are one pass over a single block
+		std::string				names;
+		std::vector<uint32>		starts;
+		std::vector<symbol_owner>	owners;
+	};
+
+	struct read_job {
+		std::vector<BString>		paths;
+		std::vector<struct stat>	stats;
+
+		// The libraries which have to be read, as indexes into paths
+		std::vector<int32>			pending;
+		int32						next;
+		int32*						cancel;
+
+		// Released by each thread when it is done
+		sem_id						finished;
+
+		// Guards entries, what there is for each path so far, and readCount
+		BLocker						lock;
+		std::vector<library_entry*>	entries;
+		int32						readCount;
+	};
+
+	static	int32				RefreshThread(void* data);
+	static	int32				ReadThread(void* data);
+	static	void				Collect(
+									const std::vector<library_entry*>& entries,
+									std::vector<library_entry*>& libraries);
+			void				Publish(
+									const std::vector<library_entry*>& libraries);
+	static	library_entry*		ReadLibrary(const BString& path,
+									const struct stat& fileStat);
+	static	void				BuildLookup(
+									const std::vector<library_entry*>& libraries,
+									lookup& result);
+			void				AddMatch(int32 index,
+									std::vector<symbol_match>& matches) const;
+
+			BString				fIndexPath;
+
+			// Only one update can run at a time
+			BLocker				fUpdateLock;
+			bool				fLoaded;
+
+			thread_id			fRefreshThread;
+			int32				fCancelRefresh;
+			BStringList			fRefreshFolders;
+
+			// Guards everything below
+			BLocker				fLock;
+			std::vector<library_entry*>	fLibraries;
+			lookup				fLookup;
+};
+
+
+#endif // _SYMBOL_INDEX_H
@@ -0,0 +1,712 @@
+#include "SymbolXref.h"
+
+#include <Autolock.h>
+#include <File.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+
+#include "DebugTools.h"
+#include "ElfSymbols.h"
+#include "Globals.h"
+
+
+static const char kIndexMagic[8] = { 'P', 'L', 'D', 'X', 'R', 'E', 'F', '3' };
+
+
+template<typename T>
+static void
+Append(std::vector<uint8>& buffer, T value)
+{
+	const uint8* bytes = (const uint8*)&value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+
+static void
+AppendString(std::vector<uint8>& buffer, const BString& string)
+{
+	Append(buffer, (uint32)string.Length());
+	buffer.insert(buffer.end(), string.String(),
+		string.String() + string.Length());
+}
+
+
+template<typename T>
+static bool
+Take(const uint8*& data, const uint8* end, T& value)
+{
+	if ((size_t)(end - data) < sizeof(T))
+		return false;
+
+	memcpy(&value, data, sizeof(T));
+	data += sizeof(T);
+	return true;
+}
+
+
+static bool
+TakeString(const uint8*& data, const uint8* end, BString& string)
+{
+	uint32 length;
+	if (!Take(data, end, length) || (size_t)(end - data) < length)
+		return false;
+
+	string.SetTo((const char*)data, length);
+	data += length;
+	return true;
+}
+
+
+SymbolXref::SymbolXref(const char* indexPath)
+	:
+	fIndexPath(indexPath),
+	fLock("symbol xref"),
+	fLoaded(false),
+	fNextPending(0),
+	fCancel(NULL)
+{
+}
+
+
+SymbolXref::~SymbolXref()
+{
+	for (size_t i = 0; i < fObjects.size(); i++)
+		delete fObjects[i];
+}
+
+
+int32
+SymbolXref::Update(const std::vector<object_file>& objects, int32* cancel)
+{
+	// Another update may be reading the objects
+	while (fLock.LockWithTimeout(100000) != B_OK) {
+		if (cancel != NULL && atomic_get(cancel) != 0)
+			return 0;
+	}
+	bigtime_t startTime = system_time();
+
+	if (!fLoaded) {
+		Load();
+		fLoaded = true;
+	}
+
+	std::map<BString, object_entry*> known;
+	for (size_t i = 0; i < fObjects.size(); i++)
+		known[fObjects[i]->path] = fObjects[i];
+
+	// Objects of sources which failed to build, or haven't been built yet,
+	// aren't there
+	std::vector<object_entry*> current;
+	fPending.clear();
+	for (size_t i = 0; i < objects.size(); i++) {
+		struct stat fileStat;
+		if (stat(objects[i].object.String(), &fileStat) != 0)
+			continue;
+
+		object_entry* object;
+		std::map<BString, object_entry*>::iterator it
+			= known.find(objects[i].object);
+		if (it != known.end()) {
+			object = it->second;
+			known.erase(it);
+		} else {
+			object = new object_entry;
+			object->path = objects[i].object;
+			object->modified = -1;
+			object->size = -1;
+		}
+
+		object->source = objects[i].source;
+		object->library = objects[i].library;
+		current.push_back(object);
+
+		if (object->modified != fileStat.st_mtime
+			|| object->size != fileStat.st_size) {
+			object->modified = fileStat.st_mtime;
+			object->size = fileStat.st_size;
+			fPending.push_back(object);
+		}
+	}
+
+	bool changed = !fPending.empty() || !known.empty()
+		|| current.size() != fObjects.size();
+	for (std::map<BString, object_entry*>::iterator it = known.begin();
+			it != known.end(); it++) {
+		delete it->second;
+	}
+	fObjects.swap(current);
+
+	int32 readCount = fPending.size();
+	if (!fPending.empty()) {
+		fNextPending = 0;
+		fCancel = cancel;
+		int32 threadCount = std::max(1, std::min((int)gCPUCount,
+			(int)fPending.size()));
+		std::vector<thread_id> threads;
+		for (int32 i = 0; i < threadCount; i++) {
+			thread_id thread = spawn_thread(ReadThread, "object reader",
+				B_NORMAL_PRIORITY, this);
+			if (thread < 0)
+				break;
+
+			threads.push_back(thread);
+			resume_thread(thread);
+		}
+
+		if (threads.empty())
+			ReadThread(this);
+
+		for (size_t i = 0; i < threads.size(); i++) {
+			status_t result;
+			wait_for_thread(threads[i], &result);
+		}
+
+		// The objects left when it was cancelled are read next time
+		readCount = std::min(fNextPending, readCount);
+		for (size_t i = readCount; i < fPending.size(); i++) {
+			fPending[i]->modified = -1;
+			fPending[i]->size = -1;
+		}
+		fCancel = NULL;
+		fPending.clear();
+	}
+
+	if (changed || fSymbols.empty())
+		BuildLookup();
+	if (changed)
+		Save();
+
+	STRACE(1, ("Updated symbol xref %s: read %ld of %ld objects in %lld us\n",
+		fIndexPath.String(), (long)readCount, (long)fObjects.size(),
+		system_time() - startTime));
+	fLock.Unlock();
+	return readCount;
+}
+
+
+int32
+SymbolXref::Find(const char* text, int32 maxCount,
+	std::vector<xref_symbol>& symbols)
+{
+	symbols.clear();
+	if (text == NULL || *text == '\0')
+		return 0;
+
+	BAutolock lock(fLock);
+
+	// Names which are exactly the text come first
+	int32 count = 0;
+	std::map<BString, symbol_entry>::const_iterator exact
+		= fSymbols.find(text);
+	if (exact != fSymbols.end()) {
+		symbols.resize(1);
+		MakeSymbol(exact->first, exact->second, symbols[0]);
+		count++;
+	}
+
+	for (std::map<BString, symbol_entry>::const_iterator it = fSymbols.begin();
+			it != fSymbols.end(); it++) {
+		if (it == exact || it->first.FindFirst(text) < 0)
+			continue;
+
+		if ((int32)symbols.size() < maxCount) {
+			symbols.resize(symbols.size() + 1);
+			MakeSymbol(it->first, it->second, symbols.back());
+		}
+		count++;
+	}
+
+	return count;
+}
+
+
+void
+SymbolXref::FindUnreferenced(std::vector<xref_symbol>& symbols)
+{
+	symbols.clear();
+	BAutolock lock(fLock);
+
+	for (std::map<BString, symbol_entry>::const_iterator it = fSymbols.begin();
+			it != fSymbols.end(); it++) {
+		const symbol_entry& entry = it->second;
+		if (entry.definitions.empty() || !entry.references.empty()
+			|| it->first == "main" || IsCompilerSymbol(it->first)) {
+			continue;
+		}
+
+		bool skip = false;
+		for (size_t i = 0; i < entry.definitions.size() && !skip; i++) {
+			const object_entry* object
+				= fObjects[entry.definitions[i].object];
+			skip = object->library
+				|| IsMerged(object->symbols[entry.definitions[i].symbol]);
+		}
+		if (skip)
+			continue;
+
+		symbols.resize(symbols.size() + 1);
+		MakeSymbol(it->first, entry, symbols.back());
+	}
+}
+
+
+void
+SymbolXref::FindConflicts(std::vector<symbol_conflict>& conflicts)
+{
+	conflicts.clear();
+	BAutolock lock(fLock);
+
+	std::vector<std::vector<bool> > linked;
+	FindLinkedMembers(linked);
+
+	for (std::map<BString, symbol_entry>::const_iterator it = fSymbols.begin();
+			it != fSymbols.end(); it++) {
+		if (it->second.definitions.size() < 2 || IsCompilerSymbol(it->first))
+			continue;
+
+		// Archive members the link leaves out can't conflict with anything
+		std::vector<symbol_location> definitions;
+		for (size_t i = 0; i < it->second.definitions.size(); i++) {
+			const symbol_location& location = it->second.definitions[i];
+			int32 member = fObjects[location.object]
+				->symbols[location.symbol].member;
+			if (member < 0 || linked[location.object][member])
+				definitions.push_back(location);
+		}
+		if (definitions.size() < 2)
+			continue;
+
+		// A strong definition wins over the weak ones, so those only matter
+		// amongst themselves. COMDAT ones are treated the same way.
+		int32 strongCount = 0;
+		bool mismatch = false;
+		bool libraryOnly = true;
+		const object_symbol* firstWeak = NULL;
+		for (size_t i = 0; i < definitions.size(); i++) {
+			const object_entry* object = fObjects[definitions[i].object];
+			const object_symbol& symbol
+				= object->symbols[definitions[i].symbol];
+			if (!object->library)
+				libraryOnly = false;
+
+			if (symbol.type == 'C') {
+				// Common symbols are merged by the linker on purpose
+				continue;
+			}
+
+			if (!IsMerged(symbol))
+				strongCount++;
+			else if (firstWeak == NULL)
+				firstWeak = &symbol;
+			else if (symbol.size != firstWeak->size
+				|| symbol.hash != firstWeak->hash) {
+				mismatch = true;
+			}
+		}
+
+		// The libraries' own business is left to whoever makes them
+		if (libraryOnly)
+			continue;
+
+		if (strongCount > 1 || (strongCount == 0 && mismatch)) {
+			conflicts.resize(conflicts.size() + 1);
+			MakeConflict(it->first, definitions, strongCount == 0,
+				conflicts.back());
+		}
+	}
+}
+
+
+status_t
+SymbolXref::Load()
+{
+	BFile file(fIndexPath.String(), B_READ_ONLY);
+	off_t fileSize;
+	status_t status = file.InitCheck();
+	if (status == B_OK)
+		status = file.GetSize(&fileSize);
+	if (status != B_OK)
+		return status;
+
+	std::vector<uint8> buffer(fileSize);
+	if (fileSize < (off_t)sizeof(kIndexMagic)
+		|| file.Read(&buffer[0], fileSize) != fileSize
+		|| memcmp(&buffer[0], kIndexMagic, sizeof(kIndexMagic)) != 0) {
+		return B_BAD_DATA;
+	}
+
+	const uint8* position = &buffer[0] + sizeof(kIndexMagic);
+	const uint8* end = &buffer[0] + buffer.size();
+	uint32 count = 0;
+	if (!Take(position, end, count))
+		return B_BAD_DATA;
+
+	for (uint32 i = 0; i < count && status == B_OK; i++) {
+		object_entry* object = new object_entry;
+		fObjects.push_back(object);
+
+		uint32 memberCount;
+		if (!TakeString(position, end, object->path)
+			|| !TakeString(position, end, object->source)
+			|| !Take(position, end, object->library)
+			|| !Take(position, end, object->modified)
+			|| !Take(position, end, object->size)
+			|| !Take(position, end, memberCount)
+			|| (size_t)(end - position) / sizeof(uint32) < memberCount) {
+			status = B_BAD_DATA;
+			break;
+		}
+
+		object->members.resize(memberCount);
+		for (uint32 j = 0; j < memberCount && status == B_OK; j++) {
+			if (!TakeString(position, end, object->members[j]))
+				status = B_BAD_DATA;
+		}
+
+		uint32 symbolCount;
+		if (status != B_OK || !Take(position, end, symbolCount)
+			|| (size_t)(end - position) / 24 < symbolCount) {
+			status = B_BAD_DATA;
+			break;
+		}
+
+		object->symbols.resize(symbolCount);
+		for (uint32 j = 0; j < symbolCount && status == B_OK; j++) {
+			object_symbol& symbol = object->symbols[j];
+			if (!TakeString(position, end, symbol.name)
+				|| !Take(position, end, symbol.type)
+				|| !Take(position, end, symbol.defined)
+				|| !Take(position, end, symbol.size)
+				|| !Take(position, end, symbol.hash)
+				|| !Take(position, end, symbol.comdat)
+				|| !Take(position, end, symbol.local)
+				|| !Take(position, end, symbol.member)
+				|| symbol.member >= (int32)memberCount) {
+				status = B_BAD_DATA;
+			}
+		}
+	}
+
+	if (status != B_OK) {
+		// Start over rather than trust half of it
+		for (size_t i = 0; i < fObjects.size(); i++)
+			delete fObjects[i];
+		fObjects.clear();
+	}
+
+	return status;
+}
+
+
+status_t
+SymbolXref::Save()
+{
+	std::vector<uint8> buffer;
+	buffer.insert(buffer.end(), kIndexMagic, kIndexMagic + sizeof(kIndexMagic));
+
+	Append(buffer, (uint32)fObjects.size());
+	for (size_t i = 0; i < fObjects.size(); i++) {
+		const object_entry* object = fObjects[i];
+		AppendString(buffer, object->path);
+		AppendString(buffer, object->source);
+		Append(buffer, object->library);
+		Append(buffer, object->modified);
+		Append(buffer, object->size);
+		Append(buffer, (uint32)object->members.size());
+		for (size_t j = 0; j < object->members.size(); j++)
+			AppendString(buffer, object->members[j]);
+		Append(buffer, (uint32)object->symbols.size());
+		for (size_t j = 0; j < object->symbols.size(); j++) {
+			const object_symbol& symbol = object->symbols[j];
+			AppendString(buffer, symbol.name);
+			Append(buffer, symbol.type);
+			Append(buffer, symbol.defined);
+			Append(buffer, symbol.size);
+			Append(buffer, symbol.hash);
+			Append(buffer, symbol.comdat);
+			Append(buffer, symbol.local);
+			Append(buffer, symbol.member);
+		}
+	}
+
+	// Write a copy and move it over the old one, so the index is never left
+	// half written
+	BString tempPath(fIndexPath);
+	tempPath << ".tmp";
+	BFile file(tempPath.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status == B_OK) {
+		ssize_t written = file.Write(&buffer[0], buffer.size());
+		if (written != (ssize_t)buffer.size())
+			status = written < 0 ? written : B_IO_ERROR;
+	}
+	file.Unset();
+
+	if (status == B_OK && rename(tempPath.String(), fIndexPath.String()) != 0)
+		status = errno;
+	if (status != B_OK) {
+		unlink(tempPath.String());
+		STRACE(1, ("Couldn't save symbol xref %s: %s\n", fIndexPath.String(),
+			strerror(status)));
+	}
+
+	return status;
+}
+
+
+void
+SymbolXref::FindLocalDefinitions(const std::set<BString>& names,
+	std::map<BString, BStringList>& sources)
+{
+	BAutolock lock(fLock);
+
+	for (std::set<BString>::const_iterator it = names.begin();
+			it != names.end(); it++) {
+		std::map<BString, std::vector<int32> >::const_iterator local
+			= fLocalDefinitions.find(*it);
+		if (local == fLocalDefinitions.end())
+			continue;
+
+		for (size_t i = 0; i < local->second.size(); i++)
+			sources[*it].Add(fObjects[local->second[i]]->source);
+	}
+}
+
+
+void
+SymbolXref::BuildLookup()
+{
+	fSymbols.clear();
+	fLocalDefinitions.clear();
+	for (size_t i = 0; i < fObjects.size(); i++) {
+		const std::vector<object_symbol>& symbols = fObjects[i]->symbols;
+		for (size_t j = 0; j < symbols.size(); j++) {
+			if (symbols[j].local) {
+				std::vector<int32>& objects
+					= fLocalDefinitions[symbols[j].name];
+				if (objects.empty() || objects.back() != (int32)i)
+					objects.push_back(i);
+				continue;
+			}
+
+			symbol_entry& entry = fSymbols[symbols[j].name];
+			if (symbols[j].defined) {
+				// Archive members can each define it
+				symbol_location location = { (int32)i, (int32)j };
+				entry.definitions.push_back(location);
+			} else if (entry.references.empty()
+				|| entry.references.back() != (int32)i) {
+				entry.references.push_back(i);
+			}
+		}
+	}
+}
+
+
+void
+SymbolXref::MakeSymbol(const BString& name, const symbol_entry& entry,
+	xref_symbol& symbol) const
+{
+	symbol.name = name;
+	for (size_t i = 0; i < entry.definitions.size(); i++) {
+		const object_entry* object = fObjects[entry.definitions[i].object];
+		if (!symbol.definitions.HasString(object->source))
+			symbol.definitions.Add(object->source);
+	}
+	for (size_t i = 0; i < entry.references.size(); i++)
+		symbol.references.Add(fObjects[entry.references[i]]->source);
+}
+
+
+void
+SymbolXref::MakeConflict(const BString& name,
+	const std::vector<symbol_location>& definitions, bool mismatch,
+	symbol_conflict& conflict) const
+{
+	conflict.name = name;
+	conflict.mismatch = mismatch;
+	for (size_t i = 0; i < definitions.size(); i++) {
+		const object_entry* object = fObjects[definitions[i].object];
+		const object_symbol& symbol = object->symbols[definitions[i].symbol];
+
+		symbol_definition definition;
+		definition.source = object->source;
+		if (symbol.member >= 0)
+			definition.member = object->members[symbol.member];
+		definition.size = symbol.size;
+		conflict.definitions.push_back(definition);
+	}
+}
+
+
+// Works out which archive members the link pulls in the way the linker
+// does: going through the libraries in order, a member is taken when it
+// defines a symbol which is still undefined, until no member of that
+// library resolves anything more. Earlier libraries aren't looked at again.
+void
+SymbolXref::FindLinkedMembers(std::vector<std::vector<bool> >& linked) const
+{
+	linked.clear();
+	linked.resize(fObjects.size());
+
+	std::set<BString> defined;
+	for (size_t i = 0; i < fObjects.size(); i++) {
+		const object_entry* object = fObjects[i];
+		if (object->library) {
+			linked[i].resize(object->members.size(), false);
+			continue;
+		}
+
+		for (size_t j = 0; j < object->symbols.size(); j++) {
+			if (object->symbols[j].defined && !object->symbols[j].local)
+				defined.insert(object->symbols[j].name);
+		}
+	}
+
+	std::set<BString> undefined;
+	for (size_t i = 0; i < fObjects.size(); i++) {
+		const object_entry* object = fObjects[i];
+		if (object->library)
+			continue;
+
+		for (size_t j = 0; j < object->symbols.size(); j++) {
+			const object_symbol& symbol = object->symbols[j];
+			if (!symbol.defined && defined.find(symbol.name) == defined.end())
+				undefined.insert(symbol.name);
+		}
+	}
+
+	for (size_t i = 0; i < fObjects.size(); i++) {
+		const object_entry* object = fObjects[i];
+		if (!object->library)
+			continue;
+
+		std::vector<std::vector<int32> > memberSymbols(
+			object->members.size());
+		for (size_t j = 0; j < object->symbols.size(); j++) {
+			int32 member = object->symbols[j].member;
+			if (member >= 0 && member < (int32)memberSymbols.size())
+				memberSymbols[member].push_back(j);
+		}
+
+		bool pulled = true;
+		while (pulled && !undefined.empty()) {
+			pulled = false;
+			for (size_t j = 0; j < object->symbols.size(); j++) {
+				const object_symbol& symbol = object->symbols[j];
+				if (!symbol.defined || symbol.member < 0
+					|| symbol.member >= (int32)memberSymbols.size()
+					|| linked[i][symbol.member]
+					|| undefined.find(symbol.name) == undefined.end()) {
+					continue;
+				}
+
+				linked[i][symbol.member] = true;
+				pulled = true;
+
+				const std::vector<int32>& symbols
+					= memberSymbols[symbol.member];
+				for (size_t k = 0; k < symbols.size(); k++) {
+					const object_symbol& other = object->symbols[symbols[k]];
+					if (other.defined) {
+						defined.insert(other.name);
+						undefined.erase(other.name);
+					}
+				}
+				for (size_t k = 0; k < symbols.size(); k++) {
+					const object_symbol& other = object->symbols[symbols[k]];
+					if (!other.defined
+						&& defined.find(other.name) == defined.end()) {
+						undefined.insert(other.name);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+int32
+SymbolXref::ReadThread(void* data)
+{
+	SymbolXref* xref = static_cast<SymbolXref*>(data);
+
+	while (xref->fCancel == NULL || atomic_get(xref->fCancel) == 0) {
+		int32 next = atomic_add(&xref->fNextPending, 1);
+		if (next >= (int32)xref->fPending.size())
+			break;
+
+		ReadObject(*xref->fPending[next]);
+	}
+
+	return 0;
+}
+
+
+void
+SymbolXref::ReadObject(object_entry& object)
+{
+	// The contents are hashed to tell weak definitions apart
+	std::vector<elf_symbol> symbols;
+	object.members.clear();
+	ReadElfSymbols(object.path.String(), symbols, object.members, true);
+
+	// Local symbols can't be used from other objects, so only the project's
+	// own definitions are kept, for telling why the link misses one
+	object.symbols.clear();
+	for (size_t i = 0; i < symbols.size(); i++) {
+		bool local = !symbols[i].global;
+		if (local && (object.library || !symbols[i].defined))
+			continue;
+
+		object_symbol symbol;
+		symbol.name = DemangleSymbol(symbols[i].name.String());
+		symbol.type = symbols[i].type;
+		symbol.defined = symbols[i].defined;
+		symbol.size = symbols[i].size;
+		symbol.hash = symbols[i].hash;
+		symbol.comdat = symbols[i].comdat;
+		symbol.local = local;
+		symbol.member = symbols[i].member;
+		object.symbols.push_back(symbol);
+	}
+}
+
+
+// Whether the linker keeps one of several definitions rather than complaining
+bool
+SymbolXref::IsMerged(const object_symbol& symbol)
+{
+	return symbol.type == 'W' || symbol.type == 'V' || symbol.type == 'u'
+		|| symbol.comdat;
+}
+
+
+bool
+SymbolXref::IsCompilerSymbol(const BString& name)
+{
+	static const char* kPrefixes[] = {
+		"vtable for ",
+		"construction vtable for ",
+		"VTT for ",
+		"typeinfo for ",
+		"typeinfo name for ",
+		"guard variable for ",
+		"virtual thunk to ",
+		"non-virtual thunk to ",
+		"covariant return thunk to ",
+		"_GLOBAL_"
+	};
+
+	for (size_t i = 0; i < sizeof(kPrefixes) / sizeof(kPrefixes[0]); i++) {
+		if (name.StartsWith(kPrefixes[i]))
+			return true;
+	}
+	return false;
+}
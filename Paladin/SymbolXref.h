@@ -0,0 +1,166 @@
+#ifndef SYMBOL_XREF_H
+#define SYMBOL_XREF_H
+
+
+#include <Locker.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+
+struct xref_symbol {
+	BString			name;
+
+	// The sources whose objects define and use the symbol
+	BStringList		definitions;
+	BStringList		references;
+};
+
+
+struct object_file {
+	BString			object;
+	BString			source;
+
+	// A static library linked into the project rather than one of its own
+	// objects. Only its conflicts with the project's objects are of interest.
+	bool			library;
+};
+
+
+struct symbol_definition {
+	BString			source;
+
+	// The archive member, for definitions in static libraries
+	BString			member;
+	uint64			size;
+};
+
+
+struct symbol_conflict {
+	BString			name;
+
+	// Weak definitions, like those of inline functions and templates, which
+	// differ, of which the linker silently keeps one. Otherwise strong
+	// definitions in more than one object.
+	bool			mismatch;
+	std::vector<symbol_definition>	definitions;
+};
+
+
+// Which of a project's objects and static libraries define and use each
+// global symbol, read from their symbol tables after a build. The names are
+// demangled. The symbols of each object are kept in a file in the objects
+// folder, so only objects which were built again since the last update are
+// read, by a thread per CPU.
+class SymbolXref {
+public:
+								SymbolXref(const char* indexPath);
+								~SymbolXref();
+
+			// Brings the index up to date with objects. Objects which aren't
+			// in it any more are forgotten. Returns how many were read. When
+			// cancel becomes non-zero, no more objects are read, and those
+			// left are read by the next update.
+			int32				Update(const std::vector<object_file>& objects,
+									int32* cancel = NULL);
+
+			// Fills symbols with those whose names contain text, up to
+			// maxCount of them, and returns how many there are in all
+			int32				Find(const char* text, int32 maxCount,
+									std::vector<xref_symbol>& symbols);
+
+			// Symbols defined for use by other objects which none of them
+			// uses. Weak symbols, like inline functions, and the compiler's
+			// own, like vtables, are left out, as are the libraries' symbols.
+			void				FindUnreferenced(
+									std::vector<xref_symbol>& symbols);
+
+			// Symbols defined more than once in a way which breaks the one
+			// definition rule, which the link doesn't always catch. Only the
+			// archive members the link pulls in are taken into account.
+			void				FindConflicts(
+									std::vector<symbol_conflict>& conflicts);
+
+			// Fills sources with the sources of the project's objects which
+			// define each of names only for their own use, as static
+			void				FindLocalDefinitions(
+									const std::set<BString>& names,
+									std::map<BString, BStringList>& sources);
+
+private:
+	struct object_symbol {
+		BString					name;
+		char					type;
+		bool					defined;
+		uint64					size;
+		uint32					hash;
+		bool					comdat;
+
+		// Defined as static. These are only kept for the project's own
+		// objects, for telling why a symbol is missing from the link.
+		bool					local;
+
+		// Index into the object's members, -1 outside of archives
+		int32					member;
+	};
+
+	struct object_entry {
+		BString					path;
+		BString					source;
+		bool					library;
+		int64					modified;
+		int64					size;
+		std::vector<BString>	members;
+		std::vector<object_symbol>	symbols;
+	};
+
+	struct symbol_location {
+		int32					object;
+		int32					symbol;
+	};
+
+	struct symbol_entry {
+		std::vector<symbol_location>	definitions;
+		std::vector<int32>		references;
+	};
+
+			status_t			Load();
+			status_t			Save();
+			void				BuildLookup();
+			void				MakeSymbol(const BString& name,
+									const symbol_entry& entry,
+									xref_symbol& symbol) const;
+			void				MakeConflict(const BString& name,
+									const std::vector<symbol_location>&
+										definitions,
+									bool mismatch,
+									symbol_conflict& conflict) const;
+			void				FindLinkedMembers(
+									std::vector<std::vector<bool> >& linked)
+										const;
+
+	static	int32				ReadThread(void* data);
+	static	void				ReadObject(object_entry& object);
+	static	bool				IsMerged(const object_symbol& symbol);
+	static	bool				IsCompilerSymbol(const BString& name);
+
+			BString				fIndexPath;
+
+			// Guards everything below
+			BLocker				fLock;
+			bool				fLoaded;
+			std::vector<object_entry*>	fObjects;
+			std::map<BString, symbol_entry>	fSymbols;
+			std::map<BString, std::vector<int32> >	fLocalDefinitions;
+
+			// What the reader threads work on
+			std::vector<object_entry*>	fPending;
+			int32				fNextPending;
+			int32*				fCancel;
+};
+
+
+#endif // SYMBOL_XREF_H
@@ -11,12 +11,21 @@
 
 #include "TerminalWindow.h"
 
+#include <Autolock.h>
 #include <Catalog.h>
 #include <Font.h>
 #include <Locale.h>
 #include <Message.h>
 #include <ScrollView.h>
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #include "DebugTools.h"
 
@@ -24,18 +33,49 @@
 #define B_TRANSLATION_CONTEXT "TerminalWindow"
 
 #define M_RUN_COMMAND 'rncm'
+#define M_STOP_COMMAND 'stcm'
+#define M_OUTPUT_READY 'otrd'
+#define M_COMMAND_DONE 'cmdn'
+
+// How much output is kept waiting for the window and how much it shows
+static const size_t kBufferSize = 64 * 1024;
+static const int32 kMaxTextLength = 1024 * 1024;
+
+// How often the reader thread looks whether the window is going away
+static const bigtime_t kReadTimeout = 100000;
 
 
 TerminalWindow::TerminalWindow(const char* commandLine)
 	:
 	DWindow(BRect(0, 0, 400, 300), B_TRANSLATE("Terminal output")),
-	fCommand(commandLine)
+	fCommand(commandLine),
+	fChildPid(-1),
+	fOutputFD(-1),
+	fReaderThread(-1),
+	fQuitFlag(0),
+	fReaped(0),
+	fStopRequested(false),
+	fBufferLock("terminal output"),
+	fBuffer(new char[kBufferSize]),
+	fBufferStart(0),
+	fBufferLength(0),
+	fDroppedLength(0),
+	fShowPending(false)
 {
 	SetSizeLimits(300, 30000, 200, 30000);
 	MakeCenteredOnShow(true);
 
 	BRect r(Bounds());
 	r.InsetBy(10,10);
+
+	fStopButton = new BButton(BRect(0, 0, 1, 1), "stop", B_TRANSLATE("Stop"),
+		new BMessage(M_STOP_COMMAND), B_FOLLOW_RIGHT | B_FOLLOW_BOTTOM);
+	fStopButton->ResizeToPreferred();
+	fStopButton->MoveTo(r.right - fStopButton->Bounds().Width(),
+		r.bottom - fStopButton->Bounds().Height());
+	fStopButton->SetEnabled(false);
+
+	r.bottom = fStopButton->Frame().top - 10;
 	r.right -= B_V_SCROLL_BAR_WIDTH;
 
 	BRect textRect(r);
@@ -45,43 +85,70 @@ TerminalWindow::TerminalWindow(const char* commandLine)
 	BScrollView* scrollView = new BScrollView("scroller", fTextView,
 		B_FOLLOW_ALL, 0, false,true);
 	GetBackgroundView()->AddChild(scrollView);
+	GetBackgroundView()->AddChild(fStopButton);
 	fTextView->SetFont(be_fixed_font);
+	fTextView->MakeEditable(false);
 }
 
 
 TerminalWindow::~TerminalWindow(void)
 {
+	if (fReaderThread >= 0) {
+		if (fChildPid >= 0 && atomic_get(&fReaped) == 0)
+			kill(-fChildPid, SIGKILL);
+		atomic_set(&fQuitFlag, 1);
+
+		status_t result;
+		wait_for_thread(fReaderThread, &result);
+	}
+
+	if (fOutputFD >= 0)
+		close(fOutputFD);
+	delete[] fBuffer;
 }
 
 
 void
 TerminalWindow::MessageReceived(BMessage* message)
 {
-	if (message->what == M_RUN_COMMAND) {
-		if (!IsHidden())
-			Hide();
-
-		FILE* fd = popen(fCommand.String(),"r");
-		if (fd != NULL) {
-			BString data;
-			char buffer[1024];
-			while (fgets(buffer,1024,fd)) {
-				if (!ferror(fd)) {
-					data += buffer;
-				}
-			}
+	switch (message->what) {
+		case M_RUN_COMMAND:
+		{
+			// The window stays hidden until the command is started
+			if (IsHidden())
+				Show();
 
-			int status = pclose(fd);
-			if (0 != status) {
-				STRACE(2,("popen returned non zero (error) code: %i",status));
+			if (fReaderThread >= 0)
+				break;
+
+			status_t status = StartCommand();
+			if (status != B_OK) {
+				BString text(B_TRANSLATE("Couldn't run the program: %error%"));
+				text.ReplaceFirst("%error%", strerror(status));
+				fTextView->SetText(text.String());
 			}
+			break;
+		}
 
-			fTextView->SetText(data.String());
+		case M_OUTPUT_READY:
+			ShowOutput();
+			break;
+
+		case M_STOP_COMMAND:
+			StopCommand();
+			break;
+
+		case M_COMMAND_DONE:
+		{
+			int32 status;
+			if (message->FindInt32("status", &status) == B_OK)
+				CommandDone(status);
+			break;
 		}
 
-		Show();
-	} else
-		DWindow::MessageReceived(message);
+		default:
+			DWindow::MessageReceived(message);
+	}
 }
 
 
@@ -100,3 +167,253 @@ TerminalWindow::FrameResized(float, float)
 	fTextView->SetTextRect(r);
 	UpdateIfNeeded();
 }
+
+
+status_t
+TerminalWindow::StartCommand(void)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return errno;
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		status_t status = errno;
+		close(fds[0]);
+		close(fds[1]);
+		return status;
+	}
+
+	if (pid == 0) {
+		setpgid(0, 0);
+		dup2(fds[1], STDOUT_FILENO);
+		dup2(fds[1], STDERR_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		execl("/bin/sh", "sh", "-c", fCommand.String(), (char*)NULL);
+		_exit(127);
+	}
+
+	// Both sides set the group, so it is set before either goes on
+	setpgid(pid, 0);
+	close(fds[1]);
+
+	fChildPid = pid;
+	fOutputFD = fds[0];
+	fMessenger = BMessenger(this);
+	fReaderThread = spawn_thread(ReaderThread, "terminal reader",
+		B_NORMAL_PRIORITY, this);
+	if (fReaderThread < 0) {
+		status_t status = fReaderThread;
+		kill(-fChildPid, SIGKILL);
+		waitpid(fChildPid, NULL, 0);
+		close(fOutputFD);
+		fChildPid = -1;
+		fOutputFD = -1;
+		return status;
+	}
+
+	STRACE(1, ("Running %s in terminal window as %d\n", fCommand.String(),
+		(int)fChildPid));
+	resume_thread(fReaderThread);
+	fStopButton->SetEnabled(true);
+	return B_OK;
+}
+
+
+void
+TerminalWindow::StopCommand(void)
+{
+	// Once the reader thread has waited for it, the group may be gone and
+	// its ID given to another one
+	if (fChildPid < 0 || atomic_get(&fReaped) != 0)
+		return;
+
+	// Ask nicely first, like Ctrl-C in a terminal does, and insist after that
+	kill(-fChildPid, fStopRequested ? SIGKILL : SIGINT);
+	if (!fStopRequested) {
+		fStopRequested = true;
+		fStopButton->SetLabel(B_TRANSLATE("Kill"));
+	}
+}
+
+
+void
+TerminalWindow::ShowOutput(void)
+{
+	BString text;
+	size_t dropped;
+	{
+		BAutolock lock(fBufferLock);
+		size_t firstLength = std::min(fBufferLength, kBufferSize - fBufferStart);
+		text.Append(fBuffer + fBufferStart, firstLength);
+		text.Append(fBuffer, fBufferLength - firstLength);
+		dropped = fDroppedLength;
+		fBufferStart = 0;
+		fBufferLength = 0;
+		fDroppedLength = 0;
+		fShowPending = false;
+	}
+
+	if (dropped > 0) {
+		BString notice(B_TRANSLATE("[%count% bytes of output skipped]\n"));
+		BString count;
+		count << (uint64)dropped;
+		notice.ReplaceFirst("%count%", count.String());
+		text.Prepend(notice);
+		fPartialChar = "";
+	}
+
+	text.Prepend(fPartialChar);
+	fPartialChar = "";
+
+	// Look for a UTF-8 lead byte without all of the bytes following it
+	int32 length = text.Length();
+	int32 lead = length - 1;
+	while (lead >= 0 && lead > length - 4 && (text[lead] & 0xc0) == 0x80)
+		lead--;
+	if (lead >= 0 && (uint8)text[lead] >= 0xc0) {
+		uint8 byte = text[lead];
+		int32 needed = byte >= 0xf0 ? 4 : byte >= 0xe0 ? 3 : 2;
+		if (length - lead < needed) {
+			fPartialChar.SetTo(text.String() + lead, length - lead);
+			text.Truncate(lead);
+		}
+	}
+
+	if (text.Length() == 0)
+		return;
+
+	fTextView->Insert(fTextView->TextLength(), text.String(), text.Length());
+
+	// Only the end of long output is kept, starting at a line
+	int32 excess = fTextView->TextLength() - kMaxTextLength;
+	if (excess > 0) {
+		const char* allText = fTextView->Text();
+		const char* lineEnd = strchr(allText + excess, '\n');
+		fTextView->Delete(0, lineEnd != NULL ? lineEnd - allText + 1 : excess);
+	}
+
+	fTextView->ScrollToOffset(fTextView->TextLength());
+}
+
+
+void
+TerminalWindow::CommandDone(int status)
+{
+	status_t result;
+	wait_for_thread(fReaderThread, &result);
+	fReaderThread = -1;
+	close(fOutputFD);
+	fOutputFD = -1;
+	fChildPid = -1;
+
+	ShowOutput();
+	if (fPartialChar.Length() > 0) {
+		fTextView->Insert(fTextView->TextLength(), fPartialChar.String(),
+			fPartialChar.Length());
+		fPartialChar = "";
+	}
+
+	BString text;
+	BString number;
+	if (WIFSIGNALED(status)) {
+		text = B_TRANSLATE("\n[Stopped by signal %signal%]\n");
+		number << WTERMSIG(status);
+		text.ReplaceFirst("%signal%", number.String());
+	} else if (WEXITSTATUS(status) != 0) {
+		STRACE(2,("Program returned non zero (error) code: %i\n",
+			WEXITSTATUS(status)));
+		text = B_TRANSLATE("\n[Exited with status %status%]\n");
+		number << WEXITSTATUS(status);
+		text.ReplaceFirst("%status%", number.String());
+	} else
+		text = B_TRANSLATE("\n[Finished]\n");
+
+	fTextView->Insert(fTextView->TextLength(), text.String(), text.Length());
+	fTextView->ScrollToOffset(fTextView->TextLength());
+	fStopButton->SetEnabled(false);
+}
+
+
+int32
+TerminalWindow::ReaderThread(void* data)
+{
+	static_cast<TerminalWindow*>(data)->ReadOutput();
+	return 0;
+}
+
+
+void
+TerminalWindow::ReadOutput(void)
+{
+	// This runs on its own thread and never locks the window, which waits
+	// for it when it goes away
+	char chunk[4096];
+	while (atomic_get(&fQuitFlag) == 0) {
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(fOutputFD, &readSet);
+		struct timeval timeout = { 0, kReadTimeout };
+		int ready = select(fOutputFD + 1, &readSet, NULL, NULL, &timeout);
+		if (ready < 0 && errno != EINTR)
+			break;
+		if (ready <= 0)
+			continue;
+
+		ssize_t bytesRead = read(fOutputFD, chunk, sizeof(chunk));
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+		if (bytesRead <= 0)
+			break;
+
+		AddOutput(chunk, bytesRead);
+	}
+
+	int status = 0;
+	waitpid(fChildPid, &status, 0);
+	atomic_set(&fReaped, 1);
+
+	if (atomic_get(&fQuitFlag) == 0) {
+		BMessage done(M_COMMAND_DONE);
+		done.AddInt32("status", status);
+		fMessenger.SendMessage(&done);
+	}
+}
+
+
+void
+TerminalWindow::AddOutput(const char* data, size_t length)
+{
+	bool notify;
+	{
+		BAutolock lock(fBufferLock);
+
+		// The oldest output goes when the window can't keep up
+		if (length > kBufferSize) {
+			fDroppedLength += length - kBufferSize;
+			data += length - kBufferSize;
+			length = kBufferSize;
+		}
+		if (fBufferLength + length > kBufferSize) {
+			size_t overflow = fBufferLength + length - kBufferSize;
+			fBufferStart = (fBufferStart + overflow) % kBufferSize;
+			fBufferLength -= overflow;
+			fDroppedLength += overflow;
+		}
+
+		size_t end = (fBufferStart + fBufferLength) % kBufferSize;
+		size_t firstLength = std::min(length, kBufferSize - end);
+		memcpy(fBuffer + end, data, firstLength);
+		memcpy(fBuffer, data + firstLength, length - firstLength);
+		fBufferLength += length;
+
+		// Whatever comes in before the window gets to it is shown along with
+		// this, so there is never more than one of these waiting
+		notify = !fShowPending;
+		fShowPending = true;
+	}
+
+	if (notify)
+		fMessenger.SendMessage(M_OUTPUT_READY);
+}
@@ -13,9 +13,14 @@
 
 #include "DWindow.h"
 
+#include <Button.h>
+#include <Locker.h>
+#include <Messenger.h>
 #include <String.h>
 #include <TextView.h>
 
+#include <sys/types.h>
+
 
 class TerminalWindow : public DWindow {
 public:
@@ -27,8 +32,41 @@ public:
 			void			FrameResized(float, float);
 
 private:
+			status_t		StartCommand(void);
+			void			StopCommand(void);
+			void			ShowOutput(void);
+			void			CommandDone(int status);
+
+	static	int32			ReaderThread(void* data);
+			void			ReadOutput(void);
+			void			AddOutput(const char* data, size_t length);
+
 			BTextView*		fTextView;
+			BButton*		fStopButton;
 			BString			fCommand;
+
+			// The command runs in a process group of its own, so stopping
+			// it reaches whatever it starts as well
+			pid_t			fChildPid;
+			int				fOutputFD;
+			thread_id		fReaderThread;
+			int32			fQuitFlag;
+			int32			fReaped;
+			bool			fStopRequested;
+			BMessenger		fMessenger;
+
+			// The end of a character split between two reads
+			BString			fPartialChar;
+
+			// Output the reader thread has read which isn't shown yet. When
+			// the window falls behind, the oldest is dropped, so a chatty
+			// program can't use up the memory.
+			BLocker			fBufferLock;
+			char*			fBuffer;
+			size_t			fBufferStart;
+			size_t			fBufferLength;
+			size_t			fDroppedLength;
+			bool			fShowPending;
 };
 
 
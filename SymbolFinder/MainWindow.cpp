@@ -17,37 +17,41 @@
 #include <Alignment.h>
 #include <Application.h>
 #include <Button.h>
-#include <Entry.h>
-#include <Directory.h>
-#include <FindDirectory.h>
 #include <LayoutBuilder.h>
 #include <LayoutItem.h>
+#include <List.h>
 #include <ListView.h>
-#include <Path.h>
 #include <ScrollView.h>
 #include <StringView.h>
 #include <TextControl.h>
 
-#include "DPath.h"
+#include <vector>
+
+#include "SymbolIndex.h"
 
 
 enum
 {
-	M_SEARCH = 'sear'
+	M_SEARCH = 'sear',
+	M_INDEX_READY = 'inrd'
 };
 
+// More than this many results can't be looked through anyway
+static const int32 kMaxResults = 1000;
+
 
 MainWindow::MainWindow(void)
 	:
 	BWindow(BRect(0.0f, 0.0f, 640.0f, 480.0f), "Symbol locator",
 		B_TITLED_WINDOW, 0),
-	fTerminateSem(-1),
+	fIndex(NULL),
+	fIndexReady(false),
+	fCancelIndex(0),
 	fThreadID(-1)
 {
-	fTerminateSem = create_sem(1, "abort_sem");
-
 	fTextBox = new BTextControl("textbox", "Symbol to find:", "",
 		new BMessage(M_SEARCH));
+	fTextBox->SetModificationMessage(new BMessage(M_SEARCH));
 	BLayoutItem* labelItem = fTextBox->CreateLabelLayoutItem();
 	labelItem->SetExplicitAlignment(BAlignment(B_ALIGN_LEFT,
 		B_ALIGN_VERTICAL_CENTER));
@@ -57,7 +61,7 @@ MainWindow::MainWindow(void)
 
 	fGoButton = new BButton("goButton", "Search", new BMessage(M_SEARCH));
 
-	fStatusView = new BStringView("statusView", "");
+	fStatusView = new BStringView("statusView", "Reading libraries" B_UTF8_ELLIPSIS);
 
 	fResultList = new BListView("resultList");
 	BScrollView* listScroller = new BScrollView("listScroller",
@@ -76,15 +80,22 @@ MainWindow::MainWindow(void)
 
 	fTextBox->MakeFocus();
 	fGoButton->MakeDefault(true);
-	fStatusView->Hide();
 
 	CenterOnScreen();
+
+	fIndex = new SymbolIndex(SymbolIndex::DefaultPath().String());
+	SymbolIndex::GetLibraryFolders(fFolders);
+
+	fThreadID = spawn_thread(IndexThread, "indexthread", B_LOW_PRIORITY, this);
+	if (fThreadID > 0)
+		resume_thread(fThreadID);
 }
 
 
 MainWindow::~MainWindow(void)
 {
-	delete_sem(fTerminateSem);
+	ClearResults();
+	delete fIndex;
 }
 
 
@@ -94,10 +105,27 @@ MainWindow::MessageReceived(BMessage* message)
 	switch (message->what) {
 		case M_SEARCH:
 		{
-			fThreadID = spawn_thread(SearchThread, "searchthread",
-				B_NORMAL_PRIORITY, this);
-			if (fThreadID > 0)
-				resume_thread(fThreadID);
+			DoSearch(fTextBox->Text());
+			break;
+		}
+
+		case M_SYMBOLS_CHANGED:
+		{
+			int32 done = message->GetInt32("done", 0);
+			int32 total = message->GetInt32("total", 0);
+			fProgress = "Reading libraries: ";
+			fProgress << done << " of " << total << ". ";
+
+			fIndexReady = true;
+			DoSearch(fTextBox->Text());
+			break;
+		}
+
+		case M_INDEX_READY:
+		{
+			fProgress = "";
+			fIndexReady = true;
+			DoSearch(fTextBox->Text());
 			break;
 		}
 
@@ -111,7 +139,15 @@ MainWindow::MessageReceived(BMessage* message)
 bool
 MainWindow::QuitRequested(void)
 {
-	acquire_sem(fTerminateSem);
+	// The index thread only posts messages to the window, so it can be
+	// waited for while the window is locked
+	atomic_set(&fCancelIndex, 1);
+	if (fThreadID > 0) {
+		status_t result;
+		wait_for_thread(fThreadID, &result);
+		fThreadID = -1;
+	}
+
 	be_app->PostMessage(B_QUIT_REQUESTED);
 
 	return true;
@@ -121,127 +157,85 @@ MainWindow::QuitRequested(void)
 void
 MainWindow::DoSearch(const char* text)
 {
-	if (text == NULL)
-		return;
-
-	Lock();
+	ClearResults();
 
-	fStatusView->Show();
-	fGoButton->SetEnabled(false);
-	for (int32 i = fResultList->CountItems() - 1; i >= 0; i--) {
-		BStringItem* item = (BStringItem*)fResultList->RemoveItem(i);
-		delete item;
+	if (!fIndexReady) {
+		fStatusView->SetText("Reading libraries" B_UTF8_ELLIPSIS);
+		return;
 	}
 
-	Unlock();
-
-	status_t result = B_OK;
-	BPath path;
-	if (find_directory(B_BEOS_LIB_DIRECTORY, &path) == B_OK)
-		result = SearchLibPath(path.Path(),text);
-
-	if (result == B_OK && find_directory(B_USER_LIB_DIRECTORY, &path) == B_OK)
-		result = SearchLibPath(path.Path(), text);
-
-	if (result == B_OK && BEntry("/boot/system").Exists()
-		&& find_directory(B_SYSTEM_LIB_DIRECTORY, &path) == B_OK) {
-		result = SearchLibPath(path.Path(),text);
+	BString label(fProgress);
+	if (text == NULL || *text == '\0') {
+		label << fIndex->CountSymbols() << " symbols in "
+			<< fIndex->CountLibraries() << " libraries";
+		fStatusView->SetText(label.String());
+		return;
 	}
 
-	Lock();
+	std::vector<symbol_match> matches;
+	int32 count = fIndex->Find(text, kMaxResults, matches);
+
+	BList items(matches.size());
+	for (size_t i = 0; i < matches.size(); i++) {
+		const symbol_match& match = matches[i];
+		BString line(match.library);
+		if (match.member.Length() > 0)
+			line << "[" << match.member << "]";
+		line << ": " << match.name << " " << match.type;
+		items.AddItem(new BStringItem(line.String()));
+	}
+	fResultList->AddList(&items);
+
+	if (count > (int32)matches.size())
+		label << "Showing " << matches.size() << " of " << count << " symbols";
+	else if (count == 1)
+		label << "1 symbol";
+	else
+		label << count << " symbols";
+	fStatusView->SetText(label.String());
+}
 
-	fThreadID = -1;
-	fStatusView->Hide();
-	fGoButton->SetEnabled(true);
 
-	Unlock();
+void
+MainWindow::ClearResults(void)
+{
+	// Taking them all out at once saves the list redrawing for each one
+	int32 count = fResultList->CountItems();
+	std::vector<BListItem*> items(count);
+	for (int32 i = 0; i < count; i++)
+		items[i] = fResultList->ItemAt(i);
+
+	fResultList->MakeEmpty();
+	for (int32 i = 0; i < count; i++)
+		delete items[i];
 }
 
 
 int32
-MainWindow::SearchThread(void* data)
+MainWindow::IndexThread(void* data)
 {
 	MainWindow* window = static_cast<MainWindow*>(data);
-	if (window->fTextBox->Text() != NULL && *window->fTextBox->Text() != '\0')
-		window->DoSearch(window->fTextBox->Text());
+	window->BuildIndex();
 
 	return 0;
 }
 
 
-status_t
-MainWindow::SearchLibPath(const char* path, const char* text)
+void
+MainWindow::BuildIndex(void)
 {
-	BDirectory dir(path);
-	if (dir.InitCheck() != B_OK)
-		return B_BAD_VALUE;
-
-	entry_ref ref;
-	while (dir.GetNextRef(&ref) == B_OK) {
-		sem_info info;
-		get_sem_info(fTerminateSem,&info);
-		if (info.count <= 0) {
-			release_sem(fTerminateSem);
-			return B_ERROR;
-		}
-
-		DPath file(ref);
-		if (!file.GetExtension() || !((strcmp(file.GetExtension(),"so") == 0)
-				|| (strcmp(file.GetExtension(),"o") == 0)
-				|| (strcmp(file.GetExtension(),"a") == 0))) {
-			continue;
-		}
-		
-		BString label = "Searching ";
-		label << file.GetFileName();
-
-		Lock();
-
-		fStatusView->SetText(label.String());
-		UpdateIfNeeded();
-
-		Unlock();
-
-		BString command("nm -CA --defined-only --format=posix '");
-		command << file.GetFullPath() << "' | grep '" << text << "'";
-
-		FILE* fd = popen(command.String(),"r");
-		if (fd != NULL) {
-			BString out;
-			char buffer[32];
-			while (fgets(buffer, 32, fd)) {
-				if (!ferror(fd)) {
-					out += buffer;
-				}
-			}
-
-			int status = pclose(fd);
-			if (0 != status) {
-				//STRACE(2,("pclose returned non zero (error) code: %i",status));
-			}
-
-			if (out.CountChars() > 0) {
-				char* line = strtok(out.LockBuffer(out.Length()), "\n");
-				while (line != NULL) {
-					Lock();
-
-					fResultList->AddItem(new BStringItem(line));
-					UpdateIfNeeded();
-
-					Unlock();
-
-					line = strtok(NULL,"\n");
-				}			
-			}
-		}
-	}
-
-	Lock();
-
-	fStatusView->SetText("");
-	UpdateIfNeeded();
+	// What was found last time can be searched while the libraries which
+	// changed since are read again
+	if (fIndex->Load() == B_OK)
+		PostMessage(M_INDEX_READY);
+
+	int32 readCount = fIndex->Update(fFolders, &fCancelIndex,
+		BMessenger(this));
+	if (readCount == B_CANCELED)
+		return;
 
-	Unlock();
+	if (readCount > 0)
+		fIndex->Save();
 
-	return B_OK;
+	PostMessage(M_INDEX_READY);
 }
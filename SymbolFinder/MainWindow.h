@@ -12,6 +12,8 @@
 
 
 #include <OS.h>
+#include <String.h>
+#include <StringList.h>
 #include <Window.h>
 
 
@@ -19,6 +21,7 @@ class BButton;
 class BListView;
 class BStringView;
 class BTextControl;
+class SymbolIndex;
 
 class MainWindow : public BWindow {
 public:
@@ -29,15 +32,20 @@ public:
 
 private:
 			void				DoSearch(const char* text);
-	static	int32				SearchThread(void* data);
-			status_t			SearchLibPath(const char* path, const char* text);
+			void				ClearResults();
+	static	int32				IndexThread(void* data);
+			void				BuildIndex();
 
 			BTextControl*		fTextBox;
 			BButton*			fGoButton;
 			BListView*			fResultList;
 			BStringView*		fStatusView;
 
-			sem_id				fTerminateSem;
+			SymbolIndex*		fIndex;
+			BStringList			fFolders;
+			bool				fIndexReady;
+			BString				fProgress;
+			int32				fCancelIndex;
 			thread_id			fThreadID;
 };
 